@@ -5,16 +5,70 @@ Generates events and sends commands to Raspberry Pi via USB serial
 """
 
 import serial
+import struct
 import time
 import random
 import sys
 from typing import Optional
 
+# Binary framing (must match usb_listener.h / commands.h on the Pi):
+#   [0xA5][len][opcode][cabin uint16 LE][value int16 LE][crc8 over len + payload]
+FRAME_SYNC = 0xA5
+NO_CABIN = 0xFFFF
+OPCODES = {
+    'LIGHT': 1,
+    'TEMP': 2,
+    'EMERGENCY': 3,
+    'FIRE': 4,
+    'POWER': 5,
+    'CHAIN': 6,
+    'STATUS': 7,
+    'METRICS': 8,
+    'LOCKS': 9,
+}
+POWER_LEVELS = {'LOW': 0, 'OK': 100}  # Or a supply percentage, 1..100
+
+def crc8(data: bytes) -> int:
+    """CRC-8, polynomial 0x07, initial value 0x00"""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+def encode_frame(command: str) -> bytes:
+    """Encode a text command as a binary frame"""
+    words = command.split()
+    name = words[0]
+    cabin = NO_CABIN
+    value = 0
+    
+    if name in ('LIGHT', 'TEMP', 'EMERGENCY', 'FIRE'):
+        cabin = int(words[1])
+    if name == 'LIGHT':
+        value = 1 if words[2] == 'ON' else 0
+    elif name == 'TEMP':
+        value = int(words[2])
+    elif name == 'POWER':
+        value = POWER_LEVELS[words[1]] if words[1] in POWER_LEVELS else int(words[1])
+        if not 0 <= value <= 100:
+            raise ValueError(f"Supply percentage out of range: {value}")
+    elif name == 'METRICS':
+        value = {'RESET': 1, 'JSON': 2}.get(words[1], 0) if len(words) > 1 else 0
+    elif name == 'LOCKS':
+        value = 1 if len(words) > 1 and words[1] == 'RESET' else 0
+    
+    payload = struct.pack('<BHh', OPCODES[name], cabin, value)
+    body = bytes([len(payload)]) + payload
+    return bytes([FRAME_SYNC]) + body + bytes([crc8(body)])
+
 class CoachEventGenerator:
-    def __init__(self, port: str = '/dev/ttyACM0', baudrate: int = 115200):
+    def __init__(self, port: str = '/dev/ttyACM0', baudrate: int = 115200, binary: bool = False):
         """Initialize connection to Raspberry Pi"""
         self.port = port
         self.baudrate = baudrate
+        self.binary = binary
         self.ser: Optional[serial.Serial] = None
         self.num_cabins = 10
         
@@ -43,9 +97,14 @@ class CoachEventGenerator:
             return False
         
         try:
-            cmd = command.strip() + '\n'
-            self.ser.write(cmd.encode('utf-8'))
-            print(f"→ Sent: {command}")
+            if self.binary:
+                frame = encode_frame(command.strip())
+                self.ser.write(frame)
+                print(f"→ Sent: {command} [{frame.hex()}]")
+            else:
+                cmd = command.strip() + '\n'
+                self.ser.write(cmd.encode('utf-8'))
+                print(f"→ Sent: {command}")
             return True
         except Exception as e:
             print(f"✗ Error sending command: {e}")
@@ -71,6 +130,14 @@ class CoachEventGenerator:
         """Trigger low power condition"""
         self.send_command("POWER LOW")
     
+    def power_restore(self):
+        """Restore full supply, bringing shed loads back"""
+        self.send_command("POWER OK")
+    
+    def power_supply(self, percent: int):
+        """Set the available supply as a percentage (1-100)"""
+        self.send_command(f"POWER {percent}")
+    
     def chain_pull(self):
         """Simulate chain pull"""
         self.send_command("CHAIN PULL")
@@ -79,6 +146,14 @@ class CoachEventGenerator:
         """Request system status"""
         self.send_command("STATUS")
     
+    def request_metrics(self, reset: bool = False):
+        """Request latency metrics, or reset them"""
+        self.send_command("METRICS RESET" if reset else "METRICS")
+    
+    def request_locks(self, reset: bool = False):
+        """Request lock contention statistics, or reset them"""
+        self.send_command("LOCKS RESET" if reset else "LOCKS")
+    
     def random_event(self):
         """Generate a random event"""
         cabin_id = random.randint(0, self.num_cabins - 1)
@@ -158,9 +233,13 @@ def print_menu():
     print("  4  - Trigger EMERGENCY in a cabin")
     print("  5  - Trigger FIRE in a cabin")
     print("  6  - Activate LOW POWER mode")
+    print("  o  - Restore power (POWER OK)")
+    print("  p  - Set supply percentage (POWER 1-100)")
     print("  7  - Trigger CHAIN PULL")
     print("  8  - Request system STATUS")
     print("  9  - Generate RANDOM event")
+    print("  m  - Request latency METRICS (r to reset)")
+    print("  l  - Request lock contention LOCKS (k to reset)")
     print("  d  - Run DEMO sequence")
     print("  q  - Quit")
     print("="*60 + "\n")
@@ -169,11 +248,15 @@ def main():
     """Main function"""
     # Parse command line arguments
     port = '/dev/ttyACM0'
-    if len(sys.argv) > 1:
-        port = sys.argv[1]
+    binary = False
+    for arg in sys.argv[1:]:
+        if arg == '--binary':
+            binary = True
+        else:
+            port = arg
     
     # Create event generator
-    generator = CoachEventGenerator(port=port)
+    generator = CoachEventGenerator(port=port, binary=binary)
     
     # Connect to Raspberry Pi
     if not generator.connect():
@@ -181,6 +264,7 @@ def main():
         print("1. Check USB connection")
         print("2. Verify Raspberry Pi is running the coach_rtos program")
         print("3. Try different port: python3 event_generator.py /dev/ttyUSB0")
+        print("4. Binary framing: python3 event_generator.py /dev/ttyACM0 --binary")
         return
     
     # Interactive mode
@@ -211,19 +295,34 @@ def main():
                     generator.trigger_fire(cabin)
                 elif choice == '6':
                     generator.power_low()
+                elif choice == 'o':
+                    generator.power_restore()
+                elif choice == 'p':
+                    percent = int(input("Supply (1-100%): "))
+                    if not 1 <= percent <= 100:
+                        raise ValueError
+                    generator.power_supply(percent)
                 elif choice == '7':
                     generator.chain_pull()
                 elif choice == '8':
                     generator.request_status()
                 elif choice == '9':
                     generator.random_event()
+                elif choice == 'm':
+                    generator.request_metrics()
+                elif choice == 'r':
+                    generator.request_metrics(reset=True)
+                elif choice == 'l':
+                    generator.request_locks()
+                elif choice == 'k':
+                    generator.request_locks(reset=True)
                 elif choice == 'd':
                     generator.demo_sequence()
                 else:
                     print("Invalid command")
                 
                 time.sleep(0.5)
-                
+            
             except ValueError:
                 print("Invalid input")
             except KeyboardInterrupt:
@@ -0,0 +1,9 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "common.h"
+
+// Benchmark Functions
+int bench_run(const char* name);
+
+#endif // BENCH_H
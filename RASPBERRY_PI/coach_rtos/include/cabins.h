@@ -0,0 +1,56 @@
+#ifndef CABINS_H
+#define CABINS_H
+
+#include "common.h"
+#include "locks.h"
+
+#define CABIN_DEFAULT_TEMP 24  // Celsius
+
+// Cabin updates, applied by cabin_apply() under the cabin's stripe or by
+// the shard owning it (see shards.h)
+typedef enum {
+    CABIN_OP_LIGHT,       // value: on (1) / off (0)
+    CABIN_OP_TEMP,        // value: setpoint, Celsius
+    CABIN_OP_FIRE,
+    CABIN_OP_EMERGENCY,
+    CABIN_OP_SHED_LIGHT,  // value: shed (1) / restore (0), see power.h
+    CABIN_OP_SHED_HVAC,
+} CabinOp;
+
+// Cabin Store Functions
+int cabins_init(CabinStore* store, int count);
+void cabins_destroy(CabinStore* store);
+bool cabin_apply(CabinStore* store, int cabin_id, CabinOp op, int value);
+int cabins_apply_range(CabinStore* store, int first, int end, CabinOp op, int value);
+uint64_t cabins_state_mask(CabinStore* store, int word, CabinState state);
+int cabins_count_state(CabinStore* store, CabinState state);
+
+// Lock stripe guarding a cabin (and the rest of its 64-cabin word)
+static inline Lock* cabin_lock_for(CabinStore* store, int cabin_id) {
+    return &store->locks[(cabin_id / CABINS_PER_WORD) & (CABIN_LOCK_STRIPES - 1)];
+}
+
+static inline void cabin_lock(CabinStore* store, int cabin_id) {
+    lock_acquire(cabin_lock_for(store, cabin_id));
+}
+
+static inline void cabin_unlock(CabinStore* store, int cabin_id) {
+    lock_release(cabin_lock_for(store, cabin_id));
+}
+
+// Light bit accessors; writers hold the cabin's stripe
+static inline bool cabin_light_on(const CabinStore* store, int cabin_id) {
+    return (store->light_bits[cabin_id / CABINS_PER_WORD] >> (cabin_id % CABINS_PER_WORD)) & 1;
+}
+
+static inline void cabin_set_light(CabinStore* store, int cabin_id, bool on) {
+    uint64_t bit = 1ULL << (cabin_id % CABINS_PER_WORD);
+    
+    if (on) {
+        store->light_bits[cabin_id / CABINS_PER_WORD] |= bit;
+    } else {
+        store->light_bits[cabin_id / CABINS_PER_WORD] &= ~bit;
+    }
+}
+
+#endif // CABINS_H
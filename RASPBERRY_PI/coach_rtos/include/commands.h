@@ -0,0 +1,56 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "common.h"
+
+// Command Limits
+#define COMMAND_TEMP_MIN 10     // Accepted TEMP setpoints (Celsius)
+#define COMMAND_TEMP_MAX 35
+#define COMMAND_MAX_TOKENS 3   // Command word plus up to two arguments
+#define COMMAND_PAYLOAD_SIZE 5  // Binary payload: opcode, cabin (uint16 LE), value (int16 LE)
+#define COMMAND_NO_CABIN 0xFFFF // Binary cabin field for cabin-less commands
+
+// Command Opcodes (also the binary frame opcode byte)
+typedef enum {
+    OP_INVALID = 0,
+    OP_LIGHT = 1,
+    OP_TEMP = 2,
+    OP_EMERGENCY = 3,
+    OP_FIRE = 4,
+    OP_POWER = 5,
+    OP_CHAIN = 6,
+    OP_STATUS = 7,
+    OP_METRICS = 8,
+    OP_LOCKS = 9,
+    NUM_OPCODES
+} CommandOpcode;
+
+// Power levels carried in the POWER value: LOW, or the supply in percent
+// of the full load (OK is all of it, see power.h)
+#define POWER_LEVEL_LOW 0
+#define POWER_LEVEL_OK 100
+
+// METRICS actions carried in the METRICS value
+#define METRICS_SHOW 0
+#define METRICS_RESET 1
+#define METRICS_JSON 2
+
+// LOCKS actions carried in the LOCKS value
+#define LOCKS_SHOW 0
+#define LOCKS_RESET 1
+
+// Decoded command, independent of the wire format
+typedef struct {
+    CommandOpcode opcode;
+    int cabin;   // -1 when the command has no cabin
+    int value;
+} Command;
+
+// Command Functions
+int command_parse_text(const char* line, size_t len, Command* cmd, const char** error);
+int command_decode_binary(const uint8_t* payload, size_t len, Command* cmd, const char** error);
+size_t command_encode_binary(const Command* cmd, uint8_t* payload);
+void command_execute(const Command* cmd);
+const char* command_name(CommandOpcode opcode);
+
+#endif // COMMANDS_H
@@ -13,20 +13,42 @@
 #include <stdint.h>
 
 // System Configuration
-#define NUM_CABINS 10
-#define MAX_TASKS 8
+#define DEFAULT_NUM_CABINS 10   // One coach; --cabins N for a full rake
+#define MAX_CABINS 8192         // Binary frames carry a 16-bit cabin index
+#define CABINS_PER_WORD 64      // Cabins per light-bitset word
+#define CABIN_LOCK_STRIPES 16   // Must be a power of two
+#define MAX_TASKS 16
 #define MAX_LOG_SIZE 1000
+#define NUM_PRIORITY_LEVELS 32  // One ready-bitmap bit per priority
 
 // Task Priorities (Higher = More Important)
 #define PRIORITY_FIRE_EMERGENCY 10
 #define PRIORITY_PASSENGER_EMERGENCY 9
 #define PRIORITY_CHAIN_PULL 8
 #define PRIORITY_POWER_MANAGEMENT 7
+#define PRIORITY_SENSOR_ALARMS 6
+#define PRIORITY_STATE_EXPORT 5
 #define PRIORITY_TEMP_REGULATION 4
 #define PRIORITY_LIGHTING 3
 #define PRIORITY_DISPLAY 2
 #define PRIORITY_LOGGING 1
 
+// Event Kinds: each kind has its own queue (see events.h), drained by
+// the one task subscribed to it
+typedef enum {
+    EVENT_KIND_FIRE = 0,
+    EVENT_KIND_EMERGENCY = 1,
+    EVENT_KIND_CHAIN_PULL = 2,
+    EVENT_KIND_POWER_LOW = 3,
+    NUM_EVENT_KINDS
+} EventKind;
+
+// Task Wakeup Events (bitmask; tasks subscribe to the events they handle)
+#define EVENT_FIRE       (1u << EVENT_KIND_FIRE)
+#define EVENT_EMERGENCY  (1u << EVENT_KIND_EMERGENCY)
+#define EVENT_CHAIN_PULL (1u << EVENT_KIND_CHAIN_PULL)
+#define EVENT_POWER_LOW  (1u << EVENT_KIND_POWER_LOW)
+
 // Cabin States
 typedef enum {
     STATE_NORMAL = 0,
@@ -44,39 +66,128 @@ typedef enum {
     TASK_SUSPENDED = 3
 } TaskState;
 
-// Cabin Structure
+// Profiled mutex (see locks.h). Statistics are written by the holder and
+// read without locking by the LOCKS report.
+#define LOCK_NAME_LEN 32
 typedef struct {
-    int id;
-    bool light_on;
-    int temperature;  // Celsius
-    CabinState state;
     pthread_mutex_t mutex;
-} Cabin;
+    char name[LOCK_NAME_LEN];
+    const char* holder;              // Holding thread's name, NULL when free
+    int holder_priority;
+    uint64_t acquisitions;
+    uint64_t contended;              // Acquisitions that had to block
+    uint64_t wait_total_ns;
+    uint64_t wait_max_ns;
+    uint64_t inversions;             // Blocked behind a lower-priority holder
+    uint64_t emergency_waits;        // Contended acquisitions on emergency paths
+    uint64_t emergency_wait_total_ns;
+    uint64_t emergency_wait_max_ns;
+    const char* worst_blocker;       // Holder during the longest emergency wait
+} Lock;
 
-// Task Structure
+// Cabin Store: structure-of-arrays sized at startup (see cabins.h).
+// Cabin i's light is bit i % 64 of light_bits[i / 64], and every 64-cabin
+// word is guarded by lock stripe (i / 64) % CABIN_LOCK_STRIPES.
 typedef struct {
+    int count;
+    int num_words;
+    uint64_t* light_bits;
+    uint64_t* light_wanted;  // Requested by LIGHT, whether or not shed
+    uint64_t* light_shed;    // Lights shed by the power budget (see power.h)
+    uint8_t* hvac_on;        // 0 while the cabin's HVAC is shed
+    int16_t* temperature;  // Celsius, current temperature rounded for display
+    uint8_t* state;        // CabinState
+    int16_t* setpoint;     // Celsius, requested by TEMP
+    float* temp_current;   // Thermal model (see thermal.h), owned by the
+    float* temp_rate;      // regulation task under the cabin's stripe
+    float* temp_integral;
+    Lock locks[CABIN_LOCK_STRIPES];
+} CabinStore;
+
+// Timing contract of a task, in microseconds. Admission control checks
+// the whole set against it when a task is added; budget overruns and
+// deadline misses are counted at runtime.
+typedef struct {
+    uint64_t period_us;    // Periodic release (0: event-driven)
+    uint64_t offset_us;    // First release after scheduler_start()
+    uint64_t interval_us;  // Event tasks: least time between wakeups assumed
+    uint64_t deadline_us;  // Relative to the release or wakeup (0: the period)
+    uint64_t budget_us;    // Declared CPU time per step (0: not analysed)
+} TaskTiming;
+
+// Task body: one run-to-completion step. Event tasks return true when
+// events are still queued, to run again right after yielding the CPU;
+// periodic tasks return false.
+struct Task;
+typedef bool (*TaskStep)(struct Task* self);
+
+// Task Structure
+typedef struct Task {
     int id;
     char name[50];
     int priority;
     TaskState state;
-    void* (*task_function)(void*);
+    TaskStep step;
     pthread_t thread;
     bool is_active;
     uint64_t execution_count;
     struct timespec last_execution;
+    
+    // Targeted wakeup: only events in event_mask signal this task
+    uint32_t event_mask;
+    Lock wake_mutex;
+    pthread_cond_t wake_cond;
+    bool wake_pending;
+    struct timespec wake_signalled;
+    uint64_t wakeup_count;
+    uint64_t wakeup_latency_total_ns;
+    uint64_t wakeup_latency_max_ns;
+    
+    // Dispatcher: per-priority ready list link and CPU token handoff
+    struct Task* ready_next;
+    pthread_cond_t dispatch_cond;
+    uint64_t preempt_count;
+    uint64_t run_started_ns;  // Token last (re)acquired
+    uint64_t run_accum_ns;    // Token time before the last preemption
+    
+    // Periodic release on absolute deadlines (period_us == 0: event-driven)
+    uint64_t period_us;
+    uint64_t offset_us;
+    struct timespec next_release;
+    uint64_t release_count;
+    uint64_t missed_releases;
+    uint64_t jitter_total_ns;
+    uint64_t jitter_max_ns;
+    
+    // Timing contract and the current job (one step): its release,
+    // absolute deadline (EDF dispatch order) and thread CPU time at start
+    uint64_t interval_us;
+    uint64_t deadline_us;
+    uint64_t budget_us;
+    uint64_t job_release_ns;
+    uint64_t job_deadline_ns;  // UINT64_MAX: no deadline
+    uint64_t job_cpu_start_ns;
+    uint64_t job_count;
+    uint64_t job_cpu_total_ns;
+    uint64_t job_cpu_max_ns;
+    uint64_t budget_overruns;
+    uint64_t deadline_misses;
+    
+    // Executor mode (see executor.h): submission state and due time
+    int exec_state;
+    uint64_t exec_release_ns;  // Release or event time of the queued run
+    uint64_t exec_rerun_ns;    // Same, for a run requested while running
 } Task;
 
 // System State
 typedef struct {
-    Cabin cabins[NUM_CABINS];
+    CabinStore cabins;
     Task tasks[MAX_TASKS];
     int num_tasks;
     bool system_running;
     bool power_low;
-    bool emergency_active;
-    bool fire_active;
-    pthread_mutex_t system_mutex;
-    pthread_cond_t task_ready_cond;
+    bool chain_pulled;     // Emergency brake applied
+    Lock system_mutex;
 } SystemState;
 
 // Global System State (extern declaration)
@@ -84,6 +195,8 @@ extern SystemState g_system;
 
 // Utility Functions
 void get_timestamp(char* buffer, size_t size);
+uint64_t timespec_to_ns(const struct timespec* ts);
+uint64_t monotonic_now_ns();
 void log_message(const char* format, ...);
 
 #endif // COMMON_H
\ No newline at end of file
@@ -8,6 +8,16 @@
 #define DISPLAY_HEIGHT 320
 #define CABIN_WIDTH 45
 #define CABIN_HEIGHT 60
+#define DISPLAY_MAX_CABINS 10   // Cabins drawn on screen / in the terminal table
+#define MAX_DIRTY_RECTS 32
+#define DISPLAY_WAIT_VSYNC true  // Sync flushes with FBIO_WAITFORVSYNC if supported
+#define DISPLAY_PERIOD_US 100000 // Display task period (10 Hz)
+
+// Terminal Renderer Configuration
+#define TERM_VIEW_ROWS 20          // Rows of the status view; logs scroll below it
+#define TERM_ROW_BYTES 256         // Bytes per composed row (box characters are 3 bytes)
+#define TERM_MIN_LINES 24          // Smaller terminals get plain frames
+#define TERM_PLAIN_INTERVAL_MS 2000 // Least time between plain frames (pipes, files)
 
 // Color Definitions (RGB565 format for framebuffer)
 #define COLOR_BLACK     0x0000
@@ -18,8 +28,19 @@
 #define COLOR_RED       0xF800
 #define COLOR_ORANGE    0xFD20
 
+// Frame statistics
+typedef struct {
+    uint64_t frames;
+    uint64_t frame_time_total_ns;
+    uint64_t frame_time_max_ns;
+    uint64_t bytes_total;
+    uint64_t last_frame_bytes;
+    uint64_t rows_total;        // Terminal rows sent
+} DisplayStats;
+
 // Display Functions
 int display_init();
+int display_attach_buffer(void* buffer, int width, int height, size_t line_length);
 void display_cleanup();
 void display_update();
 void display_clear();
@@ -27,8 +48,13 @@ void display_cabin(int cabin_id);
 void display_header();
 void display_status_message(const char* message);
 void display_terminal_update();
+void display_get_stats(DisplayStats* out);
+void display_reset_stats();
+void display_print_stats();
 
-// Terminal-based display (fallback)
+// Terminal-based display (fallback): frames go to `fd`, with ANSI cursor
+// addressing if `ansi`, else as plain text when something changed
+void display_attach_terminal(int fd, bool ansi);
 void terminal_display_system_state();
 
 #endif // DISPLAY_H
\ No newline at end of file
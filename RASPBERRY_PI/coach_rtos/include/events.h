@@ -0,0 +1,26 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "common.h"
+
+// Event Queue Configuration
+#define EVENT_BATCH 32            // Events a task handles before yielding
+#define EVENT_NO_CABIN -1         // Coach-wide events (chain pull, power)
+
+// One typed event, posted by the handle_*() helpers and taken exactly
+// once by the task draining its kind's queue
+typedef struct {
+    EventKind kind;
+    int cabin;              // EVENT_NO_CABIN for coach-wide events
+    uint64_t timestamp_ns;  // Monotonic time of the post
+    uint64_t sequence;      // Global post order
+} Event;
+
+// Event Functions
+int events_init(int num_cabins);
+void events_destroy();
+bool event_post(EventKind kind, int cabin);
+bool event_take(EventKind kind, Event* out);
+void events_print_stats();
+
+#endif // EVENTS_H
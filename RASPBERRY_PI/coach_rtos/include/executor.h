@@ -0,0 +1,31 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include "common.h"
+
+// Executor Configuration: task steps run on a small pool of pinned worker
+// threads instead of one thread per task. Each general worker owns a
+// deque (it pops the newest work, idle workers steal the oldest); tasks at
+// or above EXECUTOR_LANE_PRIORITY go to a separate lane that worker 0
+// serves exclusively and the others check before their own deques.
+#define EXECUTOR_MAX_WORKERS 8
+#define EXECUTOR_MIN_WORKERS 2                     // The lane worker plus one general worker
+#define EXECUTOR_LANE_PRIORITY PRIORITY_CHAIN_PULL
+#define EXECUTOR_QUEUE_SIZE 16                     // Power of two >= MAX_TASKS
+
+// Task submission state (Task.exec_state). A task is queued at most once,
+// so queues never overflow; submissions while it waits are coalesced.
+typedef enum {
+    EXEC_IDLE = 0,
+    EXEC_QUEUED = 1,
+    EXEC_RUNNING = 2,
+    EXEC_RERUN = 3     // Submitted again while running: requeued on completion
+} ExecState;
+
+// Executor Functions
+int executor_start();
+void executor_stop();
+bool executor_submit(Task* task, uint64_t release_ns);
+void executor_print_stats();
+
+#endif // EXECUTOR_H
@@ -0,0 +1,78 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "common.h"
+#include "commands.h"
+#include "metrics.h"
+
+// Journal file layout (all little endian, packed):
+//   JournalHeader
+//   JournalRecord x N         one per executed command, in order
+//   JournalCabin x num_cabins final cabin state   } written when a
+//   JournalFooter                                  } recording closes
+// A journal cut short by a crash has no footer; its records still replay.
+#define JOURNAL_MAGIC "CJNL"
+#define JOURNAL_FOOTER_MAGIC "CJNE"
+#define JOURNAL_VERSION 2
+
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version;
+    uint16_t payload_size;  // COMMAND_PAYLOAD_SIZE when recorded
+    uint32_t num_cabins;
+    uint64_t reserved;
+} JournalHeader;
+
+typedef struct __attribute__((packed)) {
+    uint64_t offset_ns;     // Since the recording started
+    uint8_t payload[COMMAND_PAYLOAD_SIZE];  // command_encode_binary() format
+} JournalRecord;
+
+// Final cabin state. The setpoint rather than the simulated temperature,
+// which depends on how many control steps ran before shutdown.
+typedef struct __attribute__((packed)) {
+    int16_t setpoint;
+    uint8_t state;
+    uint8_t light_on;
+} JournalCabin;
+
+typedef struct __attribute__((packed)) {
+    uint64_t count;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+} JournalLatency;
+
+typedef struct __attribute__((packed)) {
+    uint64_t record_count;
+    JournalLatency latency[NUM_METRICS];
+    char magic[4];
+} JournalFooter;
+
+// Replay speed meaning "as fast as possible"
+#define REPLAY_SPEED_MAX 0.0
+
+// A journal mapped for replay
+typedef struct {
+    const uint8_t* map;
+    size_t size;
+    const JournalHeader* header;
+    const JournalRecord* records;
+    uint64_t record_count;
+    const JournalCabin* final_cabins;  // NULL without a footer
+    const JournalFooter* footer;       // NULL without a footer
+    double speed;                      // 1.0 real time, N faster, REPLAY_SPEED_MAX
+} Journal;
+
+// Recording (appends come from the listener thread only)
+int journal_record_open(const char* path);
+void journal_record(const Command* cmd);
+void journal_flush();
+void journal_record_close();
+
+// Replay
+int journal_replay_open(const char* path, Journal* journal);
+void journal_replay_close(Journal* journal);
+void* journal_replay_thread(void* arg);
+
+#endif // JOURNAL_H
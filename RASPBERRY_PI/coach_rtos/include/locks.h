@@ -0,0 +1,27 @@
+#ifndef LOCKS_H
+#define LOCKS_H
+
+#include "common.h"
+
+// Lock Configuration
+#define MAX_LOCKS 64                              // Locks listed by the LOCKS report
+#define LOCK_EMERGENCY_PRIORITY PRIORITY_CHAIN_PULL  // Waiters at or above count as emergency
+
+// Lock Functions (Lock itself is declared in common.h)
+void lock_init(Lock* lock, const char* name);
+void lock_destroy(Lock* lock);
+void lock_acquire(Lock* lock);
+void lock_release(Lock* lock);
+void lock_cond_wait(Lock* lock, pthread_cond_t* cond);
+int lock_cond_timedwait(Lock* lock, pthread_cond_t* cond, const struct timespec* deadline);
+
+// Calling thread's identity, used for holder names and emergency waits
+void lock_thread_set(const char* name, int priority);
+int lock_thread_priority(int priority);
+
+// Profiling
+void locks_set_priority_inherit(bool enabled);
+void locks_reset();
+void locks_print();
+
+#endif // LOCKS_H
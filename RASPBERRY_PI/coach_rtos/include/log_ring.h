@@ -0,0 +1,18 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include "common.h"
+#include <stdarg.h>
+
+// Log Ring Configuration
+#define LOG_RING_CAPACITY 1024  // Records, must be a power of two
+#define LOG_MAX_ARGS 8          // Packed arguments per record
+#define LOG_STR_BYTES 128       // Inline storage for %s arguments
+
+// Log Ring Functions
+void log_ring_init();
+bool log_ring_vpush(const char* format, va_list args);
+size_t log_ring_drain(FILE* out);
+uint64_t log_ring_dropped();
+
+#endif // LOG_RING_H
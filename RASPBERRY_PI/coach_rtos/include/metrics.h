@@ -0,0 +1,42 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+
+// Histogram Configuration: log-linear buckets, HISTOGRAM_SUB_BUCKETS per
+// power of two (about 6% relative error), values in nanoseconds
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_EXPONENT 40  // Values above ~18 minutes land in the last bucket
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_BUCKETS)
+
+// Fixed-size latency histogram; recording is lock-free
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+} Histogram;
+
+// Built-in latency metrics
+typedef enum {
+    METRIC_COMMAND_DISPATCH = 0,                          // Bytes read -> command dispatched
+    METRIC_TASK_WAKEUP,                                   // + task id: notify -> task woken
+    METRIC_TASK_EXEC = METRIC_TASK_WAKEUP + MAX_TASKS,    // + task id: time holding the CPU
+    METRIC_THERMAL_STEP = METRIC_TASK_EXEC + MAX_TASKS,   // One control step over all cabins
+    NUM_METRICS
+} MetricId;
+
+// Histogram Functions
+void histogram_record(Histogram* h, uint64_t value);
+uint64_t histogram_percentile(const Histogram* h, double percentile);
+void histogram_reset(Histogram* h);
+
+// Metrics Functions
+void metrics_record(int metric, uint64_t ns);
+const Histogram* metrics_get(int metric);
+void metrics_reset();
+void metrics_print();
+void metrics_print_json();
+
+#endif // METRICS_H
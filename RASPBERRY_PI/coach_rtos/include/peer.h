@@ -0,0 +1,78 @@
+#ifndef PEER_H
+#define PEER_H
+
+#include "common.h"
+
+// Peer Configuration (--peer ADDR, --aggregate ADDR): each coach sends its
+// state to one aggregating instance as compact deltas, every tick only the
+// cabins and flags changed since the last one, plus a full keyframe every
+// PEER_KEYFRAME_US (and after a failed send) so an aggregator that starts
+// late or loses a datagram resynchronizes. ADDR is unix:PATH (datagram
+// socket) or udp:HOST:PORT, HOST possibly a multicast group. The
+// aggregator keeps a view of the whole rake and tracks how old each
+// coach's part of it is. Latencies compare CLOCK_MONOTONIC stamps, so
+// they are meaningful between processes on one host.
+#define PEER_MAX_COACHES 32
+#define PEER_PERIOD_US 20000            // One batch of deltas per tick
+#define PEER_KEYFRAME_US 1000000
+#define PEER_HEARTBEAT_US 200000        // Header-only batch when nothing changed
+#define PEER_STALE_US 1000000           // A coach not heard from this long is stale
+#define PEER_UDP_DATAGRAM_MAX 1400      // Under a typical Ethernet MTU
+#define PEER_UNIX_DATAGRAM_MAX 32768    // Few datagrams per keyframe (queues are short)
+#define PEER_RECV_BUFFER (1024 * 1024)  // Aggregator socket receive buffer
+
+// Wire format, little endian. A datagram is a header followed by `count`
+// cabin entries; a batch (one tick) is one or more datagrams with
+// consecutive sequence numbers, FIRST set on the first and LAST on the
+// last.
+//
+//   header: magic u32, version u8, flags u8, coach u16, sequence u32,
+//           num_cabins u16, count u16, sent_ns u64 (publisher's
+//           CLOCK_MONOTONIC at the snapshot), tick u32
+//   entry:  cabin u16, state u8, bits u8 (PEER_CABIN_*), temperature i16,
+//           setpoint i16
+#define PEER_MAGIC 0x454B4152u          // "RAKE"
+#define PEER_VERSION 1
+#define PEER_HEADER_SIZE 28
+#define PEER_ENTRY_SIZE 8
+
+#define PEER_FLAG_KEYFRAME 0x01         // Entries cover every cabin
+#define PEER_FLAG_FIRST 0x02
+#define PEER_FLAG_LAST 0x04
+#define PEER_FLAG_POWER_LOW 0x08        // Coach flags, in every datagram
+#define PEER_FLAG_CHAIN 0x10
+#define PEER_FLAG_RUNNING 0x20          // Cleared in the final batch
+
+#define PEER_CABIN_LIGHT 0x01
+#define PEER_CABIN_LIGHT_SHED 0x02
+#define PEER_CABIN_HVAC 0x04
+
+// One cabin as carried on the wire
+typedef struct {
+    uint8_t state;                      // CabinState
+    uint8_t bits;                       // PEER_CABIN_*
+    int16_t temperature;
+    int16_t setpoint;
+} PeerCabin;
+
+// Aggregator rake view: MAX_CABINS cabins for every coach, reserved when
+// it starts (and counted into the --rt arena)
+#define PEER_RAKE_BYTES ((size_t)PEER_MAX_COACHES * MAX_CABINS * sizeof(PeerCabin))
+
+// Publisher: the publish task calls peer_publish_tick() every period;
+// peer_publish_close() sends a last batch marked not running
+int peer_publish_open(const char* address, int coach_id);
+bool peer_publish_enabled();
+void peer_publish_tick();
+void peer_publish_close();
+
+// Aggregator: a receiver thread applying every coach's batches to the
+// rake view (stops on the shutdown latch)
+int peer_aggregate_start(const char* address);
+bool peer_aggregate_enabled();
+void peer_aggregate_stop();
+bool peer_rake_coach(int coach_id, uint32_t* next_sequence, bool* synced);
+
+void peer_print_stats();
+
+#endif // PEER_H
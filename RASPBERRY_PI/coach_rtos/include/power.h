@@ -0,0 +1,28 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "common.h"
+
+// Power Budget Configuration: every cabin draws a light and an HVAC load,
+// and POWER commands set the supply as a percentage of the full connected
+// load. Loads are shed by priority until the rest fits the supply: every
+// light first, then HVAC units, each from the last cabin down, so the
+// shed set is always a suffix of the cabins per load and a supply change
+// only touches the cabins between the old and the new boundary. Fire and
+// emergency cabins are never shed.
+#define POWER_LIGHT_LOAD_W 50
+#define POWER_HVAC_LOAD_W 450
+#define POWER_SUPPLY_FULL 100   // Percent: nothing shed
+#define POWER_SUPPLY_LOW 90     // POWER LOW: every light shed, no HVAC
+
+// Power Budget Functions. power_set_supply() only records the level (any
+// thread, returns whether it changed); the power management task then
+// calls power_rebalance(), so a burst of changes costs one pass over the
+// cabins whose loads actually change.
+void power_init();
+bool power_set_supply(int percent);
+void power_rebalance();
+void power_plan(int percent, int* lights, int* hvac);  // Cabins shed at a level
+void power_print_stats();
+
+#endif // POWER_H
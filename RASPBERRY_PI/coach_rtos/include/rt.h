@@ -0,0 +1,37 @@
+#ifndef RT_H
+#define RT_H
+
+#include "common.h"
+
+// Real-time Startup Configuration (--rt): memory is locked, threads get
+// small explicit stacks that are prefaulted, and runtime buffers come from
+// one arena reserved at startup, so the emergency paths never page fault
+#define RT_TASK_STACK_SIZE (128 * 1024)    // Scheduler task threads
+#define RT_THREAD_STACK_SIZE (128 * 1024)  // Listener, replay, executor threads
+#define RT_STACK_PREFAULT_MAX (256 * 1024) // Most stack painted per thread (main grows on demand)
+#define RT_STACK_MARGIN (4 * 1024)         // Left untouched above the guard page
+#define RT_STACK_PATTERN 0xA5              // Paint for the stack high-water mark
+#define RT_MAX_THREADS 32
+#define RT_ARENA_BASE (1024 * 1024)        // Arena bytes, plus RT_ARENA_PER_CABIN per cabin and extras
+#define RT_ARENA_PER_CABIN 768             // Cabin store, event rings, snapshots, sensor rings
+#define RT_REPORT_DELAY_US 200000          // Startup report after threads have started
+
+// Startup
+int rt_init(int num_cabins, size_t extra_bytes);
+bool rt_enabled();
+
+// Threads: attributes for pthread_create(), then rt_thread_start() as the
+// first thing the new thread does and rt_thread_stop() the last
+void rt_thread_attr_init(pthread_attr_t* attr, size_t stack_size);
+void rt_thread_start(const char* name);
+void rt_thread_stop();
+
+// Runtime buffers: from the arena in RT mode, the heap otherwise. Zeroed
+// and cache-line aligned.
+void* rt_alloc(size_t bytes);
+void rt_free(void* p);
+
+// RSS, arena use, page faults and per-thread stack high-water marks
+void rt_report(const char* when);
+
+#endif // RT_H
@@ -3,17 +3,35 @@
 
 #include "common.h"
 
+// Scheduling Configuration
+#define SCHED_EDF_MAX_POINTS 100000  // Most deadlines the EDF admission test checks
+
 // Scheduler Functions
 void scheduler_init();
-int scheduler_add_task(const char* name, int priority, void* (*task_func)(void*));
+void scheduler_use_executor(bool enabled);
+void scheduler_use_edf(bool enabled);
+int scheduler_add_task(const char* name, int priority, TaskStep step, const TaskTiming* timing);
 void scheduler_start();
 void scheduler_stop();
+void scheduler_subscribe(int task_id, uint32_t events);
+bool scheduler_wait_next_period(Task* self);
+void scheduler_advance_release(Task* task, uint64_t release_ns, uint64_t now_ns);
+void scheduler_record_release(Task* task, uint64_t jitter_ns);
+void scheduler_record_wakeup(Task* task, uint64_t latency_ns);
+void scheduler_job_release(Task* task, uint64_t release_ns);
+void scheduler_job_start(Task* task);
+void scheduler_job_finish(Task* task);
+void scheduler_notify(uint32_t events);
+void scheduler_wait_event(Task* self);
+bool scheduler_dispatch_acquire(Task* self);
+void scheduler_dispatch_release(Task* self);
+void scheduler_preempt_point(Task* self);
 Task* scheduler_get_highest_priority_task();
 void scheduler_preempt(int new_priority);
 void scheduler_task_complete(int task_id);
 void scheduler_print_status();
 
 // Task Registration
-void register_all_tasks();
+int register_all_tasks();
 
 #endif // SCHEDULER_H
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include "common.h"
+
+// Sensor Configuration (--sensors RATE): every cabin keeps the last
+// SENSOR_WINDOW samples of each sensor in a fixed ring, and a periodic
+// task turns each window into min/max/mean, tracks the rate of rise of
+// the mean and checks the alarm rules below. Samples are fixed point:
+// smoke obscuration in 0.1 %/m, temperature in 0.1 Celsius.
+#define SENSOR_WINDOW 32                 // Samples per window (power of two)
+#define SENSOR_EVAL_PERIOD_US 20000      // Window evaluation and alarm rules
+#define SENSOR_WINDOW_RETRIES 3          // Window re-reads while a sample lands
+#define SENSOR_RISE_TAU_S 10.0f          // Rise = (mean - slow average) / tau
+
+// Alarm rules. A fire alarm raises handle_fire_alert() on any of: dense
+// smoke, a fixed heat limit, or a fast rise well above the setpoint (as
+// fixed/rate-of-rise heat detectors do; the HVAC alone never drives the
+// temperature far past it). An overheated cabin gets its setpoint
+// lowered through adjust_temperature(). Each rule fires once, then
+// re-arms below its clear level.
+#define SENSOR_SMOKE_ALARM 40            // Mean obscuration, 0.1 %/m
+#define SENSOR_SMOKE_CLEAR 20
+#define SENSOR_HEAT_ALARM 570            // Peak temperature, 0.1 Celsius
+#define SENSOR_RISE_ALARM 8.0f           // Celsius per minute...
+#define SENSOR_RISE_MARGIN 50            // ...above setpoint + 5.0 Celsius
+#define SENSOR_HOT 300                   // Mean temperature, 0.1 Celsius
+#define SENSOR_HOT_CLEAR 270
+#define SENSOR_COOL_SETPOINT 22          // Celsius, for hot cabins
+
+// Synthetic source: RATE samples/s spread over every cabin and sensor,
+// produced in batches every tick; --sensor-fire N makes cabin N burn
+#define SENSOR_SYNTH_TICK_US 1000
+#define SENSOR_SYNTH_MAX_CATCHUP 10      // Ticks made up after a stall, at most
+#define SENSOR_SYNTH_FIRE_DELAY_S 1      // From source start to ignition
+#define SENSOR_SYNTH_SMOKE_RISE 10.0f    // Fire growth: 0.1 %/m per second...
+#define SENSOR_SYNTH_HEAT_RISE 15.0f     // ...and Celsius per minute
+
+typedef enum {
+    SENSOR_SMOKE = 0,
+    SENSOR_TEMP = 1,
+    NUM_SENSOR_KINDS
+} SensorKind;
+
+// Statistics over one cabin's window
+typedef struct {
+    int min;
+    int max;
+    float mean;
+} SensorStats;
+
+// Sensor Functions
+int sensors_init(int num_cabins);
+bool sensors_enabled();
+void sensor_ingest(int cabin_id, SensorKind kind, int16_t value);
+bool sensor_window(int cabin_id, SensorKind kind, SensorStats* out);
+void sensors_evaluate(Task* self);
+void sensors_print_stats();
+
+// Synthetic source thread
+int sensors_source_start(double rate, int fire_cabin);
+void sensors_source_stop();
+
+#endif // SENSORS_H
@@ -0,0 +1,47 @@
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#include "common.h"
+#include "cabins.h"
+
+// Shard Configuration (--shards N): each shard thread exclusively owns a
+// contiguous range of 64-cabin words and is the only writer of those
+// cabins, so it applies updates without stripe locks (each shard
+// publishes through its own seqlock section instead of its stripes', see
+// state.h). Updates reach the owner through its inbox, a bounded MPSC
+// ring; operations on a range of cabins go to every shard owning part of
+// it and complete when the last one has handled its part.
+#define SHARD_MAX 8
+#define SHARD_INBOX_CAPACITY 1024   // Power of two
+#define SHARD_FANOUT_SLOTS 4        // Range posts in flight at once
+
+// Startup and teardown. shards_init() clamps the count to the cabin words
+// and SHARD_MAX (0 leaves sharding off) and is called before any thread
+// starts; shards_stop() handles everything already posted, then joins.
+int shards_init(int requested);
+int shards_start();
+void shards_stop();
+int shards_count();  // 0 when sharding is off
+bool shards_enabled();
+
+// Ownership: shard of a cabin, and the cabins [first, end) a shard owns
+int shard_of(int cabin_id);
+void shard_range(int shard, int* first, int* end);
+
+// Updates: queue an operation for the cabin's owner, or for each cabin in
+// [first, end) (done() runs on the shard that finishes last, with the
+// number of cabins changed, see cabins_apply_range())
+void shards_post(int cabin_id, CabinOp op, int value);
+void shards_post_range(int first, int end, CabinOp op, int value,
+                       void (*done)(CabinOp op, int value, int total));
+
+// Thermal control step of every cabin, each shard stepping its own words
+// (a tick still pending on a shard is coalesced)
+void shards_thermal_tick();
+
+// Wait until everything posted so far has been handled
+void shards_sync();
+
+void shards_print_stats();
+
+#endif // SHARDS_H
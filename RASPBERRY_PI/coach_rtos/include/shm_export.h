@@ -0,0 +1,17 @@
+#ifndef SHM_EXPORT_H
+#define SHM_EXPORT_H
+
+#include "common.h"
+#include "shm_layout.h"
+
+// State Export Configuration: a copy of the coach state is published to
+// a POSIX shared-memory segment (layout in shm_layout.h) every period
+#define SHM_EXPORT_PERIOD_US 20000
+
+// State Export Functions
+int shm_export_open(const char* name);
+bool shm_export_enabled();
+void shm_export_publish();
+void shm_export_close();
+
+#endif // SHM_EXPORT_H
@@ -0,0 +1,64 @@
+#ifndef SHM_LAYOUT_H
+#define SHM_LAYOUT_H
+
+#include <stdint.h>
+
+// Binary layout of the shared-memory state export (--shm NAME), shared by
+// the publisher (shm_export.c) and external readers (tools/coach_shm.h).
+// Fixed-width fields only; bump COACH_SHM_VERSION on any layout change.
+//
+// The segment is a CoachShmHeader, then num_cabins CoachShmCabin entries
+// at header_size. The publisher brackets every update with `sequence`
+// (odd while writing); readers copy and retry until they see the same
+// even value before and after.
+#define COACH_SHM_MAGIC 0x314d5343u   // "CSM1"
+#define COACH_SHM_VERSION 1
+#define COACH_SHM_DEFAULT_NAME "/coach_rtos"
+#define COACH_SHM_MAX_TASKS 16
+#define COACH_SHM_TASK_NAME_LEN 32
+
+// Per-task counters
+typedef struct {
+    char name[COACH_SHM_TASK_NAME_LEN];
+    int32_t priority;
+    int32_t state;                  // TaskState
+    uint64_t execution_count;
+    uint64_t preempt_count;
+    uint64_t wakeup_count;          // Event tasks
+    uint64_t wakeup_latency_max_ns;
+    uint64_t period_us;             // Periodic tasks (0: event-driven)
+    uint64_t release_count;
+    uint64_t missed_releases;
+    uint64_t jitter_max_ns;
+} CoachShmTask;
+
+// One cabin
+typedef struct {
+    uint8_t light_on;
+    uint8_t state;                  // CabinState
+    int16_t temperature;            // Celsius
+    int16_t setpoint;               // Celsius
+    int16_t reserved;
+} CoachShmCabin;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;           // Offset of the cabin array
+    uint32_t sequence;              // Odd while the publisher is writing
+    uint32_t pid;                   // Publishing process
+    uint64_t publish_count;
+    uint64_t publish_ns;            // CLOCK_MONOTONIC time of the last publish
+    uint32_t state_version;         // Coach state version the copy was taken at
+    uint8_t system_running;         // 0 once the publisher has shut down
+    uint8_t power_low;
+    uint8_t chain_pulled;
+    uint8_t reserved;
+    int32_t fire_cabins;
+    int32_t emergency_cabins;
+    uint32_t num_cabins;
+    uint32_t num_tasks;
+    CoachShmTask tasks[COACH_SHM_MAX_TASKS];
+} CoachShmHeader;
+
+#endif // SHM_LAYOUT_H
@@ -0,0 +1,24 @@
+#ifndef SHUTDOWN_H
+#define SHUTDOWN_H
+
+#include "common.h"
+
+// Shutdown Configuration: one eventfd latch, written once on SIGINT/SIGTERM
+// (or an internal request) and readable from then on, is polled by every
+// blocking wait so all threads see the stop at once
+#define SHUTDOWN_BUDGET_MS 10    // Target from request to last thread joined
+#define SHUTDOWN_MAX_PHASES 12
+
+// Shutdown Functions
+int shutdown_init();
+void shutdown_request(int sig);
+bool shutdown_requested();
+int shutdown_fd();
+void shutdown_wait();
+bool shutdown_sleep_until(const struct timespec* deadline);
+
+// Latency report: phases are marked by the main thread as it tears down
+void shutdown_mark(const char* phase);
+void shutdown_report();
+
+#endif // SHUTDOWN_H
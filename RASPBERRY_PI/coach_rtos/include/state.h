@@ -0,0 +1,48 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include "common.h"
+
+// Snapshot Configuration
+#define STATE_SNAPSHOT_BUFFERS 4  // Snapshots held at once without allocating
+
+// Copy of one cabin's displayable state
+typedef struct {
+    bool light_on;
+    bool light_shed;  // Off for the power budget (see power.h)
+    bool hvac_on;
+    int temperature;
+    int setpoint;
+    CabinState state;
+} CabinView;
+
+// Copy of the cabins and system flags: the flags and each lock stripe's
+// (or with --shards each shard's) cabins are each consistent, see
+// state_snapshot()
+typedef struct {
+    uint32_t sequence;
+    bool system_running;
+    bool power_low;
+    bool chain_pulled;
+    int fire_cabins;       // Cabins in STATE_FIRE / STATE_EMERGENCY
+    int emergency_cabins;
+    int num_cabins;
+    CabinView* cabins;  // num_cabins entries, owned by the snapshot
+} StateSnapshot;
+
+// Writers bracket every change to cabins or flags; readers never lock.
+// Flag writes go through state_write_begin()/end(); cabin writes go
+// through state_cabin_write_begin()/end(), which bump the sequence of
+// the cabin's lock stripe (or with --shards its shard).
+void state_init();
+void state_write_begin();
+void state_write_end();
+void state_cabin_write_begin(int cabin_id);
+void state_cabin_write_end(int cabin_id);
+int state_snapshot_pool_init();
+int state_snapshot_alloc(StateSnapshot* snap);
+void state_snapshot_free(StateSnapshot* snap);
+void state_snapshot(StateSnapshot* out);
+void state_read_cabin(int cabin_id, CabinView* out);
+
+#endif // STATE_H
@@ -3,21 +3,24 @@
 
 #include "common.h"
 
-// Task Function Prototypes
-void* fire_emergency_task(void* arg);
-void* passenger_emergency_task(void* arg);
-void* chain_pull_task(void* arg);
-void* power_management_task(void* arg);
-void* temperature_regulation_task(void* arg);
-void* lighting_control_task(void* arg);
-void* display_task(void* arg);
-void* logging_task(void* arg);
+// Task Steps
+bool fire_emergency_step(Task* self);
+bool passenger_emergency_step(Task* self);
+bool chain_pull_step(Task* self);
+bool power_management_step(Task* self);
+bool temperature_regulation_step(Task* self);
+bool lighting_control_step(Task* self);
+bool display_step(Task* self);
+bool logging_step(Task* self);
+bool state_export_step(Task* self);
+bool sensor_alarm_step(Task* self);
+bool peer_publish_step(Task* self);
 
 // Task Helper Functions
 void handle_fire_alert(int cabin_id);
 void handle_emergency(int cabin_id);
 void handle_chain_pull();
-void handle_power_low();
+void handle_power_level(int percent);
 void adjust_temperature(int cabin_id, int target_temp);
 void control_light(int cabin_id, bool on);
 
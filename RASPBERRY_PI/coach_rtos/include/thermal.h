@@ -0,0 +1,25 @@
+#ifndef THERMAL_H
+#define THERMAL_H
+
+#include "common.h"
+#include <math.h>
+
+// Thermal Control Configuration: every cabin is a first-order plant
+// (HVAC output minus heat exchange with the outside) driven by a PID
+// controller, stepped at a fixed rate so runs are reproducible
+#define THERMAL_PERIOD_US 100000   // One control step for all cabins
+#define THERMAL_DT (THERMAL_PERIOD_US / 1e6f)
+#define THERMAL_KP 0.8f
+#define THERMAL_KI 0.05f
+#define THERMAL_KD 0.2f
+#define THERMAL_MAX_RATE 1.0f      // HVAC heating/cooling limit, Celsius/s
+#define THERMAL_AMBIENT 32.0f      // Outside temperature, Celsius
+#define THERMAL_LOSS 0.01f         // Heat exchange with outside, 1/s
+#define THERMAL_TOLERANCE 0.25f    // Converged within this of the setpoint...
+#define THERMAL_SETTLED_RATE 0.05f // ...and changing slower than this, Celsius/s
+
+// Thermal Control Functions
+int thermal_step_word(CabinStore* store, int word, float dt);
+int thermal_step_all(CabinStore* store, float dt);
+
+#endif // THERMAL_H
@@ -0,0 +1,50 @@
+#ifndef USB_LISTENER_H
+#define USB_LISTENER_H
+
+#include "common.h"
+
+// Ingestion Configuration
+#define INGEST_BUFFER_SIZE 4096  // Read buffer; also the longest accepted line
+#define SERIAL_BAUDRATE B115200
+
+// Binary framing, accepted alongside text lines at any record boundary:
+//   [FRAME_SYNC][len][payload: len bytes][crc8 over len + payload]
+// CRC-8 uses polynomial 0x07, initial value 0x00.
+#define FRAME_SYNC 0xA5
+#define FRAME_MAX_PAYLOAD 32
+#define FRAME_OVERHEAD 3
+
+// Called once per complete line, NUL-terminated in place in the read buffer
+typedef void (*IngestLineHandler)(char* line, size_t len, void* ctx);
+
+// Called once per binary frame whose CRC checked out
+typedef void (*IngestFrameHandler)(const uint8_t* payload, size_t len, void* ctx);
+
+// Ingestion state for one input stream
+typedef struct {
+    char buffer[INGEST_BUFFER_SIZE];
+    size_t used;
+    bool discarding;      // Dropping the rest of an over-long line
+    IngestLineHandler on_line;
+    IngestFrameHandler on_frame;  // NULL: text only
+    void* ctx;
+    uint64_t read_ns;     // When the bytes being parsed were read
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t frames;
+    uint64_t frame_errors;
+    uint64_t overflows;
+} IngestState;
+
+// Ingestion Functions
+void ingest_init(IngestState* st, IngestLineHandler on_line, IngestFrameHandler on_frame, void* ctx);
+ssize_t ingest_read(IngestState* st, int fd);
+uint8_t frame_crc8(const uint8_t* data, size_t len);
+size_t frame_encode(const uint8_t* payload, size_t len, uint8_t* out);
+int usb_listener_open(const char* device);
+void usb_listener_close(int fd);
+
+// Listener thread; arg is the serial device path, or NULL for stdin
+void* usb_listener_thread(void* arg);
+
+#endif // USB_LISTENER_H
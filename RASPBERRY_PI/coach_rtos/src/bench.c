@@ -0,0 +1,1292 @@
+#include "bench.h"
+#include "log_ring.h"
+#include "usb_listener.h"
+#include "commands.h"
+#include "display.h"
+#include "cabins.h"
+#include "state.h"
+#include "metrics.h"
+#include "thermal.h"
+#include "locks.h"
+#include "events.h"
+#include "scheduler.h"
+#include "shards.h"
+#include "sensors.h"
+#include "power.h"
+#include "peer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <math.h>
+
+// A built-in benchmark: runs in-process and prints its own results
+typedef struct {
+    const char* name;
+    const char* description;
+    int (*run)();
+} BenchEntry;
+
+// Log ring benchmark state
+static volatile bool log_consumer_running = false;
+
+// Drain the log ring into /dev/null while producers run
+static void* log_consumer_thread(void* arg) {
+    FILE* sink = (FILE*)arg;
+    
+    while (log_consumer_running) {
+        if (log_ring_drain(sink) == 0) {
+            usleep(100);
+        }
+    }
+    log_ring_drain(sink);
+    
+    return NULL;
+}
+
+// Push a fixed number of records from one producer thread
+static void* log_producer_thread(void* arg) {
+    long iterations = (long)arg;
+    
+    for (long i = 0; i < iterations; i++) {
+        log_message("Light %s in Cabin %d", "ON", (int)(i % DEFAULT_NUM_CABINS));
+    }
+    
+    return NULL;
+}
+
+// Time `producers` threads each enqueueing `iterations` records
+static double log_bench_round(int producers, long iterations, bool with_consumer) {
+    FILE* sink = fopen("/dev/null", "w");
+    pthread_t consumer;
+    pthread_t threads[8];
+    
+    log_ring_init();
+    
+    if (with_consumer) {
+        log_consumer_running = true;
+        pthread_create(&consumer, NULL, log_consumer_thread, sink);
+    }
+    
+    uint64_t start = monotonic_now_ns();
+    for (int t = 0; t < producers; t++) {
+        pthread_create(&threads[t], NULL, log_producer_thread, (void*)iterations);
+    }
+    for (int t = 0; t < producers; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    uint64_t elapsed = monotonic_now_ns() - start;
+    
+    if (with_consumer) {
+        log_consumer_running = false;
+        pthread_join(consumer, NULL);
+    } else {
+        log_ring_drain(sink);
+    }
+    fclose(sink);
+    
+    return (double)elapsed / (double)iterations;
+}
+
+// Time only accepted enqueues: bursts of half a ring, drained untimed
+static double log_bench_accepted(long iterations) {
+    FILE* sink = fopen("/dev/null", "w");
+    const long burst = LOG_RING_CAPACITY / 2;
+    uint64_t elapsed = 0;
+    
+    log_ring_init();
+    
+    for (long done = 0; done < iterations; done += burst) {
+        uint64_t start = monotonic_now_ns();
+        for (long i = 0; i < burst; i++) {
+            log_message("Light %s in Cabin %d", "ON", (int)(i % DEFAULT_NUM_CABINS));
+        }
+        elapsed += monotonic_now_ns() - start;
+        log_ring_drain(sink);
+    }
+    fclose(sink);
+    
+    return (double)elapsed / (double)iterations;
+}
+
+// Log enqueue cost: accepted, contended and ring-full (drop) paths
+static int bench_log() {
+    const long iterations = 1000000;
+    const int producer_counts[] = { 1, 2, 4 };
+    
+    printf("Log ring enqueue cost (%ld records per producer)\n", iterations);
+    printf("%-30s %-10s %-14s %-12s\n", "Mode", "Producers", "ns/enqueue", "Dropped");
+    
+    double ns = log_bench_accepted(iterations);
+    printf("%-30s %-10d %-14.1f %-12lu\n", "accepted (bursts, no drops)", 1, ns, log_ring_dropped());
+    
+    for (size_t i = 0; i < sizeof(producer_counts) / sizeof(producer_counts[0]); i++) {
+        int producers = producer_counts[i];
+        
+        ns = log_bench_round(producers, iterations, true);
+        printf("%-30s %-10d %-14.1f %-12lu\n", "saturated, consumer draining", producers, ns, log_ring_dropped());
+        
+        ns = log_bench_round(producers, iterations, false);
+        printf("%-30s %-10d %-14.1f %-12lu\n", "ring full (drop path)", producers, ns, log_ring_dropped());
+    }
+    
+    return 0;
+}
+
+// Ingest benchmark: a writer thread streams command lines into a pipe
+typedef struct {
+    int fd;
+    long lines;
+} IngestWriter;
+
+static const char* ingest_sample_lines[] = {
+    "LIGHT 3 ON\n", "TEMP 7 22\n", "FIRE 2\n", "EMERGENCY 9\n", "LIGHT 4 OFF\n",
+    "POWER LOW\n", "TEMP 0 19\n", "CHAIN PULL\n",
+};
+
+#define NUM_INGEST_SAMPLES (sizeof(ingest_sample_lines) / sizeof(ingest_sample_lines[0]))
+
+static void* ingest_writer_thread(void* arg) {
+    IngestWriter* w = (IngestWriter*)arg;
+    char block[16384];
+    size_t used = 0;
+    
+    for (long i = 0; i < w->lines; i++) {
+        const char* line = ingest_sample_lines[i % NUM_INGEST_SAMPLES];
+        size_t len = strlen(line);
+        
+        if (used + len > sizeof(block)) {
+            if (write(w->fd, block, used) < 0) break;
+            used = 0;
+        }
+        memcpy(block + used, line, len);
+        used += len;
+    }
+    if (used > 0 && write(w->fd, block, used) < 0) {
+        perror("write");
+    }
+    close(w->fd);
+    
+    return NULL;
+}
+
+// Count lines and touch the command so the parse is not optimized away
+static void ingest_count_line(char* line, size_t len, void* ctx) {
+    uint64_t* checksum = (uint64_t*)ctx;
+    *checksum += (uint64_t)line[0] + len;
+}
+
+// Command intake rate through poll() + non-blocking in-place line parsing
+static int bench_ingest() {
+    const long lines = 2000000;
+    int fds[2];
+    
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    
+    static IngestState st;
+    uint64_t checksum = 0;
+    ingest_init(&st, ingest_count_line, NULL, &checksum);
+    
+    IngestWriter writer = { fds[1], lines };
+    pthread_t writer_thread;
+    uint64_t start = monotonic_now_ns();
+    pthread_create(&writer_thread, NULL, ingest_writer_thread, &writer);
+    
+    for (;;) {
+        struct pollfd pfd = { .fd = fds[0], .events = POLLIN };
+        if (poll(&pfd, 1, 1000) <= 0) break;
+        
+        ssize_t n = ingest_read(&st, fds[0]);
+        if (n == 0 || (n < 0 && errno != EAGAIN)) break;
+    }
+    
+    uint64_t elapsed = monotonic_now_ns() - start;
+    pthread_join(writer_thread, NULL);
+    close(fds[0]);
+    
+    double seconds = elapsed / 1e9;
+    printf("Pipe ingestion: %lu lines, %lu bytes in %.3f s\n", st.lines, st.bytes, seconds);
+    printf("  %.0f commands/s, %.1f MB/s, %.1f ns/command (checksum %lu)\n",
+           st.lines / seconds, st.bytes / seconds / 1e6, elapsed / (double)st.lines, checksum);
+    
+    return st.lines == (uint64_t)lines ? 0 : 1;
+}
+
+// The parser this tree used before the command table, kept for comparison
+static int legacy_sscanf_parse(const char* line, Command* cmd) {
+    char word[32], param1[32], param2[32];
+    int n = sscanf(line, "%31s %31s %31s", word, param1, param2);
+    
+    cmd->opcode = OP_INVALID;
+    if (n < 2) return -1;
+    
+    if (strcmp(word, "LIGHT") == 0) {
+        cmd->opcode = OP_LIGHT;
+        cmd->cabin = atoi(param1);
+        cmd->value = (n >= 3 && strcmp(param2, "ON") == 0);
+    } else if (strcmp(word, "TEMP") == 0) {
+        cmd->opcode = OP_TEMP;
+        cmd->cabin = atoi(param1);
+        cmd->value = atoi(param2);
+    } else if (strcmp(word, "EMERGENCY") == 0) {
+        cmd->opcode = OP_EMERGENCY;
+        cmd->cabin = atoi(param1);
+    } else if (strcmp(word, "FIRE") == 0) {
+        cmd->opcode = OP_FIRE;
+        cmd->cabin = atoi(param1);
+    } else if (strcmp(word, "POWER") == 0) {
+        cmd->opcode = OP_POWER;
+    } else if (strcmp(word, "CHAIN") == 0) {
+        cmd->opcode = OP_CHAIN;
+    }
+    
+    return cmd->opcode == OP_INVALID ? -1 : 0;
+}
+
+// Decode cost per command: text table parser, binary frames, old sscanf path
+static int bench_decode() {
+    const long iterations = 4000000;
+    uint8_t frames[NUM_INGEST_SAMPLES][FRAME_MAX_PAYLOAD + FRAME_OVERHEAD];
+    size_t frame_len[NUM_INGEST_SAMPLES];
+    char lines[NUM_INGEST_SAMPLES][32];
+    size_t line_len[NUM_INGEST_SAMPLES];
+    Command cmd;
+    const char* error;
+    uint64_t checksum = 0;
+    
+    // Pre-build both encodings of the sample command mix
+    for (size_t i = 0; i < NUM_INGEST_SAMPLES; i++) {
+        line_len[i] = strcspn(ingest_sample_lines[i], "\n");
+        memcpy(lines[i], ingest_sample_lines[i], line_len[i]);
+        lines[i][line_len[i]] = '\0';
+        
+        if (command_parse_text(lines[i], line_len[i], &cmd, &error) != 0) {
+            fprintf(stderr, "Sample '%s' does not parse: %s\n", lines[i], error);
+            return 1;
+        }
+        uint8_t payload[COMMAND_PAYLOAD_SIZE];
+        size_t payload_len = command_encode_binary(&cmd, payload);
+        frame_len[i] = frame_encode(payload, payload_len, frames[i]);
+    }
+    
+    printf("%-28s %-12s %-10s\n", "Decoder", "ns/command", "Bytes");
+    
+    uint64_t start = monotonic_now_ns();
+    for (long n = 0; n < iterations; n++) {
+        size_t i = n % NUM_INGEST_SAMPLES;
+        if (command_parse_text(lines[i], line_len[i], &cmd, &error) == 0) checksum += cmd.value;
+    }
+    double text_ns = (monotonic_now_ns() - start) / (double)iterations;
+    printf("%-28s %-12.1f %-10s\n", "text (table dispatch)", text_ns, "7-15");
+    
+    start = monotonic_now_ns();
+    for (long n = 0; n < iterations; n++) {
+        size_t i = n % NUM_INGEST_SAMPLES;
+        const uint8_t* f = frames[i];
+        if (frame_crc8(f + 1, f[1] + 1) == f[frame_len[i] - 1] &&
+            command_decode_binary(f + 2, f[1], &cmd, &error) == 0) {
+            checksum += cmd.value;
+        }
+    }
+    double binary_ns = (monotonic_now_ns() - start) / (double)iterations;
+    printf("%-28s %-12.1f %-10zu\n", "binary frame (CRC + decode)", binary_ns, frame_len[0]);
+    
+    start = monotonic_now_ns();
+    for (long n = 0; n < iterations; n++) {
+        size_t i = n % NUM_INGEST_SAMPLES;
+        if (legacy_sscanf_parse(lines[i], &cmd) == 0) checksum += cmd.value;
+    }
+    double legacy_ns = (monotonic_now_ns() - start) / (double)iterations;
+    printf("%-28s %-12.1f %-10s\n", "sscanf + strcmp (old)", legacy_ns, "7-15");
+    
+    printf("(checksum %lu)\n", checksum);
+    return 0;
+}
+
+// Render `frames` frames, changing one cabin per frame; full_redraw clears
+// and redraws everything each frame the way the renderer used to
+static void fb_bench_round(int frames, bool full_redraw, DisplayStats* out) {
+    display_reset_stats();
+    
+    for (int f = 0; f < frames; f++) {
+        uint8_t* state = &g_system.cabins.state[f % DISPLAY_MAX_CABINS];
+        *state = (*state == STATE_NORMAL) ? STATE_LIGHT_ON : STATE_NORMAL;
+        
+        if (full_redraw) {
+            display_clear();
+            display_header();
+        }
+        display_update();
+    }
+    
+    display_get_stats(out);
+}
+
+// Framebuffer renderer: dirty-rectangle updates vs full redraws, rendered
+// into an in-memory 480x320 RGB565 framebuffer with padded rows
+static int bench_fb() {
+    const int frames = 20000;
+    const size_t line_length = DISPLAY_WIDTH * sizeof(uint16_t) + 64;
+    uint8_t* fake_fb = calloc(DISPLAY_HEIGHT, line_length);
+    
+    if (!fake_fb || display_attach_buffer(fake_fb, DISPLAY_WIDTH, DISPLAY_HEIGHT, line_length) != 0) {
+        free(fake_fb);
+        return 1;
+    }
+    display_update();
+    
+    DisplayStats dirty, full;
+    fb_bench_round(frames, false, &dirty);
+    fb_bench_round(frames, true, &full);
+    
+    printf("%-16s %-10s %-14s %-14s %-14s\n", "Mode", "Frames", "Avg frame us", "Max frame us", "Bytes/frame");
+    printf("%-16s %-10lu %-14.2f %-14.2f %-14.0f\n", "dirty rects", dirty.frames,
+           dirty.frame_time_total_ns / (double)dirty.frames / 1000.0, dirty.frame_time_max_ns / 1000.0,
+           dirty.bytes_total / (double)dirty.frames);
+    printf("%-16s %-10lu %-14.2f %-14.2f %-14.0f\n", "full redraw", full.frames,
+           full.frame_time_total_ns / (double)full.frames / 1000.0, full.frame_time_max_ns / 1000.0,
+           full.bytes_total / (double)full.frames);
+    
+    display_cleanup();
+    free(fake_fb);
+    return 0;
+}
+
+// Terminal renderer: idle frames, one cabin changing per frame, and full
+// redraws, with ANSI cursor addressing into /dev/null
+static int bench_term() {
+    const int frames = 20000;
+    int fd = open("/dev/null", O_WRONLY);
+    
+    if (fd < 0) return 1;
+    display_attach_terminal(fd, true);
+    display_update();
+    
+    DisplayStats idle, changed, full;
+    display_reset_stats();
+    for (int f = 0; f < frames; f++) {
+        display_update();
+    }
+    display_get_stats(&idle);
+    fb_bench_round(frames, false, &changed);
+    fb_bench_round(frames, true, &full);
+    
+    const DisplayStats* rounds[] = { &idle, &changed, &full };
+    const char* names[] = { "idle", "changed rows", "full redraw" };
+    
+    printf("%-16s %-10s %-14s %-14s %-12s %-14s\n", "Mode", "Frames", "Avg frame us", "Max frame us",
+           "Rows/frame", "Bytes/frame");
+    for (int i = 0; i < 3; i++) {
+        const DisplayStats* r = rounds[i];
+        printf("%-16s %-10lu %-14.2f %-14.2f %-12.2f %-14.0f\n", names[i], r->frames,
+               r->frame_time_total_ns / (double)r->frames / 1000.0, r->frame_time_max_ns / 1000.0,
+               r->rows_total / (double)r->frames, r->bytes_total / (double)r->frames);
+    }
+    
+    display_cleanup();
+    close(fd);
+    return 0;
+}
+
+// Cabin layout before the SoA store: one struct and one mutex per cabin
+typedef struct {
+    int id;
+    bool light_on;
+    int temperature;
+    CabinState state;
+    pthread_mutex_t mutex;
+} LegacyCabin;
+
+// Same mix of cabin states in both layouts: every 7th cabin lit, every
+// 13th adjusting temperature
+static CabinState bench_cabin_state(int i) {
+    if (i % 13 == 0) return STATE_TEMP_ADJUST;
+    if (i % 7 == 0) return STATE_LIGHT_ON;
+    return STATE_NORMAL;
+}
+
+// Power-saving sweep, old layout: lock, test and update cabin by cabin
+static int legacy_lights_off(LegacyCabin* cabins, int count) {
+    int turned_off = 0;
+    
+    for (int i = 0; i < count; i++) {
+        pthread_mutex_lock(&cabins[i].mutex);
+        if ((cabins[i].state == STATE_NORMAL || cabins[i].state == STATE_LIGHT_ON) &&
+            cabins[i].light_on) {
+            state_write_begin();
+            cabins[i].light_on = false;
+            state_write_end();
+            turned_off++;
+        }
+        pthread_mutex_unlock(&cabins[i].mutex);
+    }
+    
+    return turned_off;
+}
+
+// Power-saving sweep, SoA layout: one state match, light mask update and
+// seqlock section per 64-cabin word
+static int soa_lights_off(CabinStore* store) {
+    int turned_off = 0;
+    
+    for (int w = 0; w < store->num_words; w++) {
+        cabin_lock(store, w * CABINS_PER_WORD);
+        uint64_t idle = cabins_state_mask(store, w, STATE_NORMAL) |
+                        cabins_state_mask(store, w, STATE_LIGHT_ON);
+        uint64_t off = store->light_bits[w] & idle;
+        if (off) {
+            state_cabin_write_begin(w * CABINS_PER_WORD);
+            store->light_bits[w] &= ~off;
+            state_cabin_write_end(w * CABINS_PER_WORD);
+        }
+        cabin_unlock(store, w * CABINS_PER_WORD);
+        turned_off += __builtin_popcountll(off);
+    }
+    
+    return turned_off;
+}
+
+// Temperature scan, old layout
+static int legacy_count_adjusting(LegacyCabin* cabins, int count) {
+    int adjusting = 0;
+    
+    for (int i = 0; i < count; i++) {
+        pthread_mutex_lock(&cabins[i].mutex);
+        if (cabins[i].state == STATE_TEMP_ADJUST) adjusting++;
+        pthread_mutex_unlock(&cabins[i].mutex);
+    }
+    
+    return adjusting;
+}
+
+// Bulk cabin passes at one coach, a full rake and a large fleet. Both
+// layouts start with the same lights on; later passes find nothing to
+// switch off, so they measure the scan itself.
+static int bench_cabins() {
+    const int counts[] = { 10, 500, 5000 };
+    const long cabins_per_pass = 20000000;
+    uint64_t checksum = 0;
+    
+    printf("Bytes per cabin: SoA %.1f (+%d lock stripes), struct %zu\n",
+           sizeof(int16_t) + sizeof(uint8_t) + 1.0 / 8.0, CABIN_LOCK_STRIPES, sizeof(LegacyCabin));
+    printf("%-8s %-20s %-14s %-14s %-8s\n", "Cabins", "Pass", "SoA ns/cabin", "Struct ns/cab", "Speedup");
+    
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int count = counts[c];
+        long passes = cabins_per_pass / count;
+        CabinStore store;
+        LegacyCabin* legacy = calloc(count, sizeof(LegacyCabin));
+        
+        if (!legacy || cabins_init(&store, count) != 0) {
+            free(legacy);
+            return 1;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            CabinState state = bench_cabin_state(i);
+            store.state[i] = state;
+            cabin_set_light(&store, i, state == STATE_LIGHT_ON);
+            legacy[i].id = i;
+            legacy[i].temperature = CABIN_DEFAULT_TEMP;
+            legacy[i].state = state;
+            legacy[i].light_on = state == STATE_LIGHT_ON;
+            pthread_mutex_init(&legacy[i].mutex, NULL);
+        }
+        
+        uint64_t start = monotonic_now_ns();
+        for (long p = 0; p < passes; p++) checksum += soa_lights_off(&store);
+        double soa_off = (monotonic_now_ns() - start) / (double)(passes * count);
+        
+        start = monotonic_now_ns();
+        for (long p = 0; p < passes; p++) checksum += legacy_lights_off(legacy, count);
+        double legacy_off = (monotonic_now_ns() - start) / (double)(passes * count);
+        
+        start = monotonic_now_ns();
+        for (long p = 0; p < passes; p++) checksum += cabins_count_state(&store, STATE_TEMP_ADJUST);
+        double soa_scan = (monotonic_now_ns() - start) / (double)(passes * count);
+        
+        start = monotonic_now_ns();
+        for (long p = 0; p < passes; p++) checksum += legacy_count_adjusting(legacy, count);
+        double legacy_scan = (monotonic_now_ns() - start) / (double)(passes * count);
+        
+        printf("%-8d %-20s %-14.2f %-14.2f %-8.1f\n", count, "power-low lights off",
+               soa_off, legacy_off, legacy_off / soa_off);
+        printf("%-8d %-20s %-14.2f %-14.2f %-8.1f\n", count, "temp-adjust scan",
+               soa_scan, legacy_scan, legacy_scan / soa_scan);
+        
+        for (int i = 0; i < count; i++) {
+            pthread_mutex_destroy(&legacy[i].mutex);
+        }
+        free(legacy);
+        cabins_destroy(&store);
+    }
+    
+    printf("(checksum %lu)\n", checksum);
+    return 0;
+}
+
+// Histogram record cost and percentile accuracy on a known distribution:
+// uniform 1..1000 us, so pN should read N * 10 us within bucket error
+static int bench_metrics() {
+    const long iterations = 10000000;
+    Histogram* h = calloc(1, sizeof(Histogram));
+    uint64_t x = 88172645463325252ULL;
+    
+    if (!h) return 1;
+    
+    uint64_t start = monotonic_now_ns();
+    for (long i = 0; i < iterations; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        histogram_record(h, 1000 + x % 999001);
+    }
+    double ns = (monotonic_now_ns() - start) / (double)iterations;
+    
+    printf("Histogram: %d buckets, %zu bytes\n", HISTOGRAM_BUCKETS, sizeof(Histogram));
+    printf("%-28s %-12.1f\n", "record (ns)", ns);
+    
+    const double percentiles[] = { 50.0, 90.0, 99.0 };
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        double expected = percentiles[i] * 10.0;
+        double got = histogram_percentile(h, percentiles[i]) / 1000.0;
+        printf("p%-27.0f %-12.1f (expected %.0f, error %+.1f%%)\n", percentiles[i], got,
+               expected, (got - expected) / expected * 100.0);
+    }
+    
+    free(h);
+    return 0;
+}
+
+// Thermal control step cost per cabin, and how many steps a step change
+// in setpoint (24 -> 19 C on every 13th cabin) takes to settle
+static int bench_thermal() {
+    const int counts[] = { 10, 500, 5000 };
+    const long cabins_per_run = 20000000;
+    
+    printf("%-8s %-14s %-14s %-14s\n", "Cabins", "ns/cabin-step", "us/step", "Settle (s)");
+    
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int count = counts[c];
+        long steps = cabins_per_run / count;
+        CabinStore store;
+        
+        if (cabins_init(&store, count) != 0) return 1;
+        
+        int adjusting = 0;
+        for (int i = 0; i < count; i++) {
+            if (bench_cabin_state(i) != STATE_TEMP_ADJUST) continue;
+            store.setpoint[i] = CABIN_DEFAULT_TEMP - 5;
+            store.state[i] = STATE_TEMP_ADJUST;
+            adjusting++;
+        }
+        
+        int settled = 0;
+        long settle_steps = 0;
+        while (settled < adjusting && settle_steps < 100000) {
+            settled += thermal_step_all(&store, THERMAL_DT);
+            settle_steps++;
+        }
+        
+        uint64_t start = monotonic_now_ns();
+        for (long s = 0; s < steps; s++) thermal_step_all(&store, THERMAL_DT);
+        uint64_t elapsed = monotonic_now_ns() - start;
+        
+        printf("%-8d %-14.2f %-14.2f %-14.1f\n", count, elapsed / (double)(steps * count),
+               elapsed / 1000.0 / steps, settle_steps * THERMAL_DT);
+        
+        int left = cabins_count_state(&store, STATE_TEMP_ADJUST);
+        cabins_destroy(&store);
+        if (left != 0) {
+            fprintf(stderr, "%d cabins never settled\n", left);
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+// Lock bench: the shared lock and how many rounds each thread takes it
+static Lock bench_lock;
+static long bench_lock_rounds;
+
+static void* lock_contender_thread(void* arg) {
+    (void)arg;
+    lock_thread_set("bench contender", 0);
+    
+    for (long i = 0; i < bench_lock_rounds; i++) {
+        lock_acquire(&bench_lock);
+        lock_release(&bench_lock);
+    }
+    
+    return NULL;
+}
+
+// Uncontended acquire/release cost of a plain mutex, a priority-inheritance
+// mutex and the profiled Lock wrapper; then the wrapper under contention
+static int bench_locks() {
+    const long iterations = 10000000;
+    const int threads = 4;
+    pthread_mutex_t plain = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_t inherit;
+    pthread_mutexattr_t attr;
+    
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&inherit, &attr);
+    pthread_mutexattr_destroy(&attr);
+    lock_init(&bench_lock, "bench");
+    
+    uint64_t start = monotonic_now_ns();
+    for (long i = 0; i < iterations; i++) {
+        pthread_mutex_lock(&plain);
+        pthread_mutex_unlock(&plain);
+    }
+    double plain_ns = (monotonic_now_ns() - start) / (double)iterations;
+    
+    start = monotonic_now_ns();
+    for (long i = 0; i < iterations; i++) {
+        pthread_mutex_lock(&inherit);
+        pthread_mutex_unlock(&inherit);
+    }
+    double inherit_ns = (monotonic_now_ns() - start) / (double)iterations;
+    
+    start = monotonic_now_ns();
+    for (long i = 0; i < iterations; i++) {
+        lock_acquire(&bench_lock);
+        lock_release(&bench_lock);
+    }
+    double profiled_ns = (monotonic_now_ns() - start) / (double)iterations;
+    
+    printf("%-28s %-12s\n", "Uncontended", "ns/acquire");
+    printf("%-28s %-12.1f\n", "pthread mutex", plain_ns);
+    printf("%-28s %-12.1f\n", "pthread PRIO_INHERIT", inherit_ns);
+    printf("%-28s %-12.1f\n", "Lock (profiled)", profiled_ns);
+    
+    pthread_t tids[threads];
+    bench_lock_rounds = iterations / threads / 4;
+    locks_reset();
+    
+    start = monotonic_now_ns();
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&tids[t], NULL, lock_contender_thread, NULL);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    double contended_ns = (monotonic_now_ns() - start) / (double)bench_lock.acquisitions;
+    
+    printf("%d threads: %.1f ns/acquire, %.1f%% contended, wait avg %.1f us, max %.1f us\n",
+           threads, contended_ns, 100.0 * bench_lock.contended / bench_lock.acquisitions,
+           bench_lock.contended ? bench_lock.wait_total_ns / (double)bench_lock.contended / 1000.0 : 0.0,
+           bench_lock.wait_max_ns / 1000.0);
+    
+    lock_destroy(&bench_lock);
+    pthread_mutex_destroy(&inherit);
+    return 0;
+}
+
+// Wakeup bench: FIRE bursts delivered to the fire handler while the
+// other event tasks sit idle. Broadcast is the old scheme (every task
+// waits on one condvar under the system mutex, so each FIRE wakes them
+// all); targeted is a condvar per task, signalled only for its events.
+#define WAKEUP_BENCH_ROUNDS 20000
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool pending;
+} WakeupSlot;
+
+static WakeupSlot wakeup_shared;
+static WakeupSlot wakeup_slots[MAX_TASKS];
+static bool wakeup_broadcast;
+static volatile bool wakeup_running;
+static int wakeup_acked;
+static uint64_t wakeup_signalled_ns;
+static Histogram wakeup_histogram;
+
+static void* wakeup_waiter_thread(void* arg) {
+    int id = (int)(intptr_t)arg;
+    WakeupSlot* slot = wakeup_broadcast ? &wakeup_shared : &wakeup_slots[id];
+    
+    pthread_mutex_lock(&slot->mutex);
+    while (wakeup_running) {
+        // Only the fire handler (waiter 0) ever has an event pending
+        if (id == 0 && slot->pending) {
+            histogram_record(&wakeup_histogram, monotonic_now_ns() - wakeup_signalled_ns);
+            slot->pending = false;
+            __atomic_fetch_add(&wakeup_acked, 1, __ATOMIC_RELEASE);
+        } else {
+            pthread_cond_wait(&slot->cond, &slot->mutex);
+        }
+    }
+    pthread_mutex_unlock(&slot->mutex);
+    return NULL;
+}
+
+static void wakeup_slot_init(WakeupSlot* slot) {
+    pthread_mutex_init(&slot->mutex, NULL);
+    pthread_cond_init(&slot->cond, NULL);
+    slot->pending = false;
+}
+
+static void wakeup_slot_destroy(WakeupSlot* slot) {
+    pthread_cond_destroy(&slot->cond);
+    pthread_mutex_destroy(&slot->mutex);
+}
+
+// One FIRE to the fire handler, then wait until it has woken
+static void wakeup_bench_signal(int round) {
+    WakeupSlot* slot = wakeup_broadcast ? &wakeup_shared : &wakeup_slots[0];
+    
+    pthread_mutex_lock(&slot->mutex);
+    slot->pending = true;
+    wakeup_signalled_ns = monotonic_now_ns();
+    if (wakeup_broadcast) {
+        pthread_cond_broadcast(&slot->cond);
+    } else {
+        pthread_cond_signal(&slot->cond);
+    }
+    pthread_mutex_unlock(&slot->mutex);
+    
+    while (__atomic_load_n(&wakeup_acked, __ATOMIC_ACQUIRE) <= round) {
+        sched_yield();
+    }
+}
+
+static int wakeup_bench_round(int waiters, bool broadcast) {
+    pthread_t threads[MAX_TASKS];
+    
+    wakeup_broadcast = broadcast;
+    wakeup_running = true;
+    wakeup_acked = 0;
+    histogram_reset(&wakeup_histogram);
+    wakeup_slot_init(&wakeup_shared);
+    for (int i = 0; i < waiters; i++) {
+        wakeup_slot_init(&wakeup_slots[i]);
+    }
+    
+    for (int i = 0; i < waiters; i++) {
+        if (pthread_create(&threads[i], NULL, wakeup_waiter_thread, (void*)(intptr_t)i) != 0) {
+            return 1;
+        }
+    }
+    usleep(10000);
+    
+    for (int r = 0; r < WAKEUP_BENCH_ROUNDS; r++) {
+        wakeup_bench_signal(r);
+    }
+    
+    wakeup_running = false;
+    for (int i = 0; i < waiters; i++) {
+        WakeupSlot* slot = broadcast ? &wakeup_shared : &wakeup_slots[i];
+        pthread_mutex_lock(&slot->mutex);
+        pthread_cond_broadcast(&slot->cond);
+        pthread_mutex_unlock(&slot->mutex);
+    }
+    for (int i = 0; i < waiters; i++) {
+        pthread_join(threads[i], NULL);
+        wakeup_slot_destroy(&wakeup_slots[i]);
+    }
+    wakeup_slot_destroy(&wakeup_shared);
+    
+    printf("%-8d %-10s %-10.1f %-10.1f %-10.1f %-10.1f\n", waiters, broadcast ? "broadcast" : "targeted",
+           wakeup_histogram.total / (double)wakeup_histogram.count / 1000.0,
+           histogram_percentile(&wakeup_histogram, 50) / 1000.0,
+           histogram_percentile(&wakeup_histogram, 99) / 1000.0,
+           wakeup_histogram.max / 1000.0);
+    return 0;
+}
+
+// FIRE-to-handler wakeup latency with the coach's four event tasks and
+// with a full task table waiting
+static int bench_wakeup() {
+    const int counts[] = { NUM_EVENT_KINDS, MAX_TASKS };
+    
+    printf("%d FIRE wakeups per row\n", WAKEUP_BENCH_ROUNDS);
+    printf("%-8s %-10s %-10s %-10s %-10s %-10s\n", "Waiters", "Wakeup", "Avg(us)", "p50(us)", "p99(us)", "Max(us)");
+    
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        if (wakeup_bench_round(counts[c], true) != 0 || wakeup_bench_round(counts[c], false) != 0) {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+// Event queue cost: post + take round trips across every cabin, then a
+// burst of duplicates for one cabin, which must coalesce into one event,
+// then one event for every cabin of a full rake at once, all of which
+// must be handled
+static int bench_events() {
+    const long iterations = 10000000;
+    const int burst = 1000;
+    const int cabins = MAX_CABINS;
+    Event event;
+    
+    if (events_init(g_system.cabins.count) != 0) return 1;
+    
+    uint64_t start = monotonic_now_ns();
+    for (long i = 0; i < iterations; i++) {
+        event_post(EVENT_KIND_FIRE, (int)(i % g_system.cabins.count));
+        event_take(EVENT_KIND_FIRE, &event);
+    }
+    double round_trip_ns = (monotonic_now_ns() - start) / (double)iterations;
+    
+    int accepted = 0;
+    for (int i = 0; i < burst; i++) {
+        accepted += event_post(EVENT_KIND_EMERGENCY, 3);
+    }
+    int handled = 0;
+    while (event_take(EVENT_KIND_EMERGENCY, &event)) {
+        handled++;
+    }
+    
+    events_destroy();
+    if (events_init(cabins) != 0) return 1;
+    
+    int fire_posted = 0;
+    for (int i = 0; i < cabins; i++) {
+        fire_posted += event_post(EVENT_KIND_FIRE, i);
+    }
+    fire_posted += event_post(EVENT_KIND_FIRE, EVENT_NO_CABIN);
+    int fire_handled = 0;
+    while (event_take(EVENT_KIND_FIRE, &event)) {
+        fire_handled++;
+    }
+    
+    printf("post + take: %.1f ns/event\n", round_trip_ns);
+    printf("%d duplicate posts for one cabin: %d queued, %d handled\n", burst, accepted, handled);
+    printf("one post per cabin (%d + coach-wide): %d queued, %d handled\n",
+           cabins, fire_posted, fire_handled);
+    
+    events_destroy();
+    return (handled == 1 && fire_posted == cabins + 1 && fire_handled == fire_posted) ? 0 : 1;
+}
+
+// Shard bench: updates per producer, and whether producers post to the
+// shards or apply under the stripes
+#define SHARD_BENCH_CABINS MAX_CABINS
+#define SHARD_BENCH_PRODUCERS 4
+static long shard_bench_updates;
+
+static void* shard_producer_thread(void* arg) {
+    unsigned seed = (unsigned)(uintptr_t)arg;
+    CabinStore* cabins = &g_system.cabins;
+    
+    for (long i = 0; i < shard_bench_updates; i++) {
+        int cabin = rand_r(&seed) % cabins->count;
+        CabinOp op = (i & 1) ? CABIN_OP_TEMP : CABIN_OP_LIGHT;
+        int value = (i & 1) ? 18 + (int)(i % 8) : (int)((i >> 1) & 1);
+        
+        if (shards_enabled()) {
+            shards_post(cabin, op, value);
+        } else {
+            cabin_lock(cabins, cabin);
+            cabin_apply(cabins, cabin, op, value);
+            cabin_unlock(cabins, cabin);
+        }
+    }
+    
+    return NULL;
+}
+
+// Full coach: thermal tick time and update throughput from
+// SHARD_BENCH_PRODUCERS threads, with stripe locks (0 shards) and with
+// 1..SHARD_MAX owner threads
+static int bench_shards() {
+    const int counts[] = { 0, 1, 2, 4, 8 };
+    const int ticks = 200;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    
+    cabins_destroy(&g_system.cabins);
+    if (cabins_init(&g_system.cabins, SHARD_BENCH_CABINS) != 0) return 1;
+    shard_bench_updates = 250000;
+    
+    printf("%d cabins, %d producers, %ld CPUs online\n", SHARD_BENCH_CABINS, SHARD_BENCH_PRODUCERS, cpus);
+    printf("%-10s %-14s %-16s\n", "Shards", "us/tick", "Mupdates/s");
+    
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        state_init();
+        if (shards_init(counts[c]) != 0) return 1;
+        if (shards_enabled() && shards_start() != 0) return 1;
+        
+        uint64_t start = monotonic_now_ns();
+        for (int t = 0; t < ticks; t++) {
+            if (shards_enabled()) {
+                shards_thermal_tick();
+                shards_sync();
+            } else {
+                thermal_step_all(&g_system.cabins, THERMAL_DT);
+            }
+        }
+        double tick_us = (monotonic_now_ns() - start) / 1000.0 / ticks;
+        
+        pthread_t tids[SHARD_BENCH_PRODUCERS];
+        start = monotonic_now_ns();
+        for (int t = 0; t < SHARD_BENCH_PRODUCERS; t++) {
+            pthread_create(&tids[t], NULL, shard_producer_thread, (void*)(uintptr_t)(t + 1));
+        }
+        for (int t = 0; t < SHARD_BENCH_PRODUCERS; t++) {
+            pthread_join(tids[t], NULL);
+        }
+        shards_sync();
+        double elapsed_s = (monotonic_now_ns() - start) / 1e9;
+        
+        char label[16];
+        snprintf(label, sizeof(label), counts[c] ? "%d" : "locked", shards_count());
+        printf("%-10s %-14.1f %-16.2f\n", label, tick_us,
+               SHARD_BENCH_PRODUCERS * shard_bench_updates / elapsed_s / 1e6);
+        shards_stop();
+    }
+    
+    shards_init(0);
+    cabins_destroy(&g_system.cabins);
+    return cabins_init(&g_system.cabins, DEFAULT_NUM_CABINS) != 0;
+}
+
+// Sensor ingestion cost per sample and window statistics cost per
+// window, over a full coach with every window filled
+static int bench_sensors() {
+    const int cabins = MAX_CABINS;
+    const int passes = 200;
+    
+    if (sensors_init(cabins) != 0) return 1;
+    
+    long samples = (long)cabins * SENSOR_WINDOW * 4;
+    uint64_t start = monotonic_now_ns();
+    for (long i = 0; i < samples; i++) {
+        int cabin = (int)(i % cabins);
+        sensor_ingest(cabin, SENSOR_SMOKE, (int16_t)(i & 63));
+        sensor_ingest(cabin, SENSOR_TEMP, (int16_t)(240 + (i & 7)));
+    }
+    double ingest_ns = (monotonic_now_ns() - start) / (double)(2 * samples);
+    
+    SensorStats stats;
+    int64_t checksum = 0;
+    start = monotonic_now_ns();
+    for (int p = 0; p < passes; p++) {
+        for (int c = 0; c < cabins; c++) {
+            sensor_window(c, SENSOR_SMOKE, &stats);
+            checksum += stats.max;
+            sensor_window(c, SENSOR_TEMP, &stats);
+            checksum += stats.min;
+        }
+    }
+    double window_ns = (monotonic_now_ns() - start) / (double)(2L * passes * cabins);
+    
+    printf("%-28s %-12s %-14s\n", "Operation", "ns/op", "Mops/s");
+    printf("%-28s %-12.1f %-14.1f\n", "ingest (one sample)", ingest_ns, 1e3 / ingest_ns);
+    printf("%-28s %-12.1f %-14.1f\n", "window stats (32 samples)", window_ns, 1e3 / window_ns);
+    printf("Full pass over %d cabins x %d sensors: %.1f us (checksum %ld)\n", cabins, NUM_SENSOR_KINDS,
+           window_ns * cabins * NUM_SENSOR_KINDS / 1000.0, (long)checksum);
+    return 0;
+}
+
+// Full power sweep, as without the incremental budget: every load of
+// every cabin set to where the boundaries for `shed` put it. Returns the
+// loads that changed.
+static int power_sweep(CabinStore* cabins, const int* shed) {
+    const CabinOp ops[] = { CABIN_OP_SHED_LIGHT, CABIN_OP_SHED_HVAC };
+    int changed = 0;
+    
+    for (int w = 0; w < cabins->num_words; w++) {
+        int first = w * CABINS_PER_WORD;
+        int end = first + CABINS_PER_WORD < cabins->count ? first + CABINS_PER_WORD : cabins->count;
+        
+        cabin_lock(cabins, first);
+        for (int l = 0; l < 2; l++) {
+            for (int i = first; i < end; i++) {
+                changed += cabin_apply(cabins, i, ops[l], i >= cabins->count - shed[l]);
+            }
+        }
+        cabin_unlock(cabins, first);
+    }
+    
+    return changed;
+}
+
+// Brown-out flapping over a full coach: supply toggling between two
+// levels, rebalanced incrementally vs swept over every cabin
+static int bench_power() {
+    const int levels[][2] = { { 89, 90 }, { 95, 96 }, { 60, 100 } };
+    const int flaps = 200;
+    FILE* sink = fopen("/dev/null", "w");
+    
+    cabins_destroy(&g_system.cabins);
+    if (!sink || cabins_init(&g_system.cabins, MAX_CABINS) != 0) return 1;
+    CabinStore* cabins = &g_system.cabins;
+    
+    printf("%d cabins, %d flaps per level pair\n", cabins->count, flaps);
+    printf("%-12s %-16s %-16s %-16s %-14s\n", "Supply (%)", "Loads/flap", "Rebalance (us)",
+           "Sweep (us)", "Sweep visits");
+    
+    for (size_t p = 0; p < sizeof(levels) / sizeof(levels[0]); p++) {
+        power_init();
+        power_set_supply(levels[p][1]);
+        power_rebalance();
+        log_ring_drain(sink);
+        
+        int moved = 0;
+        uint64_t start = monotonic_now_ns();
+        for (int f = 0; f < flaps; f++) {
+            power_set_supply(levels[p][f & 1]);
+            power_rebalance();
+            log_ring_drain(sink);
+        }
+        double rebalance_us = (monotonic_now_ns() - start) / 1000.0 / flaps;
+        
+        // Same flapping with every cabin revisited
+        int plan[2][2];
+        for (int k = 0; k < 2; k++) {
+            power_plan(levels[p][k], &plan[k][0], &plan[k][1]);
+        }
+        start = monotonic_now_ns();
+        for (int f = 0; f < flaps; f++) {
+            moved += power_sweep(cabins, plan[f & 1]);
+        }
+        double sweep_us = (monotonic_now_ns() - start) / 1000.0 / flaps;
+        
+        char label[16];
+        snprintf(label, sizeof(label), "%d <-> %d", levels[p][0], levels[p][1]);
+        printf("%-12s %-16d %-16.1f %-16.1f %-14d\n", label, moved / flaps, rebalance_us, sweep_us,
+               2 * cabins->count);
+    }
+    
+    power_init();
+    fclose(sink);
+    cabins_destroy(&g_system.cabins);
+    return cabins_init(&g_system.cabins, DEFAULT_NUM_CABINS) != 0;
+}
+
+// Peer bench: publisher and aggregator in one process over a unix socket
+#define PEER_BENCH_ADDRESS "unix:/tmp/coach_rtos_bench.sock"
+#define PEER_BENCH_TICKS 200
+
+// Publish one tick of `changed` cabin updates and wait until the
+// aggregator has applied all of its datagrams. Returns the datagrams, or
+// -1 if they never arrived.
+static int peer_bench_tick(int changed, uint64_t* publish_ns, uint64_t* applied_ns) {
+    const int per_datagram = (PEER_UNIX_DATAGRAM_MAX - PEER_HEADER_SIZE) / PEER_ENTRY_SIZE;
+    int datagrams = changed > per_datagram ? (changed + per_datagram - 1) / per_datagram : 1;
+    uint32_t before, after;
+    bool synced;
+    
+    peer_rake_coach(0, &before, &synced);
+    uint64_t start = monotonic_now_ns();
+    peer_publish_tick();
+    *publish_ns += monotonic_now_ns() - start;
+    
+    while (!peer_rake_coach(0, &after, &synced) || after - before < (uint32_t)datagrams) {
+        if (monotonic_now_ns() - start > 1000000000ULL) return -1;
+        sched_yield();
+    }
+    *applied_ns += monotonic_now_ns() - start;
+    return datagrams;
+}
+
+// Delta batches over a full coach by cabins changed per tick: size on
+// the wire against the full state, publish cost and time until applied
+// by the aggregator
+static int bench_peer() {
+    const int changes[] = { 1, 8, 64, 819, MAX_CABINS };
+    FILE* sink = fopen("/dev/null", "w");
+    
+    cabins_destroy(&g_system.cabins);
+    if (!sink || cabins_init(&g_system.cabins, MAX_CABINS) != 0) return 1;
+    if (peer_aggregate_start(PEER_BENCH_ADDRESS) != 0 || peer_publish_open(PEER_BENCH_ADDRESS, 0) != 0) {
+        log_ring_drain(stderr);
+        return 1;
+    }
+    
+    uint64_t publish_ns = 0, applied_ns = 0;
+    if (peer_bench_tick(MAX_CABINS, &publish_ns, &applied_ns) < 0) return 1;  // Keyframe
+    
+    size_t full_bytes = PEER_HEADER_SIZE + (size_t)MAX_CABINS * PEER_ENTRY_SIZE;
+    printf("%d cabins, %d ticks per row, full state %zu bytes\n", MAX_CABINS, PEER_BENCH_TICKS, full_bytes);
+    printf("%-10s %-11s %-12s %-13s %-10s %-14s %-14s\n", "Changed", "Datagrams", "Bytes/tick",
+           "Bytes/update", "vs full", "Publish (us)", "Applied (us)");
+    
+    CabinStore* cabins = &g_system.cabins;
+    for (size_t c = 0; c < sizeof(changes) / sizeof(changes[0]); c++) {
+        long datagrams = 0;
+        
+        // Setpoints cycle so every cabin touched differs from its last batch
+        publish_ns = 0;
+        applied_ns = 0;
+        for (int t = 0; t < PEER_BENCH_TICKS; t++) {
+            for (int k = 0; k < changes[c]; k++) {
+                int cabin = (int)(((long)k * MAX_CABINS / changes[c] + t) % MAX_CABINS);
+                cabin_apply(cabins, cabin, CABIN_OP_TEMP, 10 + t % 26);
+            }
+            
+            int sent = peer_bench_tick(changes[c], &publish_ns, &applied_ns);
+            if (sent < 0) {
+                fprintf(stderr, "Aggregator never applied tick %d\n", t);
+                return 1;
+            }
+            datagrams += sent;
+            log_ring_drain(sink);
+        }
+        
+        double bytes = ((double)datagrams * PEER_HEADER_SIZE +
+                        (double)changes[c] * PEER_ENTRY_SIZE * PEER_BENCH_TICKS) / PEER_BENCH_TICKS;
+        printf("%-10d %-11.2f %-12.0f %-13.2f %-10.3f %-14.1f %-14.1f\n", changes[c],
+               datagrams / (double)PEER_BENCH_TICKS, bytes, bytes / changes[c], bytes / full_bytes,
+               publish_ns / 1000.0 / PEER_BENCH_TICKS, applied_ns / 1000.0 / PEER_BENCH_TICKS);
+    }
+    
+    peer_publish_close();
+    peer_aggregate_stop();
+    log_ring_drain(sink);
+    fclose(sink);
+    cabins_destroy(&g_system.cabins);
+    return cabins_init(&g_system.cabins, DEFAULT_NUM_CABINS) != 0;
+}
+
+// Admission test inputs: random sets of ADMISSION_TASKS tasks with
+// periods of 10-100 ms, deadlines of 80-100% of the period and
+// deadline-monotonic priorities
+#define ADMISSION_TASKS 8
+#define ADMISSION_SETS 200
+
+static double bench_random(unsigned* seed) {
+    return rand_r(seed) / ((double)RAND_MAX + 1.0);
+}
+
+// Add one random task set with total utilization `utilization` under the
+// current dispatch mode; true if every task was admitted
+static bool admission_try_set(unsigned* seed, double utilization) {
+    TaskTiming timing[ADMISSION_TASKS];
+    double remaining = utilization;
+    
+    // UUniFast: utilization split uniformly over the tasks
+    for (int i = 0; i < ADMISSION_TASKS; i++) {
+        double share = remaining;
+        if (i < ADMISSION_TASKS - 1) {
+            double next = remaining * pow(bench_random(seed), 1.0 / (ADMISSION_TASKS - 1 - i));
+            share = remaining - next;
+            remaining = next;
+        }
+        
+        uint64_t period = (uint64_t)(10000.0 * pow(10.0, bench_random(seed)));
+        timing[i] = (TaskTiming){
+            .period_us = period,
+            .deadline_us = (uint64_t)(period * (0.8 + 0.2 * bench_random(seed))),
+            .budget_us = share * period < 1.0 ? 1 : (uint64_t)(share * period),
+        };
+    }
+    
+    bool admitted = true;
+    for (int i = 0; i < ADMISSION_TASKS && admitted; i++) {
+        int priority = 1;
+        for (int j = 0; j < ADMISSION_TASKS; j++) {
+            if (timing[j].deadline_us > timing[i].deadline_us) priority++;
+        }
+        admitted = scheduler_add_task("bench", priority, NULL, &timing[i]) >= 0;
+    }
+    
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        Task* task = &g_system.tasks[i];
+        pthread_cond_destroy(&task->wake_cond);
+        lock_destroy(&task->wake_mutex);
+        pthread_cond_destroy(&task->dispatch_cond);
+    }
+    g_system.num_tasks = 0;
+    return admitted;
+}
+
+// Admission control: share of random task sets admitted under fixed
+// priority (response-time analysis) and EDF (processor demand), by total
+// utilization, with the cost of adding a task
+static int bench_admission() {
+    const double levels[] = { 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 0.95 };
+    FILE* sink = fopen("/dev/null", "w");
+    
+    if (!sink) return 1;
+    lock_init(&g_system.system_mutex, "system");
+    scheduler_init();
+    
+    printf("%-12s %-16s %-16s %-14s %-14s\n", "Utilization", "Fixed prio (%)", "EDF (%)",
+           "FP add (us)", "EDF add (us)");
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        int admitted[2] = { 0, 0 };
+        double add_us[2];
+        
+        for (int mode = 0; mode < 2; mode++) {
+            unsigned seed = 1234 + l;  // Same sets in both modes
+            uint64_t start = monotonic_now_ns();
+            
+            scheduler_use_edf(mode == 1);
+            for (int set = 0; set < ADMISSION_SETS; set++) {
+                admitted[mode] += admission_try_set(&seed, levels[l]);
+                log_ring_drain(sink);
+            }
+            add_us[mode] = (monotonic_now_ns() - start) / 1000.0 / (ADMISSION_SETS * ADMISSION_TASKS);
+        }
+        
+        printf("%-12.2f %-16.1f %-16.1f %-14.2f %-14.2f\n", levels[l],
+               100.0 * admitted[0] / ADMISSION_SETS, 100.0 * admitted[1] / ADMISSION_SETS,
+               add_us[0], add_us[1]);
+    }
+    
+    scheduler_use_edf(false);
+    lock_destroy(&g_system.system_mutex);
+    fclose(sink);
+    return 0;
+}
+
+static const BenchEntry benches[] = {
+    { "log", "log_message() enqueue cost into the MPSC log ring", bench_log },
+    { "ingest", "Command line intake rate through the listener's read path", bench_ingest },
+    { "decode", "Text vs binary command decode cost", bench_decode },
+    { "fb", "Framebuffer frame time and bytes: dirty rects vs full redraw", bench_fb },
+    { "term", "Terminal frame time and bytes: changed rows vs full redraw", bench_term },
+    { "cabins", "Cabin sweeps: SoA store with striped locks vs per-cabin structs", bench_cabins },
+    { "metrics", "Latency histogram record cost and percentile error", bench_metrics },
+    { "thermal", "Thermal control step cost and setpoint settling time", bench_thermal },
+    { "locks", "Profiled priority-inheritance lock cost, uncontended and contended", bench_locks },
+    { "wakeup", "FIRE-to-handler wakeup latency: global broadcast vs per-task condvar", bench_wakeup },
+    { "events", "Event queue post/take cost and duplicate coalescing", bench_events },
+    { "admission", "Task sets admitted under fixed priority vs EDF, by utilization", bench_admission },
+    { "shards", "Cabin updates and thermal ticks: stripe locks vs shard owner threads", bench_shards },
+    { "sensors", "Sensor sample ingestion and window statistics cost", bench_sensors },
+    { "power", "Brown-out flapping: incremental load shedding vs full sweeps", bench_power },
+    { "peer", "Coach state deltas to a rake aggregator: bytes, publish cost, latency", bench_peer },
+};
+
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+// Run a benchmark by name ("all" runs every one, "list" lists them)
+int bench_run(const char* name) {
+    if (strcmp(name, "list") == 0) {
+        for (size_t i = 0; i < NUM_BENCHES; i++) {
+            printf("  %-10s %s\n", benches[i].name, benches[i].description);
+        }
+        return 0;
+    }
+    
+    // Benches that touch g_system run against one default coach
+    if (cabins_init(&g_system.cabins, DEFAULT_NUM_CABINS) != 0) return 1;
+    state_init();
+    
+    int status = 1;
+    for (size_t i = 0; i < NUM_BENCHES; i++) {
+        if (strcmp(name, "all") == 0 || strcmp(name, benches[i].name) == 0) {
+            printf("=== bench: %s ===\n", benches[i].name);
+            status = benches[i].run();
+            printf("\n");
+            if (status != 0) return status;
+        }
+    }
+    
+    if (status != 0) {
+        fprintf(stderr, "Unknown benchmark: %s (try --bench list)\n", name);
+    }
+    return status;
+}
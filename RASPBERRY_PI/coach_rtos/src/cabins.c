@@ -0,0 +1,232 @@
+#include "cabins.h"
+#include "state.h"
+#include "rt.h"
+
+// Allocate a cache-line aligned, zeroed array
+static void* alloc_array(size_t count, size_t size) {
+    return rt_alloc(count * size);
+}
+
+static void free_arrays(CabinStore* store) {
+    rt_free(store->light_bits);
+    rt_free(store->light_wanted);
+    rt_free(store->light_shed);
+    rt_free(store->hvac_on);
+    rt_free(store->temperature);
+    rt_free(store->state);
+    rt_free(store->setpoint);
+    rt_free(store->temp_current);
+    rt_free(store->temp_rate);
+    rt_free(store->temp_integral);
+    store->light_bits = NULL;
+    store->light_wanted = NULL;
+    store->light_shed = NULL;
+    store->hvac_on = NULL;
+    store->temperature = NULL;
+    store->state = NULL;
+    store->setpoint = NULL;
+    store->temp_current = NULL;
+    store->temp_rate = NULL;
+    store->temp_integral = NULL;
+}
+
+// Size the store for `count` cabins, all normal, lights off, HVAC on, at
+// the default temperature and setpoint. Returns 0 on success, -1 on failure.
+int cabins_init(CabinStore* store, int count) {
+    if (count <= 0 || count > MAX_CABINS) return -1;
+    
+    store->count = count;
+    store->num_words = (count + CABINS_PER_WORD - 1) / CABINS_PER_WORD;
+    
+    // Per-cabin arrays are padded to whole words so word passes never
+    // need a partial tail
+    int padded = store->num_words * CABINS_PER_WORD;
+    store->light_bits = alloc_array(store->num_words, sizeof(uint64_t));
+    store->light_wanted = alloc_array(store->num_words, sizeof(uint64_t));
+    store->light_shed = alloc_array(store->num_words, sizeof(uint64_t));
+    store->hvac_on = alloc_array(padded, sizeof(uint8_t));
+    store->temperature = alloc_array(padded, sizeof(int16_t));
+    store->state = alloc_array(padded, sizeof(uint8_t));
+    store->setpoint = alloc_array(padded, sizeof(int16_t));
+    store->temp_current = alloc_array(padded, sizeof(float));
+    store->temp_rate = alloc_array(padded, sizeof(float));
+    store->temp_integral = alloc_array(padded, sizeof(float));
+    
+    if (!store->light_bits || !store->light_wanted || !store->light_shed || !store->hvac_on ||
+        !store->temperature || !store->state || !store->setpoint ||
+        !store->temp_current || !store->temp_rate || !store->temp_integral) {
+        free_arrays(store);
+        return -1;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        store->temperature[i] = CABIN_DEFAULT_TEMP;
+        store->state[i] = STATE_NORMAL;
+        store->hvac_on[i] = 1;
+        store->setpoint[i] = CABIN_DEFAULT_TEMP;
+        store->temp_current[i] = CABIN_DEFAULT_TEMP;
+    }
+    
+    for (int i = 0; i < CABIN_LOCK_STRIPES; i++) {
+        char name[LOCK_NAME_LEN];
+        snprintf(name, sizeof(name), "cabins[%d]", i);
+        lock_init(&store->locks[i], name);
+    }
+    
+    return 0;
+}
+
+// Release the store's arrays and locks
+void cabins_destroy(CabinStore* store) {
+    for (int i = 0; i < CABIN_LOCK_STRIPES; i++) {
+        lock_destroy(&store->locks[i]);
+    }
+    
+    free_arrays(store);
+    store->count = 0;
+    store->num_words = 0;
+}
+
+static inline bool test_bit(const uint64_t* bits, int cabin_id) {
+    return (bits[cabin_id / CABINS_PER_WORD] >> (cabin_id % CABINS_PER_WORD)) & 1;
+}
+
+static inline void set_bit(uint64_t* bits, int cabin_id, bool on) {
+    uint64_t bit = 1ULL << (cabin_id % CABINS_PER_WORD);
+    
+    if (on) {
+        bits[cabin_id / CABINS_PER_WORD] |= bit;
+    } else {
+        bits[cabin_id / CABINS_PER_WORD] &= ~bit;
+    }
+}
+
+static inline bool cabin_critical(const CabinStore* store, int cabin_id) {
+    return store->state[cabin_id] == STATE_FIRE || store->state[cabin_id] == STATE_EMERGENCY;
+}
+
+// Whether a shed/restore would change anything. Fire and emergency
+// cabins are never shed (what they already had shed still comes back).
+static bool shed_changes(const CabinStore* store, int cabin_id, CabinOp op, int value) {
+    bool shed = (op == CABIN_OP_SHED_LIGHT) ? test_bit(store->light_shed, cabin_id)
+                                            : !store->hvac_on[cabin_id];
+    
+    if (value) return !shed && !cabin_critical(store, cabin_id);
+    return shed;
+}
+
+// Apply one update to a cabin inside a versioned write, so snapshots see
+// all of it or none. The caller holds the cabin's stripe, or is the
+// shard that owns the cabin. A shed light stays off while LIGHT ON is
+// only remembered, and comes back on when restored. Returns false if a
+// shed or restore had nothing to do (and nothing was written).
+bool cabin_apply(CabinStore* store, int cabin_id, CabinOp op, int value) {
+    uint8_t* state = &store->state[cabin_id];
+    
+    if ((op == CABIN_OP_SHED_LIGHT || op == CABIN_OP_SHED_HVAC) &&
+        !shed_changes(store, cabin_id, op, value)) {
+        return false;
+    }
+    
+    state_cabin_write_begin(cabin_id);
+    
+    switch (op) {
+        case CABIN_OP_LIGHT:
+            set_bit(store->light_wanted, cabin_id, value != 0);
+            if (value && test_bit(store->light_shed, cabin_id)) break;
+            cabin_set_light(store, cabin_id, value != 0);
+            if (value && *state == STATE_NORMAL) {
+                *state = STATE_LIGHT_ON;
+            } else if (!value && *state == STATE_LIGHT_ON) {
+                *state = STATE_NORMAL;
+            }
+            break;
+        case CABIN_OP_TEMP:
+            store->setpoint[cabin_id] = value;
+            if (*state == STATE_NORMAL) {
+                *state = STATE_TEMP_ADJUST;
+            }
+            break;
+        case CABIN_OP_FIRE:
+            *state = STATE_FIRE;
+            cabin_set_light(store, cabin_id, false);  // Cut power
+            set_bit(store->light_wanted, cabin_id, false);
+            break;
+        case CABIN_OP_EMERGENCY:
+            *state = STATE_EMERGENCY;
+            break;
+        case CABIN_OP_SHED_LIGHT:
+            set_bit(store->light_shed, cabin_id, value != 0);
+            if (value) {
+                cabin_set_light(store, cabin_id, false);
+                if (*state == STATE_LIGHT_ON) *state = STATE_NORMAL;
+            } else if (test_bit(store->light_wanted, cabin_id)) {
+                cabin_set_light(store, cabin_id, true);
+                if (*state == STATE_NORMAL) *state = STATE_LIGHT_ON;
+            }
+            break;
+        case CABIN_OP_SHED_HVAC:
+            store->hvac_on[cabin_id] = value ? 0 : 1;
+            break;
+    }
+    
+    state_cabin_write_end(cabin_id);
+    return true;
+}
+
+// Apply one update to each cabin in [first, end), which the caller owns
+// (stripes held, or the owning shard). Returns the cabins changed.
+int cabins_apply_range(CabinStore* store, int first, int end, CabinOp op, int value) {
+    int changed = 0;
+    
+    for (int i = first; i < end; i++) {
+        changed += cabin_apply(store, i, op, value);
+    }
+    
+    return changed;
+}
+
+// Valid-cabin bits of one 64-cabin word (the last word may be partial;
+// the state array is padded to whole words with zeroes)
+static uint64_t word_valid_mask(const CabinStore* store, int word) {
+    int n = store->count - word * CABINS_PER_WORD;
+    return n >= CABINS_PER_WORD ? ~0ULL : (1ULL << n) - 1;
+}
+
+// One bit per zero byte of x, byte k -> bit k (SWAR: exact zero-byte test,
+// then gather the eight high bits with one multiply)
+static inline uint64_t zero_bytes8(uint64_t x) {
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t high = ~(((x & low7) + low7) | x | low7);
+    
+    return ((high >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+// Bitmask of the cabins in `word` whose state is `state`. Compares eight
+// cabins per step; the caller holds the word's stripe.
+uint64_t cabins_state_mask(CabinStore* store, int word, CabinState state) {
+    const uint8_t* s = store->state + word * CABINS_PER_WORD;
+    const uint64_t match8 = (uint8_t)state * 0x0101010101010101ULL;
+    uint64_t mask = 0;
+    
+    for (int k = 0; k < CABINS_PER_WORD / 8; k++) {
+        uint64_t x;
+        memcpy(&x, s + k * 8, sizeof(x));
+        mask |= zero_bytes8(x ^ match8) << (k * 8);
+    }
+    
+    return mask & word_valid_mask(store, word);
+}
+
+// Number of cabins currently in `state`
+int cabins_count_state(CabinStore* store, CabinState state) {
+    int count = 0;
+    
+    for (int w = 0; w < store->num_words; w++) {
+        cabin_lock(store, w * CABINS_PER_WORD);
+        count += __builtin_popcountll(cabins_state_mask(store, w, state));
+        cabin_unlock(store, w * CABINS_PER_WORD);
+    }
+    
+    return count;
+}
@@ -0,0 +1,357 @@
+#include "commands.h"
+#include "scheduler.h"
+#include "tasks.h"
+#include "metrics.h"
+#include "locks.h"
+#include "power.h"
+
+// Argument kinds accepted after the command word
+typedef enum {
+    ARG_NONE = 0,
+    ARG_CABIN,        // Cabin index, 0..g_system.cabins.count-1
+    ARG_ON_OFF,       // ON / OFF -> value 1 / 0
+    ARG_TEMP,         // Integer setpoint within COMMAND_TEMP_MIN..MAX
+    ARG_POWER_LEVEL,  // LOW / OK / 1..100 -> POWER_LEVEL_LOW / POWER_LEVEL_OK / percent
+    ARG_OPTIONAL,     // Optional free word, ignored (CHAIN PULL)
+    ARG_METRICS_ACTION, // Optional RESET / JSON -> METRICS_RESET / METRICS_JSON
+    ARG_RESET           // Optional RESET -> LOCKS_RESET
+} ArgKind;
+
+// Command table entry, indexed by opcode
+typedef struct {
+    const char* name;
+    size_t name_len;
+    ArgKind args[2];
+    void (*execute)(const Command* cmd);
+} CommandSpec;
+
+// Command handlers
+static void exec_light(const Command* cmd) {
+    control_light(cmd->cabin, cmd->value != 0);
+}
+
+static void exec_temp(const Command* cmd) {
+    adjust_temperature(cmd->cabin, cmd->value);
+}
+
+// Emergency handlers run on the listener thread; their lock waits are
+// charged at the priority of the task they raise
+static void exec_emergency(const Command* cmd) {
+    int previous = lock_thread_priority(PRIORITY_PASSENGER_EMERGENCY);
+    handle_emergency(cmd->cabin);
+    lock_thread_priority(previous);
+}
+
+static void exec_fire(const Command* cmd) {
+    int previous = lock_thread_priority(PRIORITY_FIRE_EMERGENCY);
+    handle_fire_alert(cmd->cabin);
+    lock_thread_priority(previous);
+}
+
+static void exec_power(const Command* cmd) {
+    handle_power_level(cmd->value == POWER_LEVEL_LOW ? POWER_SUPPLY_LOW : cmd->value);
+}
+
+static void exec_chain(const Command* cmd) {
+    (void)cmd;
+    int previous = lock_thread_priority(PRIORITY_CHAIN_PULL);
+    handle_chain_pull();
+    lock_thread_priority(previous);
+}
+
+static void exec_status(const Command* cmd) {
+    (void)cmd;
+    scheduler_print_status();
+}
+
+static void exec_metrics(const Command* cmd) {
+    if (cmd->value == METRICS_RESET) {
+        metrics_reset();
+        log_message("Metrics reset");
+    } else if (cmd->value == METRICS_JSON) {
+        metrics_print_json();
+    } else {
+        metrics_print();
+    }
+}
+
+static void exec_locks(const Command* cmd) {
+    if (cmd->value == LOCKS_RESET) {
+        locks_reset();
+        log_message("Lock statistics reset");
+    } else {
+        locks_print();
+    }
+}
+
+#define SPEC(name, a0, a1, fn) { name, sizeof(name) - 1, { a0, a1 }, fn }
+
+static const CommandSpec command_table[NUM_OPCODES] = {
+    [OP_INVALID]   = { "INVALID", 7, { ARG_NONE, ARG_NONE }, NULL },
+    [OP_LIGHT]     = SPEC("LIGHT", ARG_CABIN, ARG_ON_OFF, exec_light),
+    [OP_TEMP]      = SPEC("TEMP", ARG_CABIN, ARG_TEMP, exec_temp),
+    [OP_EMERGENCY] = SPEC("EMERGENCY", ARG_CABIN, ARG_NONE, exec_emergency),
+    [OP_FIRE]      = SPEC("FIRE", ARG_CABIN, ARG_NONE, exec_fire),
+    [OP_POWER]     = SPEC("POWER", ARG_POWER_LEVEL, ARG_NONE, exec_power),
+    [OP_CHAIN]     = SPEC("CHAIN", ARG_OPTIONAL, ARG_NONE, exec_chain),
+    [OP_STATUS]    = SPEC("STATUS", ARG_NONE, ARG_NONE, exec_status),
+    [OP_METRICS]   = SPEC("METRICS", ARG_METRICS_ACTION, ARG_NONE, exec_metrics),
+    [OP_LOCKS]     = SPEC("LOCKS", ARG_RESET, ARG_NONE, exec_locks),
+};
+
+// Map a command word to its opcode: switch on the first character (the
+// second for LIGHT/LOCKS), then one exact compare against the table entry
+static CommandOpcode lookup_opcode(const char* word, size_t len) {
+    CommandOpcode op;
+    
+    switch (word[0]) {
+        case 'C': op = OP_CHAIN; break;
+        case 'E': op = OP_EMERGENCY; break;
+        case 'F': op = OP_FIRE; break;
+        case 'L': op = (len > 1 && word[1] == 'O') ? OP_LOCKS : OP_LIGHT; break;
+        case 'M': op = OP_METRICS; break;
+        case 'P': op = OP_POWER; break;
+        case 'S': op = OP_STATUS; break;
+        case 'T': op = OP_TEMP; break;
+        default: return OP_INVALID;
+    }
+    
+    const CommandSpec* spec = &command_table[op];
+    if (len != spec->name_len || memcmp(word, spec->name, len) != 0) return OP_INVALID;
+    return op;
+}
+
+// Strict decimal parse of a token; no sign unless allow_negative
+static bool parse_int(const char* tok, size_t len, bool allow_negative, int* out) {
+    size_t i = 0;
+    bool negative = false;
+    long value = 0;
+    
+    if (len == 0 || len > 6) return false;
+    if (tok[0] == '-' && allow_negative) {
+        negative = true;
+        i = 1;
+        if (len == 1) return false;
+    }
+    
+    for (; i < len; i++) {
+        if (tok[i] < '0' || tok[i] > '9') return false;
+        value = value * 10 + (tok[i] - '0');
+    }
+    
+    *out = (int)(negative ? -value : value);
+    return true;
+}
+
+static bool token_equals(const char* tok, size_t len, const char* word) {
+    return strlen(word) == len && memcmp(tok, word, len) == 0;
+}
+
+// Validate one argument token against its kind
+static bool parse_arg(ArgKind kind, const char* tok, size_t len, Command* cmd, const char** error) {
+    switch (kind) {
+        case ARG_CABIN:
+            if (!parse_int(tok, len, false, &cmd->cabin) || cmd->cabin >= g_system.cabins.count) {
+                *error = "invalid cabin";
+                return false;
+            }
+            return true;
+        case ARG_ON_OFF:
+            if (token_equals(tok, len, "ON")) {
+                cmd->value = 1;
+            } else if (token_equals(tok, len, "OFF")) {
+                cmd->value = 0;
+            } else {
+                *error = "expected ON or OFF";
+                return false;
+            }
+            return true;
+        case ARG_TEMP:
+            if (!parse_int(tok, len, true, &cmd->value) ||
+                cmd->value < COMMAND_TEMP_MIN || cmd->value > COMMAND_TEMP_MAX) {
+                *error = "temperature out of range";
+                return false;
+            }
+            return true;
+        case ARG_POWER_LEVEL:
+            if (token_equals(tok, len, "LOW")) {
+                cmd->value = POWER_LEVEL_LOW;
+                return true;
+            }
+            if (token_equals(tok, len, "OK")) {
+                cmd->value = POWER_LEVEL_OK;
+                return true;
+            }
+            if (!parse_int(tok, len, false, &cmd->value) ||
+                cmd->value <= POWER_LEVEL_LOW || cmd->value > POWER_LEVEL_OK) {
+                *error = "unknown power level";
+                return false;
+            }
+            return true;
+        case ARG_OPTIONAL:
+            return true;
+        case ARG_METRICS_ACTION:
+            if (token_equals(tok, len, "RESET")) {
+                cmd->value = METRICS_RESET;
+                return true;
+            }
+            if (token_equals(tok, len, "JSON")) {
+                cmd->value = METRICS_JSON;
+                return true;
+            }
+            *error = "unknown metrics action";
+            return false;
+        case ARG_RESET:
+            if (token_equals(tok, len, "RESET")) {
+                cmd->value = LOCKS_RESET;
+                return true;
+            }
+            *error = "expected RESET";
+            return false;
+        case ARG_NONE:
+            break;
+    }
+    
+    *error = "unexpected argument";
+    return false;
+}
+
+// Check a decoded command's fields against its table entry
+static int validate_command(const Command* cmd, const char** error) {
+    const CommandSpec* spec = &command_table[cmd->opcode];
+    
+    for (int i = 0; i < 2; i++) {
+        if (spec->args[i] == ARG_CABIN && (cmd->cabin < 0 || cmd->cabin >= g_system.cabins.count)) {
+            *error = "invalid cabin";
+            return -1;
+        }
+        if (spec->args[i] == ARG_TEMP &&
+            (cmd->value < COMMAND_TEMP_MIN || cmd->value > COMMAND_TEMP_MAX)) {
+            *error = "temperature out of range";
+            return -1;
+        }
+        if (spec->args[i] == ARG_POWER_LEVEL &&
+            (cmd->value < POWER_LEVEL_LOW || cmd->value > POWER_LEVEL_OK)) {
+            *error = "unknown power level";
+            return -1;
+        }
+        if (spec->args[i] == ARG_ON_OFF && cmd->value != 0 && cmd->value != 1) {
+            *error = "expected ON or OFF";
+            return -1;
+        }
+        if (spec->args[i] == ARG_METRICS_ACTION &&
+            cmd->value != METRICS_SHOW && cmd->value != METRICS_RESET &&
+            cmd->value != METRICS_JSON) {
+            *error = "unknown metrics action";
+            return -1;
+        }
+        if (spec->args[i] == ARG_RESET && cmd->value != LOCKS_SHOW && cmd->value != LOCKS_RESET) {
+            *error = "expected RESET";
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+// Tokenize and parse a text command without copying or modifying the line.
+// Returns 0 on success, -1 with *error set otherwise.
+int command_parse_text(const char* line, size_t len, Command* cmd, const char** error) {
+    const char* tok[COMMAND_MAX_TOKENS];
+    size_t tok_len[COMMAND_MAX_TOKENS];
+    int count = 0;
+    size_t i = 0;
+    
+    while (i < len) {
+        while (i < len && (line[i] == ' ' || line[i] == '\t')) i++;
+        if (i >= len) break;
+        
+        if (count == COMMAND_MAX_TOKENS) {
+            *error = "too many arguments";
+            return -1;
+        }
+        
+        tok[count] = line + i;
+        while (i < len && line[i] != ' ' && line[i] != '\t') i++;
+        tok_len[count] = line + i - tok[count];
+        count++;
+    }
+    
+    if (count == 0) {
+        *error = "empty command";
+        return -1;
+    }
+    
+    cmd->opcode = lookup_opcode(tok[0], tok_len[0]);
+    cmd->cabin = -1;
+    cmd->value = 0;
+    
+    if (cmd->opcode == OP_INVALID) {
+        *error = "unknown command";
+        return -1;
+    }
+    
+    const CommandSpec* spec = &command_table[cmd->opcode];
+    int t = 1;
+    for (int a = 0; a < 2 && spec->args[a] != ARG_NONE; a++) {
+        if (t >= count) {
+            if (spec->args[a] == ARG_OPTIONAL || spec->args[a] == ARG_METRICS_ACTION ||
+                spec->args[a] == ARG_RESET) break;
+            *error = "missing argument";
+            return -1;
+        }
+        if (!parse_arg(spec->args[a], tok[t], tok_len[t], cmd, error)) return -1;
+        t++;
+    }
+    
+    if (t < count) {
+        *error = "unexpected argument";
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Decode a binary payload: [opcode][cabin lo][cabin hi][value lo][value hi]
+int command_decode_binary(const uint8_t* payload, size_t len, Command* cmd, const char** error) {
+    if (len != COMMAND_PAYLOAD_SIZE) {
+        *error = "bad payload size";
+        return -1;
+    }
+    
+    if (payload[0] == OP_INVALID || payload[0] >= NUM_OPCODES) {
+        *error = "unknown opcode";
+        return -1;
+    }
+    
+    cmd->opcode = (CommandOpcode)payload[0];
+    int cabin = payload[1] | (payload[2] << 8);
+    cmd->cabin = cabin == COMMAND_NO_CABIN ? -1 : cabin;
+    cmd->value = (int16_t)(payload[3] | (payload[4] << 8));
+    
+    return validate_command(cmd, error);
+}
+
+// Encode a command as a binary payload; returns the payload size
+size_t command_encode_binary(const Command* cmd, uint8_t* payload) {
+    payload[0] = (uint8_t)cmd->opcode;
+    int cabin = cmd->cabin < 0 ? COMMAND_NO_CABIN : cmd->cabin;
+    payload[1] = (uint8_t)(cabin & 0xFF);
+    payload[2] = (uint8_t)((cabin >> 8) & 0xFF);
+    payload[3] = (uint8_t)(cmd->value & 0xFF);
+    payload[4] = (uint8_t)((cmd->value >> 8) & 0xFF);
+    return COMMAND_PAYLOAD_SIZE;
+}
+
+// Run a validated command
+void command_execute(const Command* cmd) {
+    if (cmd->opcode > OP_INVALID && cmd->opcode < NUM_OPCODES) {
+        command_table[cmd->opcode].execute(cmd);
+    }
+}
+
+// Command word for an opcode
+const char* command_name(CommandOpcode opcode) {
+    if (opcode >= NUM_OPCODES) return "INVALID";
+    return command_table[opcode].name;
+}
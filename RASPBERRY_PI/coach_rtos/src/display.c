@@ -1,16 +1,100 @@
 #include "display.h"
+#include "state.h"
+#include "rt.h"
+#include <errno.h>
 #include <fcntl.h>
+#include <stdarg.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <linux/fb.h>
 
 // Framebuffer variables
 static int fb_fd = -1;
-static uint16_t* fb_ptr = NULL;
+static uint8_t* fb_ptr = NULL;
 static size_t fb_size = 0;
+static size_t fb_line_length = 0;  // Bytes per framebuffer row
 static struct fb_var_screeninfo vinfo;
 static struct fb_fix_screeninfo finfo;
 static bool use_terminal_only = false;
+static bool vsync_supported = DISPLAY_WAIT_VSYNC;
+
+// Off-screen back buffer: packed RGB565 rows of screen_width pixels
+static uint16_t* back_buffer = NULL;
+static int screen_width = 0;
+static int screen_height = 0;
+
+// Dirty rectangles waiting to be flushed to the framebuffer
+typedef struct {
+    int x, y, w, h;
+} Rect;
+
+static Rect dirty_rects[MAX_DIRTY_RECTS];
+static int num_dirty = 0;
+
+// Last color drawn per cabin (-1: not drawn since the last clear)
+static int cabin_drawn_color[DISPLAY_MAX_CABINS];
+
+// Status banner requested by event handlers, drawn by display_update()
+static unsigned status_generation = 0;        // Bumped per message (atomic)
+static unsigned status_drawn_generation = 0;  // Owned by the display task
+
+// Terminal renderer: the frame being composed, the rows the terminal
+// shows now, and the output buffer changed rows are gathered into
+static char term_frame[TERM_VIEW_ROWS][TERM_ROW_BYTES];
+static uint16_t term_frame_len[TERM_VIEW_ROWS];
+static char term_shown[TERM_VIEW_ROWS][TERM_ROW_BYTES];
+static uint16_t term_shown_len[TERM_VIEW_ROWS];
+static char term_out[TERM_VIEW_ROWS * (TERM_ROW_BYTES + 16) + 64];
+static int term_fd = -1;               // -1 until the first frame picks stdout
+static bool term_ansi = false;
+static bool term_started = false;      // Screen set up / first frame sent
+static int term_lines = 0;             // Terminal height (ANSI mode)
+static uint64_t term_plain_sent_ns = 0;
+
+// Frame statistics
+static DisplayStats stats;
+
+// Two RGB565 pixels per store; may_alias keeps this legal on a uint16_t buffer
+typedef uint32_t __attribute__((may_alias)) PixelPair;
+
+// Write the whole output buffer (one write() unless the terminal takes
+// it in pieces). Returns the bytes written.
+static size_t term_write(size_t used) {
+    size_t done = 0;
+    
+    while (done < used) {
+        ssize_t n = write(term_fd, term_out + done, used - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += (size_t)n;
+    }
+    return done;
+}
+
+// Attach an already-mapped RGB565 framebuffer (or any memory laid out like
+// one) and allocate the back buffer for it
+int display_attach_buffer(void* buffer, int width, int height, size_t line_length) {
+    rt_free(back_buffer);
+    back_buffer = (uint16_t*)rt_alloc((size_t)width * height * sizeof(uint16_t));
+    if (!back_buffer) {
+        log_message("Error allocating display back buffer");
+        use_terminal_only = true;
+        return -1;
+    }
+    
+    fb_ptr = (uint8_t*)buffer;
+    fb_line_length = line_length;
+    screen_width = width;
+    screen_height = height;
+    use_terminal_only = false;
+    
+    display_reset_stats();
+    display_clear();
+    display_header();
+    return 0;
+}
 
 // Initialize display (framebuffer or terminal)
 int display_init() {
@@ -40,11 +124,19 @@ int display_init() {
         return -1;
     }
     
+    if (vinfo.bits_per_pixel != 16) {
+        log_message("Framebuffer is %d bpp, only RGB565 is supported", vinfo.bits_per_pixel);
+        close(fb_fd);
+        fb_fd = -1;
+        use_terminal_only = true;
+        return -1;
+    }
+    
     // Map framebuffer to memory
     fb_size = vinfo.yres_virtual * finfo.line_length;
-    fb_ptr = (uint16_t*)mmap(0, fb_size, PROT_READ | PROT_WRITE, MAP_SHARED, fb_fd, 0);
+    void* mapped = mmap(0, fb_size, PROT_READ | PROT_WRITE, MAP_SHARED, fb_fd, 0);
     
-    if (fb_ptr == MAP_FAILED) {
+    if (mapped == MAP_FAILED) {
         log_message("Error mapping framebuffer");
         close(fb_fd);
         fb_fd = -1;
@@ -52,16 +144,15 @@ int display_init() {
         return -1;
     }
     
-    log_message("Framebuffer initialized: %dx%d, %d bpp", 
-                vinfo.xres, vinfo.yres, vinfo.bits_per_pixel);
+    log_message("Framebuffer initialized: %dx%d, %d bpp, %d bytes/line", 
+                vinfo.xres, vinfo.yres, vinfo.bits_per_pixel, finfo.line_length);
     
-    display_clear();
-    return 0;
+    return display_attach_buffer(mapped, vinfo.xres, vinfo.yres, finfo.line_length);
 }
 
 // Cleanup display
 void display_cleanup() {
-    if (fb_ptr && fb_ptr != MAP_FAILED) {
+    if (fb_fd >= 0 && fb_ptr) {
         munmap(fb_ptr, fb_size);
     }
     
@@ -69,25 +160,126 @@ void display_cleanup() {
         close(fb_fd);
     }
     
+    rt_free(back_buffer);
+    back_buffer = NULL;
+    fb_ptr = NULL;
+    
+    // Give the terminal its full scroll region back, cursor at the bottom
+    if (term_ansi && term_started) {
+        size_t used = (size_t)snprintf(term_out, sizeof(term_out), "\033[r\033[%d;1H", term_lines);
+        term_write(used);
+    }
+    term_fd = -1;
+    term_started = false;
+    
     log_message("Display cleaned up");
 }
 
-// Clear display
+// Queue a rectangle for the next flush (clipped to the screen)
+static void mark_dirty(int x, int y, int w, int h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > screen_width) w = screen_width - x;
+    if (y + h > screen_height) h = screen_height - y;
+    if (w <= 0 || h <= 0) return;
+    
+    if (num_dirty == MAX_DIRTY_RECTS) {
+        // Out of slots: collapse everything into one bounding box
+        Rect* box = &dirty_rects[0];
+        for (int i = 1; i < num_dirty; i++) {
+            Rect* r = &dirty_rects[i];
+            int x2 = (box->x + box->w > r->x + r->w) ? box->x + box->w : r->x + r->w;
+            int y2 = (box->y + box->h > r->y + r->h) ? box->y + box->h : r->y + r->h;
+            box->x = box->x < r->x ? box->x : r->x;
+            box->y = box->y < r->y ? box->y : r->y;
+            box->w = x2 - box->x;
+            box->h = y2 - box->y;
+        }
+        num_dirty = 1;
+    }
+    
+    dirty_rects[num_dirty++] = (Rect){ x, y, w, h };
+}
+
+// Fill `count` RGB565 pixels with two-pixel stores
+static inline void fill_span16(uint16_t* dst, uint16_t color, int count) {
+    if (count > 0 && ((uintptr_t)dst & 2)) {
+        *dst++ = color;
+        count--;
+    }
+    
+    PixelPair pair = ((uint32_t)color << 16) | color;
+    PixelPair* d32 = (PixelPair*)dst;
+    for (; count >= 2; count -= 2) {
+        *d32++ = pair;
+    }
+    
+    if (count) {
+        *(uint16_t*)d32 = color;
+    }
+}
+
+// Clear display: black back buffer, everything dirty (in terminal mode:
+// the next frame redraws the whole view)
 void display_clear() {
-    if (use_terminal_only || !fb_ptr) return;
+    if (use_terminal_only) {
+        term_started = false;
+        return;
+    }
+    if (!back_buffer) return;
+    
+    memset(back_buffer, 0, (size_t)screen_width * screen_height * sizeof(uint16_t));
+    num_dirty = 0;
+    mark_dirty(0, 0, screen_width, screen_height);
     
-    memset(fb_ptr, 0, fb_size);
+    for (int i = 0; i < DISPLAY_MAX_CABINS; i++) {
+        cabin_drawn_color[i] = -1;
+    }
+    status_drawn_generation = 0;
 }
 
-// Draw a filled rectangle
+// Draw a filled rectangle into the back buffer, one span per row
 static void draw_rect(int x, int y, int w, int h, uint16_t color) {
-    if (use_terminal_only || !fb_ptr) return;
+    if (use_terminal_only || !back_buffer) return;
+    
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > screen_width) w = screen_width - x;
+    if (y + h > screen_height) h = screen_height - y;
+    if (w <= 0 || h <= 0) return;
+    
+    for (int j = y; j < y + h; j++) {
+        fill_span16(back_buffer + (size_t)j * screen_width + x, color, w);
+    }
+}
+
+// Copy dirty rectangles from the back buffer to the framebuffer.
+// Returns the number of bytes written.
+static size_t flush_dirty() {
+    size_t bytes = 0;
     
-    for (int j = y; j < y + h && j < vinfo.yres; j++) {
-        for (int i = x; i < x + w && i < vinfo.xres; i++) {
-            fb_ptr[j * vinfo.xres + i] = color;
+    if (num_dirty == 0) return 0;
+    
+    if (fb_fd >= 0 && vsync_supported) {
+        int crtc = 0;
+        if (ioctl(fb_fd, FBIO_WAITFORVSYNC, &crtc) < 0) {
+            vsync_supported = false;  // Driver has no vsync; stop asking
+        }
+    }
+    
+    for (int i = 0; i < num_dirty; i++) {
+        Rect* r = &dirty_rects[i];
+        size_t row_bytes = (size_t)r->w * sizeof(uint16_t);
+        
+        for (int j = r->y; j < r->y + r->h; j++) {
+            memcpy(fb_ptr + (size_t)j * fb_line_length + (size_t)r->x * sizeof(uint16_t),
+                   back_buffer + (size_t)j * screen_width + r->x, row_bytes);
         }
+        bytes += row_bytes * r->h;
     }
+    
+    num_dirty = 0;
+    return bytes;
 }
 
 // Get color for cabin state
@@ -107,122 +299,283 @@ void display_header() {
     if (use_terminal_only) return;
     
     draw_rect(0, 0, DISPLAY_WIDTH, 40, COLOR_BLUE);
+    mark_dirty(0, 0, DISPLAY_WIDTH, 40);
 }
 
-// Display a single cabin
+// Display a single cabin (redrawn only if its color changed)
 void display_cabin(int cabin_id) {
-    if (use_terminal_only || cabin_id < 0 || cabin_id >= NUM_CABINS) return;
+    if (use_terminal_only || cabin_id < 0 || cabin_id >= DISPLAY_MAX_CABINS ||
+        cabin_id >= g_system.cabins.count) return;
     
     int x = 10 + (cabin_id % 5) * (CABIN_WIDTH + 10);
     int y = 60 + (cabin_id / 5) * (CABIN_HEIGHT + 15);
     
-    pthread_mutex_lock(&g_system.cabins[cabin_id].mutex);
-    uint16_t color = get_cabin_color(g_system.cabins[cabin_id].state);
-    pthread_mutex_unlock(&g_system.cabins[cabin_id].mutex);
+    CabinView view;
+    state_read_cabin(cabin_id, &view);
+    uint16_t color = get_cabin_color(view.state);
+    
+    if (cabin_drawn_color[cabin_id] == color) return;
     
     draw_rect(x, y, CABIN_WIDTH, CABIN_HEIGHT, color);
     draw_rect(x + 2, y + 2, CABIN_WIDTH - 4, CABIN_HEIGHT - 4, COLOR_BLACK);
     draw_rect(x + 4, y + 4, CABIN_WIDTH - 8, CABIN_HEIGHT - 8, color);
+    mark_dirty(x, y, CABIN_WIDTH, CABIN_HEIGHT);
+    
+    cabin_drawn_color[cabin_id] = color;
 }
 
-// Update entire display
+// Update display: redraw what changed and flush only the dirty rectangles
 void display_update() {
     if (use_terminal_only) {
-        terminal_display_system_state();
+        display_terminal_update();
         return;
     }
     
-    display_clear();
-    display_header();
+    uint64_t start = monotonic_now_ns();
     
-    for (int i = 0; i < NUM_CABINS; i++) {
+    // The panel fits one coach; larger rakes show their first cabins
+    for (int i = 0; i < DISPLAY_MAX_CABINS; i++) {
         display_cabin(i);
     }
+    
+    unsigned generation = __atomic_load_n(&status_generation, __ATOMIC_RELAXED);
+    
+    if (generation != status_drawn_generation) {
+        // Draw message area at bottom
+        draw_rect(0, DISPLAY_HEIGHT - 40, DISPLAY_WIDTH, 40, COLOR_RED);
+        mark_dirty(0, DISPLAY_HEIGHT - 40, DISPLAY_WIDTH, 40);
+        status_drawn_generation = generation;
+    }
+    
+    size_t bytes = flush_dirty();
+    uint64_t elapsed = monotonic_now_ns() - start;
+    
+    stats.frames++;
+    stats.frame_time_total_ns += elapsed;
+    if (elapsed > stats.frame_time_max_ns) {
+        stats.frame_time_max_ns = elapsed;
+    }
+    stats.bytes_total += bytes;
+    stats.last_frame_bytes = bytes;
 }
 
 // Display status message
 void display_status_message(const char* message) {
     log_message("STATUS: %s", message);
     
-    if (!use_terminal_only) {
-        // Draw message area at bottom
-        draw_rect(0, DISPLAY_HEIGHT - 40, DISPLAY_WIDTH, 40, COLOR_RED);
+    // The banner itself is drawn by the display task on its next update
+    __atomic_fetch_add(&status_generation, 1, __ATOMIC_RELAXED);
+}
+
+// Frame statistics since the last reset
+void display_get_stats(DisplayStats* out) {
+    *out = stats;
+}
+
+void display_reset_stats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+// Print frame statistics
+void display_print_stats() {
+    if (stats.frames == 0) return;
+    
+    if (use_terminal_only) {
+        printf("\nTerminal: %lu frames, avg %.1f us, max %.1f us, avg %.2f rows and %.0f bytes/frame, last %lu bytes%s\n",
+               stats.frames,
+               stats.frame_time_total_ns / (double)stats.frames / 1000.0,
+               stats.frame_time_max_ns / 1000.0,
+               stats.rows_total / (double)stats.frames,
+               stats.bytes_total / (double)stats.frames,
+               stats.last_frame_bytes,
+               term_ansi ? ", ANSI" : ", plain");
+        return;
     }
+    
+    printf("\nFramebuffer: %lu frames, avg %.1f us, max %.1f us, avg %.0f bytes/frame, last %lu bytes%s\n",
+           stats.frames,
+           stats.frame_time_total_ns / (double)stats.frames / 1000.0,
+           stats.frame_time_max_ns / 1000.0,
+           stats.bytes_total / (double)stats.frames,
+           stats.last_frame_bytes,
+           vsync_supported && fb_fd >= 0 ? ", vsync" : "");
 }
 
-// Terminal-based display update
+// Terminal-based display update: compose a frame every period; only rows
+// that changed reach the terminal
 void display_terminal_update() {
-    // Just log, don't flood terminal
-    static int update_count = 0;
-    update_count++;
+    terminal_display_system_state();
+}
+
+// Send frames to `fd`. With `ansi` the view is pinned to the top
+// TERM_VIEW_ROWS rows (logs scroll in the region below) and changed rows
+// are rewritten in place; without it whole frames are printed, only when
+// something changed and at most every TERM_PLAIN_INTERVAL_MS.
+void display_attach_terminal(int fd, bool ansi) {
+    use_terminal_only = true;
+    term_fd = fd;
+    term_ansi = ansi;
+    term_started = false;
+    term_lines = TERM_MIN_LINES;  // Unless the terminal says otherwise
     
-    if (update_count % 10 == 0) {
-        // Periodic summary
-        terminal_display_system_state();
+    struct winsize size;
+    if (ansi && ioctl(fd, TIOCGWINSZ, &size) == 0 && size.ws_row > 0) {
+        term_lines = size.ws_row;
     }
 }
 
-// Terminal display system state
-void terminal_display_system_state() {
-    printf("\n");
-    printf("╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║           COACH SYSTEM STATUS - TERMINAL VIEW                ║\n");
-    printf("╚══════════════════════════════════════════════════════════════╝\n");
-    
-    pthread_mutex_lock(&g_system.system_mutex);
-    
-    printf("\nSystem Flags:\n");
-    printf("  Emergency Active: %s\n", g_system.emergency_active ? "YES" : "NO");
-    printf("  Fire Active:      %s\n", g_system.fire_active ? "YES" : "NO");
-    printf("  Power Low:        %s\n", g_system.power_low ? "YES" : "NO");
-    
-    printf("\nCabin Status:\n");
-    printf("┌──────┬────────┬──────────┬─────────────┐\n");
-    printf("│ Cabin│ Light  │ Temp(°C) │   State     │\n");
-    printf("├──────┼────────┼──────────┼─────────────┤\n");
-    
-    for (int i = 0; i < NUM_CABINS; i++) {
-        const char* state_str;
-        const char* state_icon;
+// Compose one row of the next frame
+static void term_row(int row, const char* fmt, ...) {
+    va_list args;
+    
+    va_start(args, fmt);
+    int n = vsnprintf(term_frame[row], TERM_ROW_BYTES, fmt, args);
+    va_end(args);
+    
+    if (n < 0) n = 0;
+    if (n >= TERM_ROW_BYTES) n = TERM_ROW_BYTES - 1;
+    term_frame_len[row] = (uint16_t)n;
+}
+
+static inline bool term_row_changed(int row) {
+    return !term_started || term_frame_len[row] != term_shown_len[row] ||
+           memcmp(term_frame[row], term_shown[row], term_frame_len[row]) != 0;
+}
+
+static inline size_t term_put(size_t used, const char* data, size_t n) {
+    memcpy(term_out + used, data, n);
+    return used + n;
+}
+
+// Build the changed rows of the composed frame into term_out and send
+// them. Returns the bytes written; *rows_sent gets the rows.
+static size_t term_flush(int* rows_sent) {
+    size_t used = 0;
+    int rows = 0;
+    
+    *rows_sent = 0;
+    
+    if (term_ansi) {
+        if (!term_started) {
+            // Clear, keep logs below the view, leave the cursor there
+            used += snprintf(term_out + used, sizeof(term_out) - used, "\033[2J\033[%d;%dr\033[%d;1H",
+                             TERM_VIEW_ROWS + 1, term_lines, TERM_VIEW_ROWS + 1);
+        }
+        
+        used = term_put(used, "\0337", 2);  // Save the log cursor
+        for (int r = 0; r < TERM_VIEW_ROWS; r++) {
+            if (!term_row_changed(r)) continue;
+            used += snprintf(term_out + used, sizeof(term_out) - used, "\033[%d;1H", r + 1);
+            used = term_put(used, term_frame[r], term_frame_len[r]);
+            used = term_put(used, "\033[K", 3);
+            rows++;
+        }
+        used = term_put(used, "\0338", 2);  // Back to the log cursor
+        
+        if (rows == 0) return 0;
+    } else {
+        for (int r = 0; r < TERM_VIEW_ROWS; r++) {
+            if (term_row_changed(r)) rows++;
+        }
         
-        switch (g_system.cabins[i].state) {
-            case STATE_NORMAL:
-                state_str = "Normal";
-                state_icon = "✓";
-                break;
-            case STATE_LIGHT_ON:
-                state_str = "Light On";
-                state_icon = "💡";
-                break;
-            case STATE_TEMP_ADJUST:
-                state_str = "Temp Adj";
-                state_icon = "🌡";
-                break;
-            case STATE_EMERGENCY:
-                state_str = "EMERGENCY";
-                state_icon = "⚠";
-                break;
-            case STATE_FIRE:
-                state_str = "FIRE";
-                state_icon = "🔥";
-                break;
-            default:
-                state_str = "Unknown";
-                state_icon = "?";
-                break;
+        uint64_t now = monotonic_now_ns();
+        if (rows == 0 || (term_started && now - term_plain_sent_ns < TERM_PLAIN_INTERVAL_MS * 1000000ULL)) {
+            return 0;
         }
+        term_plain_sent_ns = now;
         
-        printf("│  %2d  │  %3s   │   %3d    │ %s %-10s │\n",
-               i,
-               g_system.cabins[i].light_on ? "ON" : "OFF",
-               g_system.cabins[i].temperature,
-               state_icon,
-               state_str);
+        // Plain frames go out whole, without the trailing blank rows
+        int last = TERM_VIEW_ROWS;
+        while (last > 0 && term_frame_len[last - 1] == 0) last--;
+        
+        rows = 0;
+        used = term_put(used, "\n", 1);
+        for (int r = 0; r < last; r++) {
+            used = term_put(used, term_frame[r], term_frame_len[r]);
+            used = term_put(used, "\n", 1);
+            rows++;
+        }
+    }
+    
+    size_t bytes = term_write(used);
+    
+    memcpy(term_shown, term_frame, sizeof(term_shown));
+    memcpy(term_shown_len, term_frame_len, sizeof(term_shown_len));
+    term_started = true;
+    
+    *rows_sent = rows;
+    return bytes;
+}
+
+static const char* term_state_name(CabinState state) {
+    switch (state) {
+        case STATE_NORMAL: return "Normal";
+        case STATE_LIGHT_ON: return "Light On";
+        case STATE_TEMP_ADJUST: return "Temp Adj";
+        case STATE_EMERGENCY: return "EMERGENCY";
+        case STATE_FIRE: return "FIRE";
+        default: return "Unknown";
+    }
+}
+
+// Compose the status view from a state snapshot and send what changed.
+// Cell widths are fixed (no emoji) so rows line up and compare stably.
+void terminal_display_system_state() {
+    if (term_fd < 0) {
+        const char* term = getenv("TERM");
+        display_attach_terminal(STDOUT_FILENO, isatty(STDOUT_FILENO) && term && strcmp(term, "dumb") != 0);
+        if (term_lines < TERM_MIN_LINES) term_ansi = false;
+    }
+    
+    uint64_t start = monotonic_now_ns();
+    
+    // Copy first so nothing is held while composing or writing
+    StateSnapshot snap;
+    if (state_snapshot_alloc(&snap) != 0) return;
+    state_snapshot(&snap);
+    
+    int row = 0;
+    term_row(row++, "╔══════════════════════════════════════════════════════════════╗");
+    term_row(row++, "║           COACH SYSTEM STATUS - TERMINAL VIEW                ║");
+    term_row(row++, "╚══════════════════════════════════════════════════════════════╝");
+    term_row(row++, " Emergency cabins: %-5d Fire cabins: %-5d Chain pulled: %-4s Power low: %s",
+             snap.emergency_cabins, snap.fire_cabins,
+             snap.chain_pulled ? "YES" : "NO", snap.power_low ? "YES" : "NO");
+    term_row(row++, "");
+    term_row(row++, "┌──────┬────────┬──────────┬─────────────┐");
+    term_row(row++, "│ Cabin│ Light  │ Temp(°C) │   State     │");
+    term_row(row++, "├──────┼────────┼──────────┼─────────────┤");
+    
+    int shown = snap.num_cabins < DISPLAY_MAX_CABINS ? snap.num_cabins : DISPLAY_MAX_CABINS;
+    for (int i = 0; i < shown; i++) {
+        term_row(row++, "│  %2d  │  %-3s   │   %3d    │ %-11s │",
+                 i,
+                 snap.cabins[i].light_on ? "ON" : "OFF",
+                 snap.cabins[i].temperature,
+                 term_state_name(snap.cabins[i].state));
+    }
+    
+    term_row(row++, "└──────┴────────┴──────────┴─────────────┘");
+    
+    if (snap.num_cabins > shown) {
+        term_row(row++, "  ... %d more cabins (STATUS lists all)", snap.num_cabins - shown);
+    }
+    while (row < TERM_VIEW_ROWS) {
+        term_row(row++, "");
     }
     
-    printf("└──────┴────────┴──────────┴─────────────┘\n");
+    state_snapshot_free(&snap);
     
-    pthread_mutex_unlock(&g_system.system_mutex);
+    int rows;
+    size_t bytes = term_flush(&rows);
+    uint64_t elapsed = monotonic_now_ns() - start;
     
-    printf("\n");
-}
\ No newline at end of file
+    stats.frames++;
+    stats.frame_time_total_ns += elapsed;
+    if (elapsed > stats.frame_time_max_ns) {
+        stats.frame_time_max_ns = elapsed;
+    }
+    stats.bytes_total += bytes;
+    stats.last_frame_bytes = bytes;
+    stats.rows_total += rows;
+}
@@ -0,0 +1,208 @@
+#include "events.h"
+#include "rt.h"
+#include <stdatomic.h>
+
+typedef struct {
+    atomic_size_t sequence;
+    Event event;
+} EventSlot;
+
+// Bounded MPSC ring per event kind (per-slot sequence numbers, as in the
+// log ring). Any thread may post; the only consumer is the task
+// subscribed to the kind, which never runs twice at once. The pending
+// bits allow at most one queued event per cabin plus one coach-wide, so
+// a ring of at least num_cabins + 1 slots never fills.
+typedef struct {
+    EventSlot* slots;
+    size_t mask;            // Capacity - 1, capacity a power of two
+    atomic_size_t enqueue_pos;
+    size_t dequeue_pos;
+    
+    // Producers count posts, coalesced and dropped events; the consumer
+    // owns the rest
+    atomic_uint_fast64_t posted;
+    atomic_uint_fast64_t coalesced;
+    atomic_uint_fast64_t dropped;
+    uint64_t taken;
+    uint64_t latency_total_ns;
+    uint64_t latency_max_ns;
+} EventQueue;
+
+static EventQueue queues[NUM_EVENT_KINDS];
+
+// Bit per cabin (plus one for EVENT_NO_CABIN) per kind, set while an
+// event for that cabin is queued, so duplicates coalesce into it
+static uint64_t* pending[NUM_EVENT_KINDS];
+static int pending_cabins = 0;
+static atomic_uint_fast64_t next_sequence;
+
+static const char* kind_names[NUM_EVENT_KINDS] = {
+    "Fire", "Passenger emergency", "Chain pull", "Power low"
+};
+
+// Set up the queues for num_cabins cabins. Returns 0 on success, -1 on
+// allocation failure.
+int events_init(int num_cabins) {
+    int num_words = (num_cabins + 1 + CABINS_PER_WORD - 1) / CABINS_PER_WORD;
+    size_t capacity = 1;
+    
+    while (capacity < (size_t)num_cabins + 1) {
+        capacity <<= 1;
+    }
+    
+    pending_cabins = num_cabins;
+    atomic_store(&next_sequence, 0);
+    
+    for (int k = 0; k < NUM_EVENT_KINDS; k++) {
+        EventQueue* queue = &queues[k];
+        
+        queue->slots = rt_alloc(capacity * sizeof(EventSlot));
+        pending[k] = rt_alloc(num_words * sizeof(uint64_t));
+        if (!queue->slots || !pending[k]) {
+            events_destroy();
+            return -1;
+        }
+        queue->mask = capacity - 1;
+        
+        for (size_t i = 0; i < capacity; i++) {
+            atomic_store_explicit(&queue->slots[i].sequence, i, memory_order_relaxed);
+        }
+        atomic_store(&queue->enqueue_pos, 0);
+        queue->dequeue_pos = 0;
+        atomic_store(&queue->posted, 0);
+        atomic_store(&queue->coalesced, 0);
+        atomic_store(&queue->dropped, 0);
+        queue->taken = 0;
+        queue->latency_total_ns = 0;
+        queue->latency_max_ns = 0;
+    }
+    
+    return 0;
+}
+
+void events_destroy() {
+    for (int k = 0; k < NUM_EVENT_KINDS; k++) {
+        rt_free(queues[k].slots);
+        queues[k].slots = NULL;
+        rt_free(pending[k]);
+        pending[k] = NULL;
+    }
+}
+
+// Pending bit for a cabin of a kind
+static inline uint64_t* pending_word(EventKind kind, int cabin, uint64_t* bit) {
+    int index = (cabin == EVENT_NO_CABIN) ? pending_cabins : cabin;
+    *bit = 1ULL << (index % CABINS_PER_WORD);
+    return &pending[kind][index / CABINS_PER_WORD];
+}
+
+static bool queue_push(EventQueue* queue, const Event* event) {
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    EventSlot* slot;
+    
+    for (;;) {
+        slot = &queue->slots[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    
+    slot->event = *event;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+// Queue an event for a cabin (or EVENT_NO_CABIN). Returns false if it
+// was coalesced into one already queued for the same cabin, or (which
+// the ring sizing rules out) dropped because the queue is full; the
+// caller notifies the task either way.
+bool event_post(EventKind kind, int cabin) {
+    EventQueue* queue = &queues[kind];
+    uint64_t bit;
+    uint64_t* word = pending_word(kind, cabin, &bit);
+    
+    if (__atomic_fetch_or(word, bit, __ATOMIC_ACQ_REL) & bit) {
+        atomic_fetch_add_explicit(&queue->coalesced, 1, memory_order_relaxed);
+        return false;
+    }
+    
+    Event event = {
+        .kind = kind,
+        .cabin = cabin,
+        .timestamp_ns = monotonic_now_ns(),
+        .sequence = atomic_fetch_add_explicit(&next_sequence, 1, memory_order_relaxed),
+    };
+    
+    if (!queue_push(queue, &event)) {
+        __atomic_fetch_and(word, ~bit, __ATOMIC_RELEASE);
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    
+    atomic_fetch_add_explicit(&queue->posted, 1, memory_order_relaxed);
+    return true;
+}
+
+// Take the oldest event of a kind (its subscribed task only). Returns
+// false when the queue is empty.
+bool event_take(EventKind kind, Event* out) {
+    EventQueue* queue = &queues[kind];
+    EventSlot* slot = &queue->slots[queue->dequeue_pos & queue->mask];
+    
+    size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (seq != queue->dequeue_pos + 1) return false;
+    
+    *out = slot->event;
+    atomic_store_explicit(&slot->sequence, queue->dequeue_pos + queue->mask + 1,
+                          memory_order_release);
+    queue->dequeue_pos++;
+    
+    // From here a new event for the cabin queues again instead of
+    // coalescing into this one
+    uint64_t bit;
+    uint64_t* word = pending_word(kind, out->cabin, &bit);
+    __atomic_fetch_and(word, ~bit, __ATOMIC_RELEASE);
+    
+    uint64_t latency_ns = monotonic_now_ns() - out->timestamp_ns;
+    __atomic_store_n(&queue->taken, queue->taken + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&queue->latency_total_ns, queue->latency_total_ns + latency_ns, __ATOMIC_RELAXED);
+    if (latency_ns > queue->latency_max_ns) {
+        __atomic_store_n(&queue->latency_max_ns, latency_ns, __ATOMIC_RELAXED);
+    }
+    
+    return true;
+}
+
+// Per-kind queue counters for STATUS
+void events_print_stats() {
+    printf("\nEvent Queues:\n");
+    printf("%-22s %-8s %-10s %-8s %-8s %-7s %-10s %-10s\n",
+           "Kind", "Posted", "Coalesced", "Dropped", "Handled", "Queued", "Lat(us)", "Max(us)");
+    printf("----------------------------------------------------------------------------------------------\n");
+    
+    for (int k = 0; k < NUM_EVENT_KINDS; k++) {
+        EventQueue* queue = &queues[k];
+        uint64_t taken = __atomic_load_n(&queue->taken, __ATOMIC_RELAXED);
+        size_t queued = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed) -
+                        __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+        
+        printf("%-22s %-8lu %-10lu %-8lu %-8lu %-7zu %-10.1f %-10.1f\n", kind_names[k],
+               (uint64_t)atomic_load_explicit(&queue->posted, memory_order_relaxed),
+               (uint64_t)atomic_load_explicit(&queue->coalesced, memory_order_relaxed),
+               (uint64_t)atomic_load_explicit(&queue->dropped, memory_order_relaxed),
+               taken, queued,
+               taken ? __atomic_load_n(&queue->latency_total_ns, __ATOMIC_RELAXED) / (double)taken / 1000.0 : 0.0,
+               __atomic_load_n(&queue->latency_max_ns, __ATOMIC_RELAXED) / 1000.0);
+    }
+}
@@ -0,0 +1,432 @@
+#define _GNU_SOURCE
+#include "executor.h"
+#include "scheduler.h"
+#include "metrics.h"
+#include "locks.h"
+#include "rt.h"
+#include <sched.h>
+
+// Ring of queued tasks. The owner pushes and pops at the bottom; thieves
+// (and the lane) take from the top, the oldest entry.
+typedef struct {
+    Lock lock;
+    Task* slots[EXECUTOR_QUEUE_SIZE];
+    unsigned top;
+    unsigned bottom;
+} TaskQueue;
+
+typedef struct {
+    TaskQueue queue;        // Unused by worker 0, which serves the lane
+    pthread_t thread;
+    int cpu;
+    char name[LOCK_NAME_LEN];
+    uint64_t executed;      // Statistics, written by the worker only
+    uint64_t stolen;
+    uint64_t lane_runs;
+} Worker;
+
+static Worker workers[EXECUTOR_MAX_WORKERS];
+static int num_workers = 0;
+static TaskQueue lane;
+static bool executor_running = false;
+
+// Tasks sitting in the general queues and in the lane
+static int pending_work = 0;
+static int pending_lane = 0;
+
+// Idle workers sleep on idle_lock; submitters only take it when the
+// matching idle count is non-zero. Counts and pending totals are accessed
+// sequentially consistently, so either the submitter sees the sleeper or
+// the sleeper sees the work.
+static Lock idle_lock;
+static pthread_cond_t work_cond;
+static pthread_cond_t lane_cond;
+static int idle_general = 0;
+static int idle_lane = 0;
+
+// Timer thread: periodic releases
+static Lock timer_lock;
+static pthread_cond_t timer_cond;
+static pthread_t timer_thread;
+static bool timer_started = false;
+
+// Calling thread's worker index, -1 off the pool
+static __thread int current_worker = -1;
+static unsigned next_worker = 0;
+
+static void ns_to_timespec(struct timespec* ts, uint64_t ns) {
+    ts->tv_sec = ns / 1000000000ULL;
+    ts->tv_nsec = ns % 1000000000ULL;
+}
+
+static void queue_init(TaskQueue* queue, const char* name) {
+    lock_init(&queue->lock, name);
+    queue->top = 0;
+    queue->bottom = 0;
+}
+
+static void queue_push(TaskQueue* queue, Task* task, int* pending) {
+    lock_acquire(&queue->lock);
+    queue->slots[queue->bottom++ % EXECUTOR_QUEUE_SIZE] = task;
+    __atomic_add_fetch(pending, 1, __ATOMIC_SEQ_CST);
+    lock_release(&queue->lock);
+}
+
+// Take the newest (bottom) or oldest (top) task, or NULL if empty
+static Task* queue_take(TaskQueue* queue, bool newest, int* pending) {
+    Task* task = NULL;
+    
+    lock_acquire(&queue->lock);
+    if (queue->top != queue->bottom) {
+        if (newest) {
+            task = queue->slots[--queue->bottom % EXECUTOR_QUEUE_SIZE];
+        } else {
+            task = queue->slots[queue->top++ % EXECUTOR_QUEUE_SIZE];
+        }
+        __atomic_sub_fetch(pending, 1, __ATOMIC_SEQ_CST);
+    }
+    lock_release(&queue->lock);
+    
+    return task;
+}
+
+// Wake one idle worker able to run the new work
+static void wake_idle(bool lane_work) {
+    bool lane_sleeping = lane_work && __atomic_load_n(&idle_lane, __ATOMIC_SEQ_CST) > 0;
+    bool general_sleeping = __atomic_load_n(&idle_general, __ATOMIC_SEQ_CST) > 0;
+    if (!lane_sleeping && !general_sleeping) return;
+    
+    lock_acquire(&idle_lock);
+    pthread_cond_signal(lane_sleeping ? &lane_cond : &work_cond);
+    lock_release(&idle_lock);
+}
+
+// Queue a task that has just entered EXEC_QUEUED
+static void enqueue(Task* task) {
+    if (task->priority >= EXECUTOR_LANE_PRIORITY) {
+        queue_push(&lane, task, &pending_lane);
+        wake_idle(true);
+        return;
+    }
+    
+    // Work a worker creates stays local; outside work is spread round-robin
+    int target = current_worker;
+    if (target < 1) {
+        target = 1 + __atomic_fetch_add(&next_worker, 1, __ATOMIC_RELAXED) % (num_workers - 1);
+    }
+    queue_push(&workers[target].queue, task, &pending_work);
+    wake_idle(false);
+}
+
+// Request a run of a task released (or signalled) at release_ns. Returns
+// false if the request was coalesced into a run already queued.
+bool executor_submit(Task* task, uint64_t release_ns) {
+    if (!__atomic_load_n(&executor_running, __ATOMIC_ACQUIRE) || !task->is_active) return false;
+    
+    int state = __atomic_load_n(&task->exec_state, __ATOMIC_ACQUIRE);
+    for (;;) {
+        if (state == EXEC_IDLE) {
+            if (__atomic_compare_exchange_n(&task->exec_state, &state, EXEC_QUEUED, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                task->exec_release_ns = release_ns;
+                enqueue(task);
+                return true;
+            }
+        } else if (state == EXEC_RUNNING) {
+            if (__atomic_compare_exchange_n(&task->exec_state, &state, EXEC_RERUN, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&task->exec_rerun_ns, release_ns, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else {
+            return false;
+        }
+    }
+}
+
+// Back to idle, or straight back in the queue if it was submitted while
+// running
+static void finish_task(Task* task) {
+    int expected = EXEC_RUNNING;
+    if (__atomic_compare_exchange_n(&task->exec_state, &expected, EXEC_IDLE, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    
+    // EXEC_RERUN: the submitter publishes its time right after its CAS
+    uint64_t release_ns;
+    while ((release_ns = __atomic_load_n(&task->exec_rerun_ns, __ATOMIC_ACQUIRE)) == 0) {
+        sched_yield();
+    }
+    task->exec_rerun_ns = 0;
+    task->exec_release_ns = release_ns;
+    __atomic_store_n(&task->exec_state, EXEC_QUEUED, __ATOMIC_RELEASE);
+    enqueue(task);
+}
+
+// Run one step of a task. Release (periodic) or wakeup (event) latency is
+// measured from the requested time to the step starting, queueing included,
+// so it compares directly with the thread-per-task figures.
+static void run_task(Worker* worker, Task* task) {
+    uint64_t start_ns = monotonic_now_ns();
+    uint64_t delay_ns = start_ns > task->exec_release_ns ? start_ns - task->exec_release_ns : 0;
+    
+    __atomic_store_n(&task->exec_state, EXEC_RUNNING, __ATOMIC_RELEASE);
+    if (task->period_us > 0) {
+        scheduler_record_release(task, delay_ns);
+    } else {
+        scheduler_record_wakeup(task, delay_ns);
+    }
+    
+    lock_thread_set(task->name, task->priority);
+    task->state = TASK_RUNNING;
+    scheduler_job_release(task, task->exec_release_ns);
+    scheduler_job_start(task);
+    bool again = task->step(task);
+    scheduler_job_finish(task);
+    task->state = TASK_BLOCKED;
+    lock_thread_set(worker->name, 0);
+    
+    uint64_t end_ns = monotonic_now_ns();
+    metrics_record(METRIC_TASK_EXEC + task->id, end_ns - start_ns);
+    worker->executed++;
+    
+    // More events queued: requeued (behind anything already waiting) on
+    // completion
+    if (again) {
+        executor_submit(task, end_ns);
+    }
+    finish_task(task);
+}
+
+// Next task for a worker: the lane first, then its own deque, then the
+// oldest task of another general worker
+static Task* find_work(int index, bool* from_lane, bool* stolen) {
+    *from_lane = false;
+    *stolen = false;
+    
+    if (__atomic_load_n(&pending_lane, __ATOMIC_SEQ_CST) > 0) {
+        Task* task = queue_take(&lane, false, &pending_lane);
+        if (task) {
+            *from_lane = true;
+            return task;
+        }
+    }
+    if (index == 0 || __atomic_load_n(&pending_work, __ATOMIC_SEQ_CST) == 0) return NULL;
+    
+    Task* task = queue_take(&workers[index].queue, true, &pending_work);
+    if (task) return task;
+    
+    for (int k = 1; k < num_workers - 1 && !task; k++) {
+        int victim = 1 + (index - 1 + k) % (num_workers - 1);
+        task = queue_take(&workers[victim].queue, false, &pending_work);
+    }
+    *stolen = (task != NULL);
+    return task;
+}
+
+static bool work_available(int index) {
+    return __atomic_load_n(&pending_lane, __ATOMIC_SEQ_CST) > 0 ||
+           (index > 0 && __atomic_load_n(&pending_work, __ATOMIC_SEQ_CST) > 0);
+}
+
+static void* worker_main(void* arg) {
+    Worker* worker = (Worker*)arg;
+    int index = (int)(worker - workers);
+    int* idle = (index == 0) ? &idle_lane : &idle_general;
+    pthread_cond_t* cond = (index == 0) ? &lane_cond : &work_cond;
+    
+    current_worker = index;
+    lock_thread_set(worker->name, 0);
+    rt_thread_start(worker->name);
+    
+    while (__atomic_load_n(&executor_running, __ATOMIC_ACQUIRE)) {
+        bool from_lane, stolen;
+        Task* task = find_work(index, &from_lane, &stolen);
+        
+        if (task) {
+            worker->lane_runs += from_lane;
+            worker->stolen += stolen;
+            run_task(worker, task);
+            continue;
+        }
+        
+        lock_acquire(&idle_lock);
+        __atomic_add_fetch(idle, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&executor_running, __ATOMIC_ACQUIRE) && !work_available(index)) {
+            lock_cond_wait(&idle_lock, cond);
+        }
+        __atomic_sub_fetch(idle, 1, __ATOMIC_SEQ_CST);
+        lock_release(&idle_lock);
+    }
+    
+    rt_thread_stop();
+    return NULL;
+}
+
+// Submit periodic releases as they fall due. A periodic
+// release that finds the previous one still queued counts as missed.
+static void* timer_main(void* arg) {
+    (void)arg;
+    lock_thread_set("Executor Timer", 0);
+    rt_thread_start("Executor Timer");
+    
+    lock_acquire(&timer_lock);
+    while (__atomic_load_n(&executor_running, __ATOMIC_ACQUIRE)) {
+        uint64_t now_ns = monotonic_now_ns();
+        uint64_t next_ns = now_ns + 1000000000ULL;
+        
+        for (int i = 0; i < g_system.num_tasks; i++) {
+            Task* task = &g_system.tasks[i];
+            if (task->period_us == 0) continue;
+            
+            uint64_t due_ns = timespec_to_ns(&task->next_release);
+            if (due_ns <= now_ns) {
+                if (!executor_submit(task, due_ns)) task->missed_releases++;
+                scheduler_advance_release(task, due_ns, now_ns);
+                due_ns = timespec_to_ns(&task->next_release);
+            }
+            if (due_ns < next_ns) next_ns = due_ns;
+        }
+        
+        struct timespec deadline;
+        ns_to_timespec(&deadline, next_ns);
+        lock_cond_timedwait(&timer_lock, &timer_cond, &deadline);
+    }
+    lock_release(&timer_lock);
+    
+    rt_thread_stop();
+    return NULL;
+}
+
+// Start the worker pool (one worker per online CPU, within
+// EXECUTOR_MIN_WORKERS..EXECUTOR_MAX_WORKERS) and the timer
+int executor_start() {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    num_workers = cpus < EXECUTOR_MIN_WORKERS ? EXECUTOR_MIN_WORKERS :
+                  cpus > EXECUTOR_MAX_WORKERS ? EXECUTOR_MAX_WORKERS : (int)cpus;
+    
+    lock_init(&idle_lock, "executor idle");
+    pthread_cond_init(&work_cond, NULL);
+    pthread_cond_init(&lane_cond, NULL);
+    queue_init(&lane, "executor lane");
+    
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    lock_init(&timer_lock, "executor timer");
+    pthread_cond_init(&timer_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        g_system.tasks[i].exec_state = EXEC_IDLE;
+        g_system.tasks[i].exec_rerun_ns = 0;
+        g_system.tasks[i].state = TASK_BLOCKED;
+    }
+    
+    __atomic_store_n(&executor_running, true, __ATOMIC_RELEASE);
+    
+    for (int i = 0; i < num_workers; i++) {
+        Worker* worker = &workers[i];
+        pthread_attr_t attr;
+        cpu_set_t cpu_set;
+        
+        snprintf(worker->name, sizeof(worker->name), "executor[%d]", i);
+        queue_init(&worker->queue, worker->name);
+        worker->cpu = i % (int)cpus;
+        worker->executed = 0;
+        worker->stolen = 0;
+        worker->lane_runs = 0;
+        
+        CPU_ZERO(&cpu_set);
+        CPU_SET(worker->cpu, &cpu_set);
+        rt_thread_attr_init(&attr, RT_THREAD_STACK_SIZE);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set);
+        
+        int result = pthread_create(&worker->thread, &attr, worker_main, worker);
+        if (result != 0) {
+            // Pinning may be refused (e.g. a restricted cpuset); run unpinned
+            pthread_attr_destroy(&attr);
+            rt_thread_attr_init(&attr, RT_THREAD_STACK_SIZE);
+            worker->cpu = -1;
+            result = pthread_create(&worker->thread, &attr, worker_main, worker);
+        }
+        pthread_attr_destroy(&attr);
+        
+        if (result != 0) {
+            log_message("Error: Failed to create executor worker %d", i);
+            num_workers = i;
+            break;
+        }
+    }
+    
+    pthread_attr_t timer_attr;
+    rt_thread_attr_init(&timer_attr, RT_THREAD_STACK_SIZE);
+    timer_started = num_workers >= EXECUTOR_MIN_WORKERS &&
+                    pthread_create(&timer_thread, &timer_attr, timer_main, NULL) == 0;
+    pthread_attr_destroy(&timer_attr);
+    if (!timer_started) {
+        executor_stop();
+        return -1;
+    }
+    
+    log_message("Executor started: %d workers, lane for priority >= %d",
+                num_workers, EXECUTOR_LANE_PRIORITY);
+    return 0;
+}
+
+// Stop the timer and the workers; steps already running complete first and
+// queued ones are dropped
+void executor_stop() {
+    if (!__atomic_exchange_n(&executor_running, false, __ATOMIC_ACQ_REL)) return;
+    
+    lock_acquire(&timer_lock);
+    pthread_cond_signal(&timer_cond);
+    lock_release(&timer_lock);
+    if (timer_started) {
+        pthread_join(timer_thread, NULL);
+        timer_started = false;
+    }
+    
+    lock_acquire(&idle_lock);
+    pthread_cond_broadcast(&work_cond);
+    pthread_cond_broadcast(&lane_cond);
+    lock_release(&idle_lock);
+    
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        lock_destroy(&workers[i].queue.lock);
+    }
+    
+    lock_destroy(&lane.lock);
+    lock_destroy(&idle_lock);
+    lock_destroy(&timer_lock);
+    pthread_cond_destroy(&work_cond);
+    pthread_cond_destroy(&lane_cond);
+    pthread_cond_destroy(&timer_cond);
+    
+    log_message("Executor stopped");
+}
+
+// Per-worker counters for STATUS
+void executor_print_stats() {
+    printf("\nExecutor: %d workers, lane (priority >= %d) served by worker 0\n",
+           num_workers, EXECUTOR_LANE_PRIORITY);
+    printf("%-14s %-5s %-10s %-8s %-8s\n", "Worker", "CPU", "Executed", "Stolen", "Lane");
+    
+    for (int i = 0; i < num_workers; i++) {
+        const Worker* worker = &workers[i];
+        char cpu[12];
+        
+        if (worker->cpu >= 0) {
+            snprintf(cpu, sizeof(cpu), "%d", worker->cpu);
+        } else {
+            snprintf(cpu, sizeof(cpu), "-");
+        }
+        printf("%-14s %-5s %-10lu %-8lu %-8lu\n", worker->name, cpu,
+               __atomic_load_n(&worker->executed, __ATOMIC_RELAXED),
+               __atomic_load_n(&worker->stolen, __ATOMIC_RELAXED),
+               __atomic_load_n(&worker->lane_runs, __ATOMIC_RELAXED));
+    }
+}
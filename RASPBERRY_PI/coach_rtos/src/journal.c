@@ -0,0 +1,297 @@
+#include "journal.h"
+#include "state.h"
+#include "locks.h"
+#include "rt.h"
+#include "shutdown.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define REPLAY_SETTLE_MS 200                // Let tasks react before comparing
+
+// Recording state, owned by the listener thread until journal_record_close()
+static FILE* record_file = NULL;
+static uint64_t record_start_ns = 0;
+static uint64_t record_count = 0;
+
+// Start recording executed commands to `path` (truncates it).
+// Returns 0 on success, -1 on failure.
+int journal_record_open(const char* path) {
+    record_file = fopen(path, "wb");
+    if (!record_file) {
+        fprintf(stderr, "Cannot create journal %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.payload_size = COMMAND_PAYLOAD_SIZE;
+    header.num_cabins = (uint32_t)g_system.cabins.count;
+    
+    if (fwrite(&header, sizeof(header), 1, record_file) != 1) {
+        fclose(record_file);
+        record_file = NULL;
+        return -1;
+    }
+    
+    record_start_ns = monotonic_now_ns();
+    record_count = 0;
+    log_message("Recording commands to %s", path);
+    return 0;
+}
+
+// Append one command about to be executed (no-op when not recording)
+void journal_record(const Command* cmd) {
+    if (!record_file) return;
+    
+    JournalRecord rec;
+    rec.offset_ns = monotonic_now_ns() - record_start_ns;
+    command_encode_binary(cmd, rec.payload);
+    
+    if (fwrite(&rec, sizeof(rec), 1, record_file) == 1) {
+        record_count++;
+    }
+}
+
+// Push buffered records to the file; the listener calls this after each
+// batch of input so a crash loses at most one batch
+void journal_flush() {
+    if (record_file) fflush(record_file);
+}
+
+static void summarize(const Histogram* h, JournalLatency* out) {
+    out->count = h->count;
+    out->p50_ns = histogram_percentile(h, 50.0);
+    out->p99_ns = histogram_percentile(h, 99.0);
+    out->max_ns = h->max;
+}
+
+// Finish the recording: final cabin state and latency summary, then the
+// footer. Call after the listener has stopped.
+void journal_record_close() {
+    if (!record_file) return;
+    
+    StateSnapshot snap;
+    if (state_snapshot_alloc(&snap) == 0) {
+        state_snapshot(&snap);
+        
+        for (int i = 0; i < snap.num_cabins; i++) {
+            JournalCabin cabin;
+            cabin.setpoint = (int16_t)snap.cabins[i].setpoint;
+            cabin.state = (uint8_t)snap.cabins[i].state;
+            cabin.light_on = snap.cabins[i].light_on;
+            fwrite(&cabin, sizeof(cabin), 1, record_file);
+        }
+        
+        JournalFooter footer;
+        footer.record_count = record_count;
+        for (int m = 0; m < NUM_METRICS; m++) {
+            summarize(metrics_get(m), &footer.latency[m]);
+        }
+        memcpy(footer.magic, JOURNAL_FOOTER_MAGIC, sizeof(footer.magic));
+        fwrite(&footer, sizeof(footer), 1, record_file);
+        
+        state_snapshot_free(&snap);
+    }
+    
+    fclose(record_file);
+    record_file = NULL;
+    log_message("Journal closed: %lu commands recorded", record_count);
+}
+
+// Map a journal read-only and locate its records and optional footer.
+// Returns 0 on success, -1 on failure.
+int journal_replay_open(const char* path, Journal* journal) {
+    memset(journal, 0, sizeof(*journal));
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open journal %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(JournalHeader)) {
+        fprintf(stderr, "Journal %s is too short\n", path);
+        close(fd);
+        return -1;
+    }
+    
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Cannot map journal %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    journal->map = (const uint8_t*)map;
+    journal->size = st.st_size;
+    journal->header = (const JournalHeader*)map;
+    
+    const JournalHeader* header = journal->header;
+    if (memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != JOURNAL_VERSION || header->payload_size != COMMAND_PAYLOAD_SIZE ||
+        header->num_cabins == 0 || header->num_cabins > MAX_CABINS) {
+        fprintf(stderr, "%s is not a compatible journal\n", path);
+        journal_replay_close(journal);
+        return -1;
+    }
+    
+    size_t body = journal->size - sizeof(JournalHeader);
+    size_t trailer = header->num_cabins * sizeof(JournalCabin) + sizeof(JournalFooter);
+    journal->records = (const JournalRecord*)(journal->map + sizeof(JournalHeader));
+    
+    // A complete recording ends in a footer whose count accounts for the
+    // whole file; anything else is replayed as a truncated journal
+    const JournalFooter* footer = NULL;
+    if (body >= trailer) {
+        footer = (const JournalFooter*)(journal->map + journal->size - sizeof(JournalFooter));
+        if (memcmp(footer->magic, JOURNAL_FOOTER_MAGIC, sizeof(footer->magic)) != 0 ||
+            footer->record_count * sizeof(JournalRecord) + trailer != body) {
+            footer = NULL;
+        }
+    }
+    
+    if (footer) {
+        journal->footer = footer;
+        journal->record_count = footer->record_count;
+        journal->final_cabins = (const JournalCabin*)(journal->records + footer->record_count);
+    } else {
+        journal->record_count = body / sizeof(JournalRecord);
+    }
+    
+    madvise(map, journal->size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void journal_replay_close(Journal* journal) {
+    if (journal->map) {
+        munmap((void*)journal->map, journal->size);
+    }
+    memset(journal, 0, sizeof(*journal));
+}
+
+static void print_latency_row(const char* label, const char* task, const JournalLatency* rec,
+                              const JournalLatency* rep) {
+    printf("%-10s %-24s %-8lu %-9.1f %-9.1f %-10.1f %-8lu %-9.1f %-9.1f %-10.1f\n",
+           label, task,
+           rec->count, rec->p50_ns / 1000.0, rec->p99_ns / 1000.0, rec->max_ns / 1000.0,
+           rep->count, rep->p50_ns / 1000.0, rep->p99_ns / 1000.0, rep->max_ns / 1000.0);
+}
+
+// Compare the replayed run's final state and latencies with the recording
+static void print_comparison(const Journal* journal) {
+    printf("\n=== REPLAY COMPARISON ===\n");
+    
+    if (!journal->footer) {
+        printf("Journal has no footer (recording did not shut down cleanly); nothing to compare\n");
+        printf("========================\n\n");
+        fflush(stdout);
+        return;
+    }
+    
+    StateSnapshot snap;
+    if (state_snapshot_alloc(&snap) != 0) return;
+    state_snapshot(&snap);
+    
+    int mismatches = 0;
+    for (int i = 0; i < snap.num_cabins; i++) {
+        const JournalCabin* want = &journal->final_cabins[i];
+        const CabinView* got = &snap.cabins[i];
+        
+        if (want->setpoint != got->setpoint || want->state != got->state ||
+            (want->light_on != 0) != got->light_on) {
+            if (mismatches < 10) {
+                printf("Cabin %d differs: recorded light %s setpoint %d state %d, replayed light %s setpoint %d state %d\n",
+                       i, want->light_on ? "ON" : "OFF", want->setpoint, want->state,
+                       got->light_on ? "ON" : "OFF", got->setpoint, got->state);
+            }
+            mismatches++;
+        }
+    }
+    printf("Final cabin state: %d/%d cabins match\n", snap.num_cabins - mismatches, snap.num_cabins);
+    state_snapshot_free(&snap);
+    
+    printf("\n%-10s %-24s %-38s %-38s\n", "", "", "Recorded (us)", "Replayed (us)");
+    printf("%-10s %-24s %-8s %-9s %-9s %-10s %-8s %-9s %-9s %-10s\n", "Metric", "Task",
+           "Count", "p50", "p99", "Max", "Count", "p50", "p99", "Max");
+    printf("----------------------------------------------------------------------------------------------------------------\n");
+    
+    for (int m = 0; m < NUM_METRICS; m++) {
+        JournalLatency replayed;
+        summarize(metrics_get(m), &replayed);
+        const JournalLatency* recorded = &journal->footer->latency[m];
+        if (recorded->count == 0 && replayed.count == 0) continue;
+        
+        int task_id = m < METRIC_TASK_EXEC ? m - METRIC_TASK_WAKEUP : m - METRIC_TASK_EXEC;
+        if (m == METRIC_COMMAND_DISPATCH) {
+            print_latency_row("dispatch", "(rx/due -> execute)", recorded, &replayed);
+        } else if (m == METRIC_THERMAL_STEP) {
+            print_latency_row("thermal", "(control step)", recorded, &replayed);
+        } else if (task_id >= g_system.num_tasks) {
+            continue;
+        } else if (m < METRIC_TASK_EXEC) {
+            print_latency_row("wakeup", g_system.tasks[task_id].name, recorded, &replayed);
+        } else {
+            print_latency_row("exec", g_system.tasks[task_id].name, recorded, &replayed);
+        }
+    }
+    
+    printf("========================\n\n");
+    fflush(stdout);
+}
+
+// Replay thread: feed the journal's commands at their recorded offsets
+// divided by the speed, compare the outcome, then stop the system
+void* journal_replay_thread(void* arg) {
+    Journal* journal = (Journal*)arg;
+    uint64_t executed = 0;
+    uint64_t rejected = 0;
+    
+    lock_thread_set("Journal Replay", 0);
+    rt_thread_start("Journal Replay");
+    if (journal->speed == REPLAY_SPEED_MAX) {
+        log_message("Replaying %lu commands at maximum speed", journal->record_count);
+    } else {
+        log_message("Replaying %lu commands at %.1fx speed", journal->record_count, journal->speed);
+    }
+    
+    uint64_t start_ns = monotonic_now_ns();
+    for (uint64_t i = 0; i < journal->record_count && g_system.system_running; i++) {
+        const JournalRecord* rec = &journal->records[i];
+        uint64_t due_ns = start_ns;
+        
+        if (journal->speed != REPLAY_SPEED_MAX) {
+            due_ns += (uint64_t)(rec->offset_ns / journal->speed);
+            struct timespec due = { .tv_sec = due_ns / 1000000000ULL, .tv_nsec = due_ns % 1000000000ULL };
+            if (!shutdown_sleep_until(&due)) break;
+        }
+        
+        Command cmd;
+        const char* error;
+        if (command_decode_binary(rec->payload, COMMAND_PAYLOAD_SIZE, &cmd, &error) != 0) {
+            rejected++;
+            continue;
+        }
+        
+        uint64_t now_ns = monotonic_now_ns();
+        metrics_record(METRIC_COMMAND_DISPATCH, now_ns > due_ns ? now_ns - due_ns : 0);
+        command_execute(&cmd);
+        executed++;
+    }
+    
+    double elapsed_s = (monotonic_now_ns() - start_ns) / 1e9;
+    log_message("Replay finished: %lu commands (%lu rejected) in %.3f s", executed, rejected, elapsed_s);
+    
+    uint64_t settle_ns = monotonic_now_ns() + REPLAY_SETTLE_MS * 1000000ULL;
+    struct timespec settle = { .tv_sec = settle_ns / 1000000000ULL, .tv_nsec = settle_ns % 1000000000ULL };
+    shutdown_sleep_until(&settle);
+    print_comparison(journal);
+    
+    shutdown_request(0);
+    rt_thread_stop();
+    return NULL;
+}
@@ -0,0 +1,232 @@
+#include "locks.h"
+
+// Every initialized lock, for the LOCKS report
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static Lock* registry[MAX_LOCKS];
+static int num_locks = 0;
+
+// Protocol for locks initialized from now on
+static bool priority_inherit = true;
+
+// Calling thread's identity (see lock_thread_set())
+static __thread const char* thread_name = "unnamed";
+static __thread int thread_priority = 0;
+
+// Choose whether new locks use PTHREAD_PRIO_INHERIT (call before the
+// locks are initialized)
+void locks_set_priority_inherit(bool enabled) {
+    priority_inherit = enabled;
+}
+
+// Initialize a lock and list it in the LOCKS report
+void lock_init(Lock* lock, const char* name) {
+    pthread_mutexattr_t attr;
+    
+    memset(lock, 0, sizeof(*lock));
+    strncpy(lock->name, name, sizeof(lock->name) - 1);
+    
+    pthread_mutexattr_init(&attr);
+    if (priority_inherit) {
+        pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    }
+    pthread_mutex_init(&lock->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    
+    pthread_mutex_lock(&registry_mutex);
+    if (num_locks < MAX_LOCKS) {
+        registry[num_locks++] = lock;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+void lock_destroy(Lock* lock) {
+    pthread_mutex_lock(&registry_mutex);
+    for (int i = 0; i < num_locks; i++) {
+        if (registry[i] == lock) {
+            registry[i] = registry[--num_locks];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    
+    pthread_mutex_destroy(&lock->mutex);
+}
+
+// Stats are only written by the thread holding the lock, so plain
+// read-modify-writes suffice; the stores are atomic for the report
+static inline void stat_add(uint64_t* stat, uint64_t value) {
+    __atomic_store_n(stat, *stat + value, __ATOMIC_RELAXED);
+}
+
+static inline void stat_max(uint64_t* stat, uint64_t value) {
+    if (value > *stat) __atomic_store_n(stat, value, __ATOMIC_RELAXED);
+}
+
+static inline void set_holder(Lock* lock) {
+    __atomic_store_n(&lock->holder, thread_name, __ATOMIC_RELAXED);
+    __atomic_store_n(&lock->holder_priority, thread_priority, __ATOMIC_RELAXED);
+}
+
+// Acquire a lock. The uncontended path is one trylock; only a contended
+// acquisition reads the clock.
+void lock_acquire(Lock* lock) {
+    if (pthread_mutex_trylock(&lock->mutex) != 0) {
+        const char* blocker = __atomic_load_n(&lock->holder, __ATOMIC_RELAXED);
+        int blocker_priority = __atomic_load_n(&lock->holder_priority, __ATOMIC_RELAXED);
+        uint64_t start_ns = monotonic_now_ns();
+        
+        pthread_mutex_lock(&lock->mutex);
+        uint64_t wait_ns = monotonic_now_ns() - start_ns;
+        
+        stat_add(&lock->contended, 1);
+        stat_add(&lock->wait_total_ns, wait_ns);
+        stat_max(&lock->wait_max_ns, wait_ns);
+        
+        if (blocker && blocker_priority < thread_priority) {
+            stat_add(&lock->inversions, 1);
+        }
+        
+        if (thread_priority >= LOCK_EMERGENCY_PRIORITY) {
+            stat_add(&lock->emergency_waits, 1);
+            stat_add(&lock->emergency_wait_total_ns, wait_ns);
+            if (wait_ns > lock->emergency_wait_max_ns) {
+                __atomic_store_n(&lock->emergency_wait_max_ns, wait_ns, __ATOMIC_RELAXED);
+                __atomic_store_n(&lock->worst_blocker, blocker, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    
+    stat_add(&lock->acquisitions, 1);
+    set_holder(lock);
+}
+
+void lock_release(Lock* lock) {
+    __atomic_store_n(&lock->holder, NULL, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+// Wait on a condition variable with the lock held; the lock is
+// unowned while waiting and owned again on return
+void lock_cond_wait(Lock* lock, pthread_cond_t* cond) {
+    __atomic_store_n(&lock->holder, NULL, __ATOMIC_RELAXED);
+    pthread_cond_wait(cond, &lock->mutex);
+    set_holder(lock);
+}
+
+// As lock_cond_wait(), giving up at an absolute deadline on the cond's
+// clock. Returns ETIMEDOUT on timeout, otherwise 0.
+int lock_cond_timedwait(Lock* lock, pthread_cond_t* cond, const struct timespec* deadline) {
+    __atomic_store_n(&lock->holder, NULL, __ATOMIC_RELAXED);
+    int result = pthread_cond_timedwait(cond, &lock->mutex, deadline);
+    set_holder(lock);
+    return result;
+}
+
+// Name the calling thread and set the priority its waits are charged at.
+// `name` must outlive the thread.
+void lock_thread_set(const char* name, int priority) {
+    thread_name = name;
+    thread_priority = priority;
+}
+
+// Change the calling thread's priority for lock accounting (e.g. while
+// the listener runs an emergency handler). Returns the previous one.
+int lock_thread_priority(int priority) {
+    int previous = thread_priority;
+    thread_priority = priority;
+    return previous;
+}
+
+// Clear every lock's statistics (LOCKS RESET). A holder updating a lock
+// at the same moment may carry one sample over, as with METRICS RESET.
+void locks_reset() {
+    pthread_mutex_lock(&registry_mutex);
+    
+    for (int i = 0; i < num_locks; i++) {
+        Lock* lock = registry[i];
+        
+        __atomic_store_n(&lock->acquisitions, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&lock->contended, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&lock->wait_total_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&lock->wait_max_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&lock->inversions, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&lock->emergency_waits, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&lock->emergency_wait_total_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&lock->emergency_wait_max_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&lock->worst_blocker, NULL, __ATOMIC_RELAXED);
+    }
+    
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+// Report row: sort keys are copied so live updates cannot upset qsort
+typedef struct {
+    const Lock* lock;
+    uint64_t emergency_wait_ns;
+    uint64_t wait_ns;
+} LockRow;
+
+// Order for the report: most emergency wait first, then most wait
+static int compare_rows(const void* a, const void* b) {
+    const LockRow* x = (const LockRow*)a;
+    const LockRow* y = (const LockRow*)b;
+    
+    if (x->emergency_wait_ns != y->emergency_wait_ns) {
+        return x->emergency_wait_ns < y->emergency_wait_ns ? 1 : -1;
+    }
+    if (x->wait_ns != y->wait_ns) {
+        return x->wait_ns < y->wait_ns ? 1 : -1;
+    }
+    return strcmp(x->lock->name, y->lock->name);
+}
+
+// Print per-lock contention, worst for the emergency paths first
+void locks_print() {
+    LockRow rows[MAX_LOCKS];
+    
+    pthread_mutex_lock(&registry_mutex);
+    int count = num_locks;
+    for (int i = 0; i < count; i++) {
+        rows[i].lock = registry[i];
+        rows[i].emergency_wait_ns = __atomic_load_n(&registry[i]->emergency_wait_total_ns, __ATOMIC_RELAXED);
+        rows[i].wait_ns = __atomic_load_n(&registry[i]->wait_total_ns, __ATOMIC_RELAXED);
+    }
+    qsort(rows, count, sizeof(LockRow), compare_rows);
+    
+    printf("\n=== LOCKS (us) ===\n");
+    printf("Protocol: %s; emergency waits are by threads at priority %d or above\n",
+           priority_inherit ? "priority inheritance" : "none", LOCK_EMERGENCY_PRIORITY);
+    printf("%-24s %-10s %-9s %-10s %-10s %-7s %-10s %-10s %-5s %-22s %-22s\n",
+           "Lock", "Acquired", "Contended", "Wait avg", "Wait max", "Emerg", "Emerg avg",
+           "Emerg max", "Inv", "Worst blocker", "Holder");
+    printf("----------------------------------------------------------------------------------------------------------------------------------------------\n");
+    
+    for (int i = 0; i < count; i++) {
+        const Lock* lock = rows[i].lock;
+        if (lock->acquisitions == 0) continue;
+        
+        const char* worst = __atomic_load_n(&lock->worst_blocker, __ATOMIC_RELAXED);
+        const char* holder = __atomic_load_n(&lock->holder, __ATOMIC_RELAXED);
+        
+        printf("%-24s %-10lu %-9lu %-10.1f %-10.1f %-7lu %-10.1f %-10.1f %-5lu %-22s %-22s\n",
+               lock->name, lock->acquisitions, lock->contended,
+               lock->contended ? lock->wait_total_ns / (double)lock->contended / 1000.0 : 0.0,
+               lock->wait_max_ns / 1000.0,
+               lock->emergency_waits,
+               lock->emergency_waits ?
+                   lock->emergency_wait_total_ns / (double)lock->emergency_waits / 1000.0 : 0.0,
+               lock->emergency_wait_max_ns / 1000.0,
+               lock->inversions, worst ? worst : "-", holder ? holder : "-");
+    }
+    
+    if (count > 0 && rows[0].emergency_wait_ns > 0) {
+        printf("Emergency paths wait longest on: %s\n", rows[0].lock->name);
+    } else {
+        printf("No emergency-path lock waits recorded\n");
+    }
+    
+    pthread_mutex_unlock(&registry_mutex);
+    
+    printf("========================\n\n");
+    fflush(stdout);
+}
@@ -0,0 +1,286 @@
+#include "log_ring.h"
+#include <stdatomic.h>
+
+// Argument types packed into a record, chosen so that each one is passed
+// back to snprintf() with exactly the type its conversion expects
+typedef enum {
+    LOG_ARG_INT = 0,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STR,
+    LOG_ARG_PTR
+} LogArgType;
+
+typedef union {
+    long long i;
+    double d;
+    const void* p;
+    uint16_t str_offset;
+} LogArg;
+
+// One binary log record. Formatting happens only when the record is drained.
+typedef struct {
+    atomic_size_t sequence;
+    uint64_t timestamp_ns;
+    const char* format;
+    uint8_t num_args;
+    uint8_t arg_types[LOG_MAX_ARGS];
+    LogArg args[LOG_MAX_ARGS];
+    char strings[LOG_STR_BYTES];
+} LogRecord;
+
+// Bounded MPSC ring (per-slot sequence numbers, Vyukov style). Producers
+// claim a slot with one CAS on enqueue_pos; the single consumer is the
+// logging task, or the main thread once all tasks have been joined.
+static LogRecord ring[LOG_RING_CAPACITY];
+static atomic_size_t enqueue_pos;
+static size_t dequeue_pos = 0;
+static atomic_uint_fast64_t dropped_count;
+static uint64_t dropped_reported = 0;
+static int64_t realtime_offset_ns = 0;
+
+// Initialize the ring; must run before the first log_message()
+void log_ring_init() {
+    for (size_t i = 0; i < LOG_RING_CAPACITY; i++) {
+        atomic_store_explicit(&ring[i].sequence, i, memory_order_relaxed);
+    }
+    atomic_store(&enqueue_pos, 0);
+    atomic_store(&dropped_count, 0);
+    dequeue_pos = 0;
+    
+    // Records carry monotonic time; this maps it back to wall-clock time
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    realtime_offset_ns = (int64_t)timespec_to_ns(&real) - (int64_t)monotonic_now_ns();
+}
+
+// Skip flags, width, precision and length of one conversion spec. Returns
+// the conversion character and the argument type, or 0 if unsupported.
+static char parse_spec(const char** cursor, LogArgType* type) {
+    const char* p = *cursor;
+    int longs = 0;
+    bool size = false;
+    
+    while (*p && strchr("-+ #0", *p)) p++;
+    while (*p >= '0' && *p <= '9') p++;
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    if (*p == '*') return 0;
+    
+    while (*p == 'l' || *p == 'h' || *p == 'z') {
+        if (*p == 'l') longs++;
+        if (*p == 'z') size = true;
+        p++;
+    }
+    
+    char conv = *p;
+    if (conv) p++;
+    *cursor = p;
+    
+    switch (conv) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            *type = size ? LOG_ARG_SIZE : longs >= 2 ? LOG_ARG_LLONG :
+                    longs == 1 ? LOG_ARG_LONG : LOG_ARG_INT;
+            return conv;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            *type = LOG_ARG_DOUBLE;
+            return conv;
+        case 's':
+            *type = LOG_ARG_STR;
+            return conv;
+        case 'p':
+            *type = LOG_ARG_PTR;
+            return conv;
+        default:
+            return 0;
+    }
+}
+
+// Pack the arguments of a format into a record. Returns false if the
+// format uses something the packer does not handle.
+static bool pack_args(LogRecord* rec, const char* format, va_list args) {
+    size_t str_used = 0;
+    const char* p = format;
+    
+    rec->num_args = 0;
+    
+    while ((p = strchr(p, '%')) != NULL) {
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        
+        LogArgType type;
+        if (!parse_spec(&p, &type) || rec->num_args >= LOG_MAX_ARGS) return false;
+        
+        LogArg* arg = &rec->args[rec->num_args];
+        switch (type) {
+            case LOG_ARG_INT: arg->i = va_arg(args, int); break;
+            case LOG_ARG_LONG: arg->i = va_arg(args, long); break;
+            case LOG_ARG_LLONG: arg->i = va_arg(args, long long); break;
+            case LOG_ARG_SIZE: arg->i = (long long)va_arg(args, size_t); break;
+            case LOG_ARG_DOUBLE: arg->d = va_arg(args, double); break;
+            case LOG_ARG_PTR: arg->p = va_arg(args, void*); break;
+            case LOG_ARG_STR: {
+                // Strings may live on the caller's stack, so copy them inline
+                const char* str = va_arg(args, const char*);
+                if (!str) str = "(null)";
+                size_t room = LOG_STR_BYTES - str_used;
+                if (room == 0) return false;
+                size_t len = strnlen(str, room - 1);
+                memcpy(rec->strings + str_used, str, len);
+                rec->strings[str_used + len] = '\0';
+                arg->str_offset = (uint16_t)str_used;
+                str_used += len + 1;
+                break;
+            }
+        }
+        rec->arg_types[rec->num_args++] = (uint8_t)type;
+    }
+    
+    return true;
+}
+
+// Enqueue a log record. Never blocks: if the ring is full the record is
+// dropped and counted.
+bool log_ring_vpush(const char* format, va_list args) {
+    size_t pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    LogRecord* rec;
+    
+    for (;;) {
+        rec = &ring[pos & (LOG_RING_CAPACITY - 1)];
+        size_t seq = atomic_load_explicit(&rec->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+            return false;
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+    
+    rec->timestamp_ns = monotonic_now_ns();
+    rec->format = format;
+    
+    va_list copy;
+    va_copy(copy, args);
+    bool packed = pack_args(rec, format, copy);
+    va_end(copy);
+    
+    if (!packed) {
+        // Unsupported format: fall back to formatting into the record
+        vsnprintf(rec->strings, sizeof(rec->strings), format, args);
+        rec->format = "%s";
+        rec->num_args = 1;
+        rec->arg_types[0] = LOG_ARG_STR;
+        rec->args[0].str_offset = 0;
+    }
+    
+    atomic_store_explicit(&rec->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+// Format one record's message, one conversion spec at a time
+static void format_record(const LogRecord* rec, char* out, size_t size) {
+    const char* p = rec->format;
+    size_t used = 0;
+    int arg_index = 0;
+    
+    while (*p && used + 1 < size) {
+        if (*p != '%') {
+            out[used++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[used++] = '%';
+            p += 2;
+            continue;
+        }
+        
+        const char* spec_start = p;
+        const char* spec_end = p + 1;
+        LogArgType type;
+        if (!parse_spec(&spec_end, &type) || arg_index >= rec->num_args) break;
+        
+        char spec[32];
+        size_t spec_len = spec_end - spec_start;
+        if (spec_len >= sizeof(spec)) break;
+        memcpy(spec, spec_start, spec_len);
+        spec[spec_len] = '\0';
+        
+        const LogArg* arg = &rec->args[arg_index++];
+        int n = 0;
+        switch (type) {
+            case LOG_ARG_INT: n = snprintf(out + used, size - used, spec, (int)arg->i); break;
+            case LOG_ARG_LONG: n = snprintf(out + used, size - used, spec, (long)arg->i); break;
+            case LOG_ARG_LLONG: n = snprintf(out + used, size - used, spec, arg->i); break;
+            case LOG_ARG_SIZE: n = snprintf(out + used, size - used, spec, (size_t)arg->i); break;
+            case LOG_ARG_DOUBLE: n = snprintf(out + used, size - used, spec, arg->d); break;
+            case LOG_ARG_PTR: n = snprintf(out + used, size - used, spec, arg->p); break;
+            case LOG_ARG_STR:
+                n = snprintf(out + used, size - used, spec, rec->strings + arg->str_offset);
+                break;
+        }
+        if (n < 0) break;
+        used += (size_t)n < size - used ? (size_t)n : size - used - 1;
+        p = spec_end;
+    }
+    
+    out[used] = '\0';
+}
+
+// Drain and print all pending records (single consumer only)
+size_t log_ring_drain(FILE* out) {
+    size_t drained = 0;
+    char message[512];
+    char timestamp[32];
+    
+    for (;;) {
+        LogRecord* rec = &ring[dequeue_pos & (LOG_RING_CAPACITY - 1)];
+        size_t seq = atomic_load_explicit(&rec->sequence, memory_order_acquire);
+        if (seq != dequeue_pos + 1) break;
+        
+        format_record(rec, message, sizeof(message));
+        
+        time_t wall = (time_t)(((int64_t)rec->timestamp_ns + realtime_offset_ns) / 1000000000LL);
+        struct tm t;
+        localtime_r(&wall, &t);
+        strftime(timestamp, sizeof(timestamp), "%H:%M:%S", &t);
+        
+        fprintf(out, "[%s] %s\n", timestamp, message);
+        
+        atomic_store_explicit(&rec->sequence, dequeue_pos + LOG_RING_CAPACITY, memory_order_release);
+        dequeue_pos++;
+        drained++;
+    }
+    
+    uint64_t dropped = atomic_load_explicit(&dropped_count, memory_order_relaxed);
+    if (dropped != dropped_reported) {
+        fprintf(out, "[log] %lu records dropped (ring full)\n", dropped - dropped_reported);
+        dropped_reported = dropped;
+        drained++;
+    }
+    
+    if (drained > 0) {
+        fflush(out);
+    }
+    
+    return drained;
+}
+
+// Total records dropped because the ring was full
+uint64_t log_ring_dropped() {
+    return atomic_load_explicit(&dropped_count, memory_order_relaxed);
+}
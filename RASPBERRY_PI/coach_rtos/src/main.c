@@ -2,158 +2,288 @@
 #include "scheduler.h"
 #include "tasks.h"
 #include "display.h"
+#include "log_ring.h"
+#include "bench.h"
+#include "usb_listener.h"
+#include "state.h"
+#include "cabins.h"
+#include "journal.h"
+#include "locks.h"
+#include "events.h"
+#include "rt.h"
+#include "shm_export.h"
+#include "shutdown.h"
+#include "shards.h"
+#include "sensors.h"
+#include "power.h"
+#include "peer.h"
 #include <signal.h>
 #include <stdarg.h>
 
 // Global System State Definition
 SystemState g_system;
 
-// Signal handler for graceful shutdown
+// Signal handler for graceful shutdown: async-signal-safe, it only trips
+// the shutdown latch; the main thread logs and tears down
 void signal_handler(int sig) {
     if (sig == SIGINT || sig == SIGTERM) {
-        log_message("Received shutdown signal, stopping system...");
-        g_system.system_running = false;
+        shutdown_request(sig);
     }
 }
 
-// Initialize system state
-void system_init() {
-    pthread_mutex_init(&g_system.system_mutex, NULL);
-    pthread_cond_init(&g_system.task_ready_cond, NULL);
+// Initialize system state. Returns 0 on success, -1 on failure.
+int system_init(int num_cabins) {
+    lock_init(&g_system.system_mutex, "system");
+    state_init();
     
     // Initialize cabins
-    for (int i = 0; i < NUM_CABINS; i++) {
-        g_system.cabins[i].id = i;
-        g_system.cabins[i].light_on = false;
-        g_system.cabins[i].temperature = 24; // Default 24°C
-        g_system.cabins[i].state = STATE_NORMAL;
-        pthread_mutex_init(&g_system.cabins[i].mutex, NULL);
+    if (cabins_init(&g_system.cabins, num_cabins) != 0) {
+        fprintf(stderr, "Cannot allocate %d cabins (1..%d)\n", num_cabins, MAX_CABINS);
+        return -1;
     }
+    if (events_init(num_cabins) != 0 || state_snapshot_pool_init() != 0) {
+        fprintf(stderr, "Cannot allocate event queues and snapshot buffers\n");
+        return -1;
+    }
+    
+    power_init();
     
     g_system.num_tasks = 0;
     g_system.system_running = true;
     g_system.power_low = false;
-    g_system.emergency_active = false;
-    g_system.fire_active = false;
+    g_system.chain_pulled = false;
     
-    log_message("System initialized with %d cabins", NUM_CABINS);
+    log_message("System initialized with %d cabins", num_cabins);
+    return 0;
 }
 
 // Cleanup system resources
 void system_cleanup() {
     log_message("Cleaning up system resources...");
     
-    pthread_mutex_destroy(&g_system.system_mutex);
-    pthread_cond_destroy(&g_system.task_ready_cond);
-    
-    for (int i = 0; i < NUM_CABINS; i++) {
-        pthread_mutex_destroy(&g_system.cabins[i].mutex);
-    }
+    lock_destroy(&g_system.system_mutex);
     
     display_cleanup();
+    
+    // All tasks are joined, so the main thread is now the only consumer
+    log_ring_drain(stdout);
+    
+    events_destroy();
+    cabins_destroy(&g_system.cabins);
 }
 
 // Utility: Get timestamp
 void get_timestamp(char* buffer, size_t size) {
     time_t now = time(NULL);
-    struct tm* t = localtime(&now);
-    strftime(buffer, size, "%H:%M:%S", t);
+    struct tm t;
+    localtime_r(&now, &t);
+    strftime(buffer, size, "%H:%M:%S", &t);
+}
+
+// Utility: Convert a timespec to nanoseconds
+uint64_t timespec_to_ns(const struct timespec* ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+// Utility: Monotonic clock in nanoseconds
+uint64_t monotonic_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_to_ns(&now);
 }
 
 // Utility: Log message
+// Enqueues a binary record into the log ring; the logging task formats
+// and prints it, so callers on the emergency paths never touch stdio.
 void log_message(const char* format, ...) {
-    char timestamp[32];
-    get_timestamp(timestamp, sizeof(timestamp));
-    
-    printf("[%s] ", timestamp);
-    
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    log_ring_vpush(format, args);
     va_end(args);
-    
-    printf("\n");
-    fflush(stdout);
 }
 
-// USB listener thread (reads from stdin)
-void* usb_listener_thread(void* arg) {
-    char buffer[256];
-    
-    log_message("USB listener started");
-    
-    while (g_system.system_running) {
-        if (fgets(buffer, sizeof(buffer), stdin) != NULL) {
-            // Remove newline
-            buffer[strcspn(buffer, "\n")] = 0;
-            
-            if (strlen(buffer) == 0) continue;
-            
-            log_message("Received command: %s", buffer);
-            
-            // Parse command
-            char cmd[32], param1[32], param2[32];
-            int n = sscanf(buffer, "%s %s %s", cmd, param1, param2);
-            
-            if (n >= 2) {
-                if (strcmp(cmd, "LIGHT") == 0) {
-                    int cabin_id = atoi(param1);
-                    if (cabin_id >= 0 && cabin_id < NUM_CABINS) {
-                        bool on = (n >= 3 && strcmp(param2, "ON") == 0);
-                        control_light(cabin_id, on);
-                    }
-                }
-                else if (strcmp(cmd, "TEMP") == 0) {
-                    int cabin_id = atoi(param1);
-                    int temp = atoi(param2);
-                    if (cabin_id >= 0 && cabin_id < NUM_CABINS) {
-                        adjust_temperature(cabin_id, temp);
-                    }
-                }
-                else if (strcmp(cmd, "EMERGENCY") == 0) {
-                    int cabin_id = atoi(param1);
-                    if (cabin_id >= 0 && cabin_id < NUM_CABINS) {
-                        handle_emergency(cabin_id);
-                    }
-                }
-                else if (strcmp(cmd, "FIRE") == 0) {
-                    int cabin_id = atoi(param1);
-                    if (cabin_id >= 0 && cabin_id < NUM_CABINS) {
-                        handle_fire_alert(cabin_id);
-                    }
-                }
-                else if (strcmp(cmd, "POWER") == 0) {
-                    if (strcmp(param1, "LOW") == 0) {
-                        handle_power_low();
-                    }
-                }
-                else if (strcmp(cmd, "CHAIN") == 0) {
-                    handle_chain_pull();
-                }
-                else if (strcmp(cmd, "STATUS") == 0) {
-                    scheduler_print_status();
-                }
+// Print command-line usage
+static void print_usage(const char* prog) {
+    printf("Usage: %s [--cabins N] [--device PATH] [--record PATH] [--no-prio-inherit]\n", prog);
+    printf("       %*s [--executor | --edf] [--rt] [--shm NAME] [--shards N]\n", (int)strlen(prog), "");
+    printf("       %*s [--sensors RATE [--sensor-fire N]]\n", (int)strlen(prog), "");
+    printf("       %*s [--peer ADDR [--coach-id N]] [--aggregate ADDR]\n", (int)strlen(prog), "");
+    printf("       %s --replay PATH [--speed N|max]\n", prog);
+    printf("       %s --bench NAME\n", prog);
+    printf("  --cabins N     Number of cabins (default %d, up to %d for a full rake)\n",
+           DEFAULT_NUM_CABINS, MAX_CABINS);
+    printf("  --device PATH  Read commands from a serial tty (raw mode), pty or FIFO\n");
+    printf("                 instead of stdin\n");
+    printf("  --record PATH  Journal every executed command to PATH\n");
+    printf("  --replay PATH  Feed a journal instead of reading commands, compare the\n");
+    printf("                 outcome with the recording and exit\n");
+    printf("  --speed N|max  Replay speed: 1 = recorded pace (default), N times faster,\n");
+    printf("                 or max for as fast as possible\n");
+    printf("  --no-prio-inherit\n");
+    printf("                 Create locks without priority inheritance (to compare)\n");
+    printf("  --executor     Run task steps on a pinned worker pool with work stealing\n");
+    printf("                 instead of one thread per task\n");
+    printf("  --edf          Dispatch by earliest deadline instead of static priority\n");
+    printf("                 (admission control and budgets apply in both modes)\n");
+    printf("  --rt           Lock memory, give threads small prefaulted stacks, serve\n");
+    printf("                 buffers from one arena and report RSS and page faults\n");
+    printf("  --shm NAME     Publish the state to POSIX shared memory NAME (e.g. %s)\n",
+           COACH_SHM_DEFAULT_NAME);
+    printf("                 for tools/coach_monitor and other readers\n");
+    printf("  --shards N     Give each of N threads (up to %d) sole ownership of a range\n", SHARD_MAX);
+    printf("                 of cabins and route cabin updates to its owner, no cabin locks\n");
+    printf("  --sensors RATE Feed RATE synthetic smoke/temperature samples per second over\n");
+    printf("                 all cabins into windowed sensor alarms\n");
+    printf("  --sensor-fire N\n");
+    printf("                 Make cabin N catch fire %d s into the synthetic feed\n",
+           SENSOR_SYNTH_FIRE_DELAY_S);
+    printf("  --peer ADDR    Send this coach's state changes every %d ms to the rake\n",
+           PEER_PERIOD_US / 1000);
+    printf("                 aggregator at ADDR: unix:PATH or udp:HOST:PORT (HOST may be\n");
+    printf("                 a multicast group)\n");
+    printf("  --coach-id N   This coach's position in the rake, 0..%d (default 0)\n",
+           PEER_MAX_COACHES - 1);
+    printf("  --aggregate ADDR\n");
+    printf("                 Receive every coach's state at ADDR and keep a rake view\n");
+    printf("                 (shown by STATUS); may be combined with --peer ADDR\n");
+    printf("  --bench NAME   Run a built-in benchmark and exit (--bench list)\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* device = NULL;
+    int num_cabins = DEFAULT_NUM_CABINS;
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+    double replay_speed = 1.0;
+    bool executor = false;
+    bool edf = false;
+    bool rt = false;
+    const char* shm_name = NULL;
+    int num_shards = 0;
+    double sensor_rate = 0.0;
+    int sensor_fire = -1;
+    const char* peer_address = NULL;
+    int coach_id = -1;
+    const char* aggregate_address = NULL;
+    Journal journal;
+    
+    log_ring_init();
+    lock_thread_set("main", 0);
+    
+    // Parse command line
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            return bench_run(argv[i + 1]);
+        } else if (strcmp(argv[i], "--cabins") == 0 && i + 1 < argc) {
+            num_cabins = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            device = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--no-prio-inherit") == 0) {
+            locks_set_priority_inherit(false);
+        } else if (strcmp(argv[i], "--executor") == 0) {
+            executor = true;
+        } else if (strcmp(argv[i], "--edf") == 0) {
+            edf = true;
+        } else if (strcmp(argv[i], "--rt") == 0) {
+            rt = true;
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_name = argv[++i];
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            num_shards = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sensors") == 0 && i + 1 < argc) {
+            sensor_rate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--sensor-fire") == 0 && i + 1 < argc) {
+            sensor_fire = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--peer") == 0 && i + 1 < argc) {
+            peer_address = argv[++i];
+        } else if (strcmp(argv[i], "--coach-id") == 0 && i + 1 < argc) {
+            coach_id = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--aggregate") == 0 && i + 1 < argc) {
+            aggregate_address = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            i++;
+            replay_speed = strcmp(argv[i], "max") == 0 ? REPLAY_SPEED_MAX : atof(argv[i]);
+            if (replay_speed < 0.0) {
+                print_usage(argv[0]);
+                return 1;
             }
+        } else {
+            print_usage(argv[0]);
+            return 1;
         }
-        usleep(50000); // 50ms
     }
     
-    log_message("USB listener stopped");
-    return NULL;
-}
-
-int main(int argc, char* argv[]) {
+    // The executor orders work by priority lanes, not deadlines; a fire
+    // needs the sensor feed, a coach id a peer address
+    if ((edf && executor) || sensor_rate < 0.0 || (sensor_fire >= 0 && sensor_rate <= 0.0) ||
+        (coach_id >= 0 && !peer_address) || coach_id >= PEER_MAX_COACHES) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
     printf("=================================================\n");
     printf("  RTOS Coach Subsystem Control Simulation\n");
     printf("  Indian Railways LHB Coach Management System\n");
     printf("=================================================\n\n");
     
     // Setup signal handlers
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    if (shutdown_init() != 0) return 1;
+    
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    
+    // A replay runs with the cabin count it was recorded with
+    if (replay_path) {
+        if (journal_replay_open(replay_path, &journal) != 0) return 1;
+        journal.speed = replay_speed;
+        num_cabins = (int)journal.header->num_cabins;
+    }
+    
+    // RT mode locks and reserves memory before anything is allocated
+    if (rt) {
+        if (rt_init(num_cabins, aggregate_address ? PEER_RAKE_BYTES : 0) != 0) return 1;
+        rt_thread_start("main");
+    }
     
     // Initialize system
-    system_init();
+    if (system_init(num_cabins) != 0) {
+        return 1;
+    }
+    
+    // Cabin ownership is fixed before anything can update a cabin
+    if (shards_init(num_shards) != 0) {
+        return 1;
+    }
+    
+    if (sensor_rate > 0.0 && sensors_init(num_cabins) != 0) {
+        fprintf(stderr, "Cannot allocate sensor buffers\n");
+        return 1;
+    }
+    if (sensor_fire >= num_cabins) {
+        fprintf(stderr, "No cabin %d to set on fire (0..%d)\n", sensor_fire, num_cabins - 1);
+        return 1;
+    }
+    
+    if (record_path && journal_record_open(record_path) != 0) {
+        return 1;
+    }
+    
+    if (shm_name && shm_export_open(shm_name) != 0) {
+        return 1;
+    }
+    
+    if (peer_address && peer_publish_open(peer_address, coach_id < 0 ? 0 : coach_id) != 0) {
+        return 1;
+    }
     
     // Initialize display
     if (display_init() != 0) {
@@ -162,30 +292,92 @@ int main(int argc, char* argv[]) {
     
     // Initialize scheduler
     scheduler_init();
+    scheduler_use_executor(executor);
+    scheduler_use_edf(edf);
     
     // Register all tasks
-    register_all_tasks();
+    if (register_all_tasks() != 0) {
+        return 1;
+    }
     
-    // Start USB listener thread
+    // Shards first: the listener and the tasks post to them
+    if (shards_enabled() && shards_start() != 0) {
+        return 1;
+    }
+    
+    if (sensors_enabled() && sensors_source_start(sensor_rate, sensor_fire) != 0) {
+        return 1;
+    }
+    
+    if (aggregate_address && peer_aggregate_start(aggregate_address) != 0) {
+        return 1;
+    }
+    
+    // Start USB listener thread, or the replay feeding the journal
     pthread_t usb_thread;
-    pthread_create(&usb_thread, NULL, usb_listener_thread, NULL);
+    pthread_attr_t usb_attr;
+    rt_thread_attr_init(&usb_attr, RT_THREAD_STACK_SIZE);
+    if (replay_path) {
+        pthread_create(&usb_thread, &usb_attr, journal_replay_thread, &journal);
+    } else {
+        pthread_create(&usb_thread, &usb_attr, usb_listener_thread, (void*)device);
+    }
+    pthread_attr_destroy(&usb_attr);
     
     // Start scheduler
     log_message("Starting scheduler...");
     scheduler_start();
     
+    // Report once every thread has prefaulted its stack; faults after
+    // this point show up in the shutdown report
+    if (rt) {
+        usleep(RT_REPORT_DELAY_US);
+        rt_report("startup");
+    }
+    
     // Main loop
-    log_message("System running. Commands: LIGHT, TEMP, EMERGENCY, FIRE, POWER, CHAIN, STATUS");
+    log_message("System running. Commands: LIGHT, TEMP, EMERGENCY, FIRE, POWER, CHAIN, STATUS, METRICS [RESET], LOCKS [RESET]");
     
-    while (g_system.system_running) {
-        sleep(1);
-    }
+    // Nothing to do until a signal or the end of a replay trips the latch
+    shutdown_wait();
+    shutdown_mark("main thread woken");
+    log_message("Shutdown requested, stopping system...");
     
-    // Cleanup
-    log_message("Shutting down system...");
+    // Cleanup (the stacks are read while the threads still exist)
+    if (rt) {
+        rt_report("shutdown");
+        shutdown_mark("RT report");
+    }
     scheduler_stop();
+    shutdown_mark("tasks joined");
     pthread_join(usb_thread, NULL);
+    shutdown_mark("input thread joined");
+    if (sensors_enabled()) {
+        sensors_source_stop();
+        shutdown_mark("sensor source joined");
+    }
+    if (shards_enabled()) {
+        shards_stop();
+        shutdown_mark("shards joined");
+    }
+    journal_record_close();
+    shm_export_close();
+    peer_publish_close();
+    if (replay_path) {
+        journal_replay_close(&journal);
+    }
+    shutdown_mark("outputs closed");
+    if (peer_aggregate_enabled()) {
+        peer_aggregate_stop();
+        shutdown_mark("aggregator joined");
+    }
     system_cleanup();
+    shutdown_mark("system cleaned up");
+    shutdown_report();
+    
+    if (log_ring_dropped() > 0) {
+        printf("Log records dropped: %lu\n", log_ring_dropped());
+    }
     
     printf("\n=================================================\n");
     printf("  System shutdown complete\n");
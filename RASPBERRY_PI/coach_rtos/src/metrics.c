@@ -0,0 +1,153 @@
+#include "metrics.h"
+
+// One histogram per metric, fixed at startup
+static Histogram metrics[NUM_METRICS];
+
+// Bucket for a value: exact below HISTOGRAM_SUB_BUCKETS, then
+// HISTOGRAM_SUB_BUCKETS linear steps per power of two
+static int bucket_index(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) return (int)value;
+    
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > HISTOGRAM_MAX_EXPONENT) return HISTOGRAM_BUCKETS - 1;
+    
+    int sub = (int)(value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+// Largest value that falls into a bucket
+static uint64_t bucket_upper(int index) {
+    if (index < HISTOGRAM_SUB_BUCKETS) return (uint64_t)index;
+    
+    int exponent = index / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = index % HISTOGRAM_SUB_BUCKETS;
+    uint64_t step = 1ULL << (exponent - HISTOGRAM_SUB_BITS);
+    return ((HISTOGRAM_SUB_BUCKETS + sub) << (exponent - HISTOGRAM_SUB_BITS)) + step - 1;
+}
+
+// Record one value; safe from any thread
+void histogram_record(Histogram* h, uint64_t value) {
+    __atomic_fetch_add(&h->counts[bucket_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, value, __ATOMIC_RELAXED);
+    
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (value > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, value, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Value at or below which `percentile` percent of samples fall (bucket
+// upper bound, capped at the recorded maximum); 0 if empty
+uint64_t histogram_percentile(const Histogram* h, double percentile) {
+    uint64_t count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+    if (count == 0) return 0;
+    
+    uint64_t rank = (uint64_t)(count * percentile / 100.0 + 0.5);
+    if (rank == 0) rank = 1;
+    
+    uint64_t seen = 0;
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(i);
+            return upper < max ? upper : max;
+        }
+    }
+    
+    return max;
+}
+
+void histogram_reset(Histogram* h) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        __atomic_store_n(&h->counts[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&h->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->total, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->max, 0, __ATOMIC_RELAXED);
+}
+
+// Record a latency sample for a metric
+void metrics_record(int metric, uint64_t ns) {
+    if (metric >= 0 && metric < NUM_METRICS) {
+        histogram_record(&metrics[metric], ns);
+    }
+}
+
+// Read-only view of one metric's histogram
+const Histogram* metrics_get(int metric) {
+    return &metrics[metric];
+}
+
+// Clear every metric (METRICS RESET)
+void metrics_reset() {
+    for (int i = 0; i < NUM_METRICS; i++) {
+        histogram_reset(&metrics[i]);
+    }
+}
+
+static void print_metric(const char* label, const char* task_name, const Histogram* h) {
+    if (h->count == 0) return;
+    
+    printf("%-10s %-26s %-10lu %-10.1f %-10.1f %-10.1f %-10.1f\n",
+           label, task_name, h->count,
+           histogram_percentile(h, 50.0) / 1000.0,
+           histogram_percentile(h, 90.0) / 1000.0,
+           histogram_percentile(h, 99.0) / 1000.0,
+           h->max / 1000.0);
+}
+
+// Print p50/p90/p99/max for every metric that has samples
+void metrics_print() {
+    printf("\n=== METRICS (us) ===\n");
+    printf("%-10s %-26s %-10s %-10s %-10s %-10s %-10s\n",
+           "Metric", "Task", "Count", "p50", "p90", "p99", "Max");
+    printf("----------------------------------------------------------------------------------------------\n");
+    
+    print_metric("dispatch", "(command rx -> execute)", &metrics[METRIC_COMMAND_DISPATCH]);
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        print_metric("wakeup", g_system.tasks[i].name, &metrics[METRIC_TASK_WAKEUP + i]);
+    }
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        print_metric("exec", g_system.tasks[i].name, &metrics[METRIC_TASK_EXEC + i]);
+    }
+    print_metric("thermal", "(control step, all cabins)", &metrics[METRIC_THERMAL_STEP]);
+    
+    printf("========================\n\n");
+    fflush(stdout);
+}
+
+static void print_metric_json(const char* name, const Histogram* h, bool first) {
+    printf("%s\"%s\":{\"count\":%lu,\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}",
+           first ? "" : ",", name, h->count,
+           histogram_percentile(h, 50.0) / 1000.0,
+           histogram_percentile(h, 90.0) / 1000.0,
+           histogram_percentile(h, 99.0) / 1000.0,
+           h->max / 1000.0);
+}
+
+static void print_task_metrics_json(const char* group, int first_metric) {
+    bool first = true;
+    
+    printf(",\"%s\":{", group);
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        const Histogram* h = &metrics[first_metric + i];
+        if (h->count == 0) continue;
+        print_metric_json(g_system.tasks[i].name, h, first);
+        first = false;
+    }
+    printf("}");
+}
+
+// Print every metric as one line, "METRICS {json}", for load generators
+void metrics_print_json() {
+    printf("METRICS {");
+    print_metric_json("dispatch", &metrics[METRIC_COMMAND_DISPATCH], true);
+    print_task_metrics_json("wakeup", METRIC_TASK_WAKEUP);
+    print_task_metrics_json("exec", METRIC_TASK_EXEC);
+    print_metric_json("thermal", &metrics[METRIC_THERMAL_STEP], false);
+    printf("}\n");
+    fflush(stdout);
+}
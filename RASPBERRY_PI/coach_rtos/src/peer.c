@@ -0,0 +1,669 @@
+#include "peer.h"
+#include "state.h"
+#include "locks.h"
+#include "metrics.h"
+#include "shutdown.h"
+#include "rt.h"
+#include <errno.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// A parsed unix:PATH or udp:HOST:PORT address
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t len;
+    int family;            // AF_UNIX or AF_INET
+    bool multicast;
+    size_t datagram_max;
+} PeerAddress;
+
+// Publisher state, owned by the publish task after open
+typedef struct {
+    int fd;
+    PeerAddress dest;
+    char address[108];
+    int coach_id;
+    PeerCabin* sent;       // What the aggregator was last sent, per cabin
+    uint8_t sent_flags;
+    uint32_t sequence;
+    uint32_t tick;
+    uint64_t keyframe_ns;  // Last keyframe sent
+    uint64_t batch_ns;     // Last batch sent
+    bool keyframe_due;     // After open and after a failed send
+    bool failing;
+    uint8_t datagram[PEER_UNIX_DATAGRAM_MAX];
+    
+    // Read without locking by STATUS
+    uint64_t batches;
+    uint64_t keyframes;
+    uint64_t datagrams;
+    uint64_t delta_bytes;
+    uint64_t keyframe_bytes;
+    uint64_t delta_updates;  // Cabin entries in delta batches
+    uint64_t send_failures;
+    uint64_t encode_total_ns;
+    uint64_t encode_max_ns;
+    uint64_t start_ns;
+} Publisher;
+
+// One coach in the rake view
+typedef struct {
+    bool seen;
+    bool synced;           // Holds a whole keyframe and every batch since
+    bool collecting;       // Receiving a keyframe with no gap so far
+    bool stale;
+    uint8_t flags;         // PEER_FLAG_POWER_LOW / CHAIN / RUNNING
+    int num_cabins;
+    PeerCabin* cabins;
+    int fire_cabins;
+    int emergency_cabins;
+    int lights_on;
+    uint32_t next_sequence;
+    uint64_t last_ns;      // Aggregator's clock at the last datagram
+    uint64_t datagrams;
+    uint64_t bytes;
+    uint64_t updates;
+    uint64_t lost;         // Datagrams missing from the sequence
+    uint64_t restarts;
+    Histogram latency;     // Publisher snapshot -> applied here
+} RakeCoach;
+
+// Aggregator state; the receiver thread writes the rake under rake_lock
+typedef struct {
+    int fd;
+    int stop_fd;
+    PeerAddress addr;
+    char address[108];
+    pthread_t thread;
+    bool started;
+    Lock rake_lock;
+    RakeCoach coaches[PEER_MAX_COACHES];
+    PeerCabin* views;      // PEER_MAX_COACHES views of MAX_CABINS entries
+    uint64_t malformed;
+    uint8_t datagram[PEER_UNIX_DATAGRAM_MAX];
+} Aggregator;
+
+static Publisher publisher = { .fd = -1 };
+static Aggregator aggregator = { .fd = -1, .stop_fd = -1 };
+
+// Little-endian field access
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put64(uint8_t* p, uint64_t v) {
+    put32(p, (uint32_t)v);
+    put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint64_t get64(const uint8_t* p) {
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+// Parse unix:PATH or udp:HOST:PORT (IPv4). Returns 0 or -1.
+static int parse_address(const char* text, PeerAddress* out) {
+    memset(out, 0, sizeof(*out));
+    
+    if (strncmp(text, "unix:", 5) == 0) {
+        struct sockaddr_un* un = (struct sockaddr_un*)&out->addr;
+        const char* path = text + 5;
+        
+        if (path[0] == '\0' || strlen(path) >= sizeof(un->sun_path)) return -1;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, path);
+        out->len = sizeof(*un);
+        out->family = AF_UNIX;
+        out->datagram_max = PEER_UNIX_DATAGRAM_MAX;
+        return 0;
+    }
+    
+    if (strncmp(text, "udp:", 4) == 0) {
+        struct sockaddr_in* in = (struct sockaddr_in*)&out->addr;
+        const char* colon = strrchr(text + 4, ':');
+        char host[INET_ADDRSTRLEN];
+        size_t host_len = colon ? (size_t)(colon - (text + 4)) : 0;
+        int port = colon ? atoi(colon + 1) : 0;
+        
+        if (host_len == 0 || host_len >= sizeof(host) || port <= 0 || port > 65535) return -1;
+        memcpy(host, text + 4, host_len);
+        host[host_len] = '\0';
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)port);
+        if (inet_pton(AF_INET, host, &in->sin_addr) != 1) return -1;
+        out->len = sizeof(*in);
+        out->family = AF_INET;
+        out->multicast = IN_MULTICAST(ntohl(in->sin_addr.s_addr));
+        out->datagram_max = PEER_UDP_DATAGRAM_MAX;
+        return 0;
+    }
+    
+    return -1;
+}
+
+// Open the publishing socket for coach `coach_id` and reserve the copy of
+// what was last sent. Returns 0 or -1.
+int peer_publish_open(const char* address, int coach_id) {
+    Publisher* p = &publisher;
+    
+    memset(p, 0, sizeof(*p));
+    p->fd = -1;
+    if (parse_address(address, &p->dest) != 0) {
+        log_message("Error: bad peer address %s (unix:PATH or udp:HOST:PORT)", address);
+        return -1;
+    }
+    
+    p->fd = socket(p->dest.family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (p->fd < 0) {
+        log_message("Error: cannot create peer socket: %s", strerror(errno));
+        return -1;
+    }
+    if (p->dest.multicast) {
+        unsigned char loop = 1, ttl = 1;
+        setsockopt(p->fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        setsockopt(p->fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    }
+    
+    p->sent = rt_alloc((size_t)g_system.cabins.count * sizeof(PeerCabin));
+    if (!p->sent) {
+        close(p->fd);
+        p->fd = -1;
+        return -1;
+    }
+    
+    strncpy(p->address, address, sizeof(p->address) - 1);
+    p->coach_id = coach_id;
+    p->keyframe_due = true;
+    p->start_ns = monotonic_now_ns();
+    log_message("Publishing coach %d state to %s", coach_id, address);
+    return 0;
+}
+
+bool peer_publish_enabled() {
+    return publisher.fd >= 0;
+}
+
+static void encode_cabin(const CabinView* view, PeerCabin* out) {
+    out->state = (uint8_t)view->state;
+    out->bits = (view->light_on ? PEER_CABIN_LIGHT : 0) |
+                (view->light_shed ? PEER_CABIN_LIGHT_SHED : 0) |
+                (view->hvac_on ? PEER_CABIN_HVAC : 0);
+    out->temperature = (int16_t)view->temperature;
+    out->setpoint = (int16_t)view->setpoint;
+}
+
+// Send the datagram being built (header filled in here). A failure (no
+// aggregator yet, or its queue full) drops the rest of the batch and
+// makes the next one a keyframe.
+static bool send_datagram(Publisher* p, uint8_t flags, int count, size_t len, uint64_t snap_ns) {
+    uint8_t* d = p->datagram;
+    
+    put32(d, PEER_MAGIC);
+    d[4] = PEER_VERSION;
+    d[5] = flags;
+    put16(d + 6, (uint16_t)p->coach_id);
+    put32(d + 8, p->sequence);
+    put16(d + 12, (uint16_t)g_system.cabins.count);
+    put16(d + 14, (uint16_t)count);
+    put64(d + 16, snap_ns);
+    put32(d + 24, p->tick);
+    
+    if (sendto(p->fd, d, len, MSG_DONTWAIT, (const struct sockaddr*)&p->dest.addr, p->dest.len) < 0) {
+        __atomic_store_n(&p->send_failures, p->send_failures + 1, __ATOMIC_RELAXED);
+        if (!p->failing) {
+            log_message("Peer: cannot send to %s: %s (keyframe next)", p->address, strerror(errno));
+        }
+        p->failing = true;
+        p->keyframe_due = true;
+        return false;
+    }
+    if (p->failing) {
+        log_message("Peer: sending to %s again", p->address);
+        p->failing = false;
+    }
+    
+    p->sequence++;
+    __atomic_store_n(&p->datagrams, p->datagrams + 1, __ATOMIC_RELAXED);
+    if (flags & PEER_FLAG_KEYFRAME) {
+        __atomic_store_n(&p->keyframe_bytes, p->keyframe_bytes + len, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&p->delta_bytes, p->delta_bytes + len, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+// Encode and send one batch from a snapshot: every cabin for a keyframe,
+// otherwise the cabins that differ from what was last sent. Nothing is
+// sent when nothing changed, except a header-only heartbeat.
+static void publish_batch(Publisher* p, const StateSnapshot* snap, uint64_t snap_ns, bool running) {
+    bool keyframe = p->keyframe_due || snap_ns - p->keyframe_ns >= PEER_KEYFRAME_US * 1000ULL;
+    uint8_t coach_flags = (snap->power_low ? PEER_FLAG_POWER_LOW : 0) |
+                          (snap->chain_pulled ? PEER_FLAG_CHAIN : 0) |
+                          (running ? PEER_FLAG_RUNNING : 0);
+    uint8_t kind = (keyframe ? PEER_FLAG_KEYFRAME : 0) | coach_flags;
+    uint8_t first = PEER_FLAG_FIRST;
+    size_t len = PEER_HEADER_SIZE;
+    int count = 0;
+    int updates = 0;
+    
+    for (int i = 0; i < snap->num_cabins; i++) {
+        PeerCabin cabin;
+        encode_cabin(&snap->cabins[i], &cabin);
+        if (!keyframe && memcmp(&cabin, &p->sent[i], sizeof(cabin)) == 0) continue;
+        
+        if (len + PEER_ENTRY_SIZE > p->dest.datagram_max) {
+            if (!send_datagram(p, kind | first, count, len, snap_ns)) return;
+            first = 0;
+            len = PEER_HEADER_SIZE;
+            count = 0;
+        }
+        
+        uint8_t* e = p->datagram + len;
+        put16(e, (uint16_t)i);
+        e[2] = cabin.state;
+        e[3] = cabin.bits;
+        put16(e + 4, (uint16_t)cabin.temperature);
+        put16(e + 6, (uint16_t)cabin.setpoint);
+        len += PEER_ENTRY_SIZE;
+        count++;
+        updates++;
+        p->sent[i] = cabin;
+    }
+    
+    bool changed = updates > 0 || coach_flags != p->sent_flags || !running;
+    if (!changed && snap_ns - p->batch_ns < PEER_HEARTBEAT_US * 1000ULL) return;
+    if (!send_datagram(p, kind | first | PEER_FLAG_LAST, count, len, snap_ns)) return;
+    
+    p->sent_flags = coach_flags;
+    p->batch_ns = snap_ns;
+    __atomic_store_n(&p->batches, p->batches + 1, __ATOMIC_RELAXED);
+    if (keyframe) {
+        p->keyframe_due = false;
+        p->keyframe_ns = snap_ns;
+        __atomic_store_n(&p->keyframes, p->keyframes + 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&p->delta_updates, p->delta_updates + updates, __ATOMIC_RELAXED);
+    }
+}
+
+static void publish(bool running) {
+    Publisher* p = &publisher;
+    StateSnapshot snap;
+    
+    if (p->fd < 0 || state_snapshot_alloc(&snap) != 0) return;
+    
+    uint64_t start_ns = monotonic_now_ns();
+    state_snapshot(&snap);
+    publish_batch(p, &snap, start_ns, running);
+    __atomic_store_n(&p->tick, p->tick + 1, __ATOMIC_RELAXED);
+    state_snapshot_free(&snap);
+    
+    uint64_t elapsed_ns = monotonic_now_ns() - start_ns;
+    __atomic_store_n(&p->encode_total_ns, p->encode_total_ns + elapsed_ns, __ATOMIC_RELAXED);
+    if (elapsed_ns > p->encode_max_ns) {
+        __atomic_store_n(&p->encode_max_ns, elapsed_ns, __ATOMIC_RELAXED);
+    }
+}
+
+// One publish tick: the changes since the last batch
+void peer_publish_tick() {
+    publish(true);
+}
+
+// Send a last batch marked not running and close the socket
+void peer_publish_close() {
+    if (publisher.fd < 0) return;
+    
+    publish(false);
+    close(publisher.fd);
+    publisher.fd = -1;
+    rt_free(publisher.sent);
+    publisher.sent = NULL;
+}
+
+// Start a fresh view of a coach (first datagram, a restart or a new
+// size) in its reserved slot, which holds up to MAX_CABINS cabins
+static int rake_reset(RakeCoach* coach, int num_cabins) {
+    if (num_cabins > MAX_CABINS) return -1;
+    
+    memset(coach->cabins, 0, (size_t)num_cabins * sizeof(PeerCabin));
+    coach->num_cabins = num_cabins;
+    coach->fire_cabins = 0;
+    coach->emergency_cabins = 0;
+    coach->lights_on = 0;
+    coach->synced = false;
+    coach->collecting = false;
+    return 0;
+}
+
+// Apply one cabin entry, keeping the coach's counts current
+static void rake_apply(RakeCoach* coach, int cabin_id, const PeerCabin* cabin) {
+    PeerCabin* old = &coach->cabins[cabin_id];
+    
+    coach->fire_cabins += (cabin->state == STATE_FIRE) - (old->state == STATE_FIRE);
+    coach->emergency_cabins += (cabin->state == STATE_EMERGENCY) - (old->state == STATE_EMERGENCY);
+    coach->lights_on += ((cabin->bits & PEER_CABIN_LIGHT) != 0) - ((old->bits & PEER_CABIN_LIGHT) != 0);
+    *old = *cabin;
+}
+
+// Check and apply one datagram. A sequence gap unsyncs the coach until
+// the next complete keyframe; a sequence going backwards is a restarted
+// publisher.
+static void receive_datagram(Aggregator* a, const uint8_t* d, size_t len, uint64_t now_ns) {
+    if (len < PEER_HEADER_SIZE || get32(d) != PEER_MAGIC || d[4] != PEER_VERSION) {
+        a->malformed++;
+        return;
+    }
+    
+    uint8_t flags = d[5];
+    int coach_id = get16(d + 6);
+    uint32_t sequence = get32(d + 8);
+    int num_cabins = get16(d + 12);
+    int count = get16(d + 14);
+    uint64_t sent_ns = get64(d + 16);
+    
+    if (coach_id >= PEER_MAX_COACHES || num_cabins == 0 || num_cabins > MAX_CABINS ||
+        len != PEER_HEADER_SIZE + (size_t)count * PEER_ENTRY_SIZE) {
+        a->malformed++;
+        return;
+    }
+    
+    lock_acquire(&a->rake_lock);
+    RakeCoach* coach = &a->coaches[coach_id];
+    
+    if (!coach->seen || num_cabins != coach->num_cabins || sequence < coach->next_sequence) {
+        if (coach->seen) coach->restarts++;
+        if (rake_reset(coach, num_cabins) != 0) {
+            lock_release(&a->rake_lock);
+            return;
+        }
+        coach->seen = true;
+    } else if (sequence != coach->next_sequence) {
+        coach->lost += sequence - coach->next_sequence;
+        coach->synced = false;
+        coach->collecting = false;
+    }
+    coach->next_sequence = sequence + 1;
+    
+    if ((flags & PEER_FLAG_KEYFRAME) && (flags & PEER_FLAG_FIRST)) coach->collecting = true;
+    
+    const uint8_t* e = d + PEER_HEADER_SIZE;
+    for (int k = 0; k < count; k++, e += PEER_ENTRY_SIZE) {
+        int cabin_id = get16(e);
+        if (cabin_id >= num_cabins) continue;
+        
+        PeerCabin cabin = { .state = e[2], .bits = e[3], .temperature = (int16_t)get16(e + 4),
+                            .setpoint = (int16_t)get16(e + 6) };
+        rake_apply(coach, cabin_id, &cabin);
+    }
+    
+    if ((flags & PEER_FLAG_KEYFRAME) && (flags & PEER_FLAG_LAST) && coach->collecting) {
+        coach->synced = true;
+        coach->collecting = false;
+    }
+    
+    coach->flags = flags & (PEER_FLAG_POWER_LOW | PEER_FLAG_CHAIN | PEER_FLAG_RUNNING);
+    coach->last_ns = now_ns;
+    coach->datagrams++;
+    coach->bytes += len;
+    coach->updates += count;
+    if (flags & PEER_FLAG_LAST) {
+        histogram_record(&coach->latency, now_ns > sent_ns ? now_ns - sent_ns : 0);
+    }
+    lock_release(&a->rake_lock);
+}
+
+// Log coaches going stale (no datagram for PEER_STALE_US while running)
+// and coming back
+static void check_staleness(Aggregator* a, uint64_t now_ns) {
+    lock_acquire(&a->rake_lock);
+    for (int c = 0; c < PEER_MAX_COACHES; c++) {
+        RakeCoach* coach = &a->coaches[c];
+        if (!coach->seen) continue;
+        
+        bool stale = (coach->flags & PEER_FLAG_RUNNING) &&
+                     now_ns - coach->last_ns > PEER_STALE_US * 1000ULL;
+        if (stale && !coach->stale) {
+            log_message("Rake: coach %d stale (no update for %lu ms)", c,
+                        (now_ns - coach->last_ns) / 1000000);
+        } else if (!stale && coach->stale) {
+            log_message("Rake: coach %d updating again", c);
+        }
+        coach->stale = stale;
+    }
+    lock_release(&a->rake_lock);
+}
+
+static void* aggregator_thread(void* arg) {
+    Aggregator* a = (Aggregator*)arg;
+    struct pollfd pfds[3] = {
+        { .fd = a->fd, .events = POLLIN },
+        { .fd = a->stop_fd, .events = POLLIN },
+        { .fd = shutdown_fd(), .events = POLLIN },
+    };
+    uint64_t checked_ns = 0;
+    
+    lock_thread_set("aggregator", 0);
+    rt_thread_start("aggregator");
+    
+    for (;;) {
+        int ready = poll(pfds, 3, PEER_STALE_US / 4000);
+        if (ready < 0 && errno != EINTR) {
+            log_message("Error: aggregator poll failed: %s", strerror(errno));
+            break;
+        }
+        if ((pfds[1].revents | pfds[2].revents) & POLLIN) break;
+        
+        // Drain everything queued before looking at the clock again
+        while (pfds[0].revents & POLLIN) {
+            ssize_t n = recv(a->fd, a->datagram, sizeof(a->datagram), MSG_DONTWAIT);
+            if (n < 0) break;
+            receive_datagram(a, a->datagram, (size_t)n, monotonic_now_ns());
+        }
+        
+        uint64_t now_ns = monotonic_now_ns();
+        if (now_ns - checked_ns >= PEER_STALE_US * 1000ULL / 4) {
+            check_staleness(a, now_ns);
+            checked_ns = now_ns;
+        }
+    }
+    
+    rt_thread_stop();
+    return NULL;
+}
+
+// Bind the aggregator socket (joining the group for a multicast address)
+// and start the receiver thread. Returns 0 or -1.
+int peer_aggregate_start(const char* address) {
+    Aggregator* a = &aggregator;
+    
+    if (parse_address(address, &a->addr) != 0) {
+        log_message("Error: bad aggregate address %s (unix:PATH or udp:HOST:PORT)", address);
+        return -1;
+    }
+    
+    a->fd = socket(a->addr.family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (a->fd < 0) {
+        log_message("Error: cannot create aggregator socket: %s", strerror(errno));
+        return -1;
+    }
+    int rcvbuf = PEER_RECV_BUFFER;
+    setsockopt(a->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    
+    // A multicast group is received on its port on every interface
+    struct sockaddr_storage bind_addr = a->addr.addr;
+    if (a->addr.family == AF_UNIX) {
+        unlink(((struct sockaddr_un*)&a->addr.addr)->sun_path);
+    } else if (a->addr.multicast) {
+        int reuse = 1;
+        setsockopt(a->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        ((struct sockaddr_in*)&bind_addr)->sin_addr.s_addr = htonl(INADDR_ANY);
+    }
+    
+    if (bind(a->fd, (struct sockaddr*)&bind_addr, a->addr.len) != 0) {
+        log_message("Error: cannot bind %s: %s", address, strerror(errno));
+        close(a->fd);
+        a->fd = -1;
+        return -1;
+    }
+    if (a->addr.multicast) {
+        struct ip_mreq mreq = { .imr_multiaddr = ((struct sockaddr_in*)&a->addr.addr)->sin_addr,
+                                .imr_interface.s_addr = htonl(INADDR_ANY) };
+        if (setsockopt(a->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+            log_message("Error: cannot join %s: %s", address, strerror(errno));
+            close(a->fd);
+            a->fd = -1;
+            return -1;
+        }
+    }
+    
+    // Every coach's view is reserved up front, so the receiver never
+    // allocates when a coach appears, restarts or changes size
+    a->views = rt_alloc(PEER_RAKE_BYTES);
+    if (!a->views) {
+        log_message("Error: cannot reserve the rake view");
+        close(a->fd);
+        a->fd = -1;
+        return -1;
+    }
+    for (int c = 0; c < PEER_MAX_COACHES; c++) {
+        a->coaches[c].cabins = a->views + (size_t)c * MAX_CABINS;
+    }
+    
+    a->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    lock_init(&a->rake_lock, "rake");
+    strncpy(a->address, address, sizeof(a->address) - 1);
+    
+    pthread_attr_t attr;
+    rt_thread_attr_init(&attr, RT_THREAD_STACK_SIZE);
+    a->started = a->stop_fd >= 0 && pthread_create(&a->thread, &attr, aggregator_thread, a) == 0;
+    pthread_attr_destroy(&attr);
+    if (!a->started) {
+        log_message("Error: Failed to create aggregator thread");
+        peer_aggregate_stop();
+        return -1;
+    }
+    
+    log_message("Aggregating rake state from %s", address);
+    return 0;
+}
+
+bool peer_aggregate_enabled() {
+    return aggregator.fd >= 0;
+}
+
+// Stop and join the receiver, then close (and for unix:, remove) the socket
+void peer_aggregate_stop() {
+    Aggregator* a = &aggregator;
+    
+    if (a->fd < 0) return;
+    if (a->started) {
+        uint64_t one = 1;
+        ssize_t n = write(a->stop_fd, &one, sizeof(one));
+        (void)n;
+        pthread_join(a->thread, NULL);
+        a->started = false;
+        lock_destroy(&a->rake_lock);
+    }
+    if (a->stop_fd >= 0) close(a->stop_fd);
+    close(a->fd);
+    if (a->addr.family == AF_UNIX) {
+        unlink(((struct sockaddr_un*)&a->addr.addr)->sun_path);
+    }
+    
+    rt_free(a->views);
+    a->views = NULL;
+    memset(a->coaches, 0, sizeof(a->coaches));
+    a->fd = -1;
+    a->stop_fd = -1;
+}
+
+// Where the rake view stands for one coach: the sequence it expects next
+// and whether it is in sync. Returns false if the coach was never heard.
+bool peer_rake_coach(int coach_id, uint32_t* next_sequence, bool* synced) {
+    Aggregator* a = &aggregator;
+    bool seen;
+    
+    if (a->fd < 0 || coach_id < 0 || coach_id >= PEER_MAX_COACHES) return false;
+    lock_acquire(&a->rake_lock);
+    seen = a->coaches[coach_id].seen;
+    *next_sequence = a->coaches[coach_id].next_sequence;
+    *synced = a->coaches[coach_id].synced;
+    lock_release(&a->rake_lock);
+    return seen;
+}
+
+// Publisher bandwidth and the aggregated rake view, for STATUS
+void peer_print_stats() {
+    Publisher* p = &publisher;
+    
+    if (p->fd >= 0) {
+        uint64_t batches = __atomic_load_n(&p->batches, __ATOMIC_RELAXED);
+        uint64_t keyframes = __atomic_load_n(&p->keyframes, __ATOMIC_RELAXED);
+        uint64_t delta_bytes = __atomic_load_n(&p->delta_bytes, __ATOMIC_RELAXED);
+        uint64_t keyframe_bytes = __atomic_load_n(&p->keyframe_bytes, __ATOMIC_RELAXED);
+        uint64_t updates = __atomic_load_n(&p->delta_updates, __ATOMIC_RELAXED);
+        uint64_t deltas = batches - keyframes;
+        uint32_t ticks = __atomic_load_n(&p->tick, __ATOMIC_RELAXED);
+        double elapsed_s = (monotonic_now_ns() - p->start_ns) / 1e9;
+        
+        printf("\nPeer publishing (coach %d to %s):\n", p->coach_id, p->address);
+        printf("Batches: %lu (%lu keyframes) in %lu datagrams, %lu send failures\n", batches, keyframes,
+               __atomic_load_n(&p->datagrams, __ATOMIC_RELAXED),
+               __atomic_load_n(&p->send_failures, __ATOMIC_RELAXED));
+        printf("Deltas: %lu cabin updates, %.1f bytes/update, %.1f bytes/batch; keyframes %.0f bytes each\n",
+               updates, updates ? (double)(delta_bytes - deltas * PEER_HEADER_SIZE) / updates : 0.0,
+               deltas ? (double)delta_bytes / deltas : 0.0,
+               keyframes ? (double)keyframe_bytes / keyframes : 0.0);
+        printf("Bandwidth: %.1f kB/s (deltas %.1f kB/s); tick avg %.1f us, max %.1f us\n",
+               elapsed_s > 0 ? (delta_bytes + keyframe_bytes) / elapsed_s / 1000.0 : 0.0,
+               elapsed_s > 0 ? delta_bytes / elapsed_s / 1000.0 : 0.0,
+               ticks ? __atomic_load_n(&p->encode_total_ns, __ATOMIC_RELAXED) / (double)ticks / 1000.0 : 0.0,
+               __atomic_load_n(&p->encode_max_ns, __ATOMIC_RELAXED) / 1000.0);
+    }
+    
+    Aggregator* a = &aggregator;
+    if (a->fd < 0) return;
+    
+    uint64_t now_ns = monotonic_now_ns();
+    printf("\nRake view (from %s, %lu malformed):\n", a->address, a->malformed);
+    printf("%-6s %-7s %-8s %-9s %-5s %-6s %-7s %-6s %-7s %-10s %-9s %-6s %-9s %-9s\n", "Coach", "Cabins",
+           "Status", "Age(ms)", "Fire", "Emerg", "Lights", "Power", "Chain", "Updates", "kB", "Lost",
+           "p50(us)", "p99(us)");
+    printf("---------------------------------------------------------------------------------------------------------------------\n");
+    
+    lock_acquire(&a->rake_lock);
+    for (int c = 0; c < PEER_MAX_COACHES; c++) {
+        RakeCoach* coach = &a->coaches[c];
+        if (!coach->seen) continue;
+        
+        const char* status = !(coach->flags & PEER_FLAG_RUNNING) ? "stopped" :
+                             coach->stale ? "STALE" : coach->synced ? "synced" : "resync";
+        printf("%-6d %-7d %-8s %-9.1f %-5d %-6d %-7d %-6s %-7s %-10lu %-9.1f %-6lu %-9.1f %-9.1f\n", c,
+               coach->num_cabins, status, (now_ns - coach->last_ns) / 1e6, coach->fire_cabins,
+               coach->emergency_cabins, coach->lights_on,
+               (coach->flags & PEER_FLAG_POWER_LOW) ? "LOW" : "OK",
+               (coach->flags & PEER_FLAG_CHAIN) ? "PULLED" : "-", coach->updates, coach->bytes / 1000.0,
+               coach->lost,
+               histogram_percentile(&coach->latency, 50.0) / 1000.0,
+               histogram_percentile(&coach->latency, 99.0) / 1000.0);
+    }
+    lock_release(&a->rake_lock);
+}
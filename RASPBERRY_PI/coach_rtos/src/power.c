@@ -0,0 +1,176 @@
+#include "power.h"
+#include "cabins.h"
+#include "shards.h"
+#include "state.h"
+#include "display.h"
+#include <stdatomic.h>
+
+// Shed priority: loads earlier in the table go first
+typedef struct {
+    const char* name;
+    CabinOp op;
+    int watts;
+} PowerLoad;
+
+static const PowerLoad loads[] = {
+    { "lights", CABIN_OP_SHED_LIGHT, POWER_LIGHT_LOAD_W },
+    { "HVAC", CABIN_OP_SHED_HVAC, POWER_HVAC_LOAD_W },
+};
+
+#define NUM_LOADS ((int)(sizeof(loads) / sizeof(loads[0])))
+
+// Requested supply (any thread) and what the cabins currently reflect
+// (power management task only; read without locking by STATUS). Load l
+// is planned shed in cabins [count - shed[l], count); shed_actual[l]
+// counts the loads really switched off, which leaves out fire and
+// emergency cabins in that range (updated as the switches complete,
+// from the shards with --shards).
+static atomic_int supply_target;
+static int supply_applied;
+static int shed[NUM_LOADS];
+static atomic_int shed_actual[NUM_LOADS];
+
+static atomic_uint_fast64_t supply_changes;
+static atomic_uint_fast64_t loads_switched;  // Cabins whose load actually changed
+static uint64_t rebalances;
+static uint64_t loads_in_range;               // Cabins between old and new boundaries
+
+void power_init() {
+    atomic_store(&supply_target, POWER_SUPPLY_FULL);
+    supply_applied = POWER_SUPPLY_FULL;
+    for (int l = 0; l < NUM_LOADS; l++) {
+        shed[l] = 0;
+        atomic_store(&shed_actual[l], 0);
+    }
+    atomic_store(&supply_changes, 0);
+    atomic_store(&loads_switched, 0);
+    rebalances = 0;
+    loads_in_range = 0;
+}
+
+// Record a new supply level. Returns false if it is already the target.
+bool power_set_supply(int percent) {
+    if (atomic_exchange(&supply_target, percent) == percent) return false;
+    atomic_fetch_add_explicit(&supply_changes, 1, memory_order_relaxed);
+    return true;
+}
+
+// Loads of each kind to shed so the rest fits `percent` of the full load
+static void shed_plan(int percent, int count, int* plan) {
+    int64_t per_cabin = 0;
+    for (int l = 0; l < NUM_LOADS; l++) per_cabin += loads[l].watts;
+    
+    int64_t full = per_cabin * count;
+    int64_t excess = full - full * percent / 100;
+    
+    for (int l = 0; l < NUM_LOADS; l++) {
+        int64_t n = excess > 0 ? (excess + loads[l].watts - 1) / loads[l].watts : 0;
+        plan[l] = n < count ? (int)n : count;
+        excess -= (int64_t)plan[l] * loads[l].watts;
+    }
+}
+
+static void switched(CabinOp op, int value, int total) {
+    for (int l = 0; l < NUM_LOADS; l++) {
+        if (loads[l].op == op) {
+            atomic_fetch_add_explicit(&shed_actual[l], value ? total : -total, memory_order_relaxed);
+        }
+    }
+    atomic_fetch_add_explicit(&loads_switched, total, memory_order_relaxed);
+}
+
+// Shed (value 1) or restore (0) one load in cabins [first, end): posted
+// to the owning shards, or applied here one word per stripe hold
+static void switch_range(CabinOp op, int first, int end, int value) {
+    CabinStore* cabins = &g_system.cabins;
+    
+    __atomic_store_n(&loads_in_range, loads_in_range + (end - first), __ATOMIC_RELAXED);
+    if (shards_enabled()) {
+        shards_post_range(first, end, op, value, switched);
+        return;
+    }
+    
+    int total = 0;
+    while (first < end) {
+        int word_end = (first / CABINS_PER_WORD + 1) * CABINS_PER_WORD;
+        int stop = word_end < end ? word_end : end;
+        
+        cabin_lock(cabins, first);
+        total += cabins_apply_range(cabins, first, stop, op, value);
+        cabin_unlock(cabins, first);
+        first = stop;
+    }
+    switched(op, value, total);
+}
+
+void power_plan(int percent, int* lights, int* hvac) {
+    int plan[NUM_LOADS];
+    
+    shed_plan(percent, g_system.cabins.count, plan);
+    *lights = plan[0];
+    *hvac = plan[1];
+}
+
+// Bring the cabins in line with the latest supply level: move each load's
+// shed boundary, switching only the cabins it passes
+void power_rebalance() {
+    int percent = atomic_load(&supply_target);
+    int count = g_system.cabins.count;
+    int plan[NUM_LOADS];
+    int before[NUM_LOADS];
+    
+    if (percent == supply_applied) return;
+    
+    shed_plan(percent, count, plan);
+    for (int l = 0; l < NUM_LOADS; l++) {
+        before[l] = shed[l];
+        if (plan[l] > shed[l]) {
+            switch_range(loads[l].op, count - plan[l], count - shed[l], 1);
+        } else if (plan[l] < shed[l]) {
+            switch_range(loads[l].op, count - shed[l], count - plan[l], 0);
+        }
+        __atomic_store_n(&shed[l], plan[l], __ATOMIC_RELAXED);
+    }
+    
+    bool was_low = supply_applied < POWER_SUPPLY_FULL;
+    bool low = percent < POWER_SUPPLY_FULL;
+    __atomic_store_n(&supply_applied, percent, __ATOMIC_RELAXED);
+    __atomic_store_n(&rebalances, rebalances + 1, __ATOMIC_RELAXED);
+    
+    log_message("Power supply %d%%: shedding up to %d lights (%+d), %d HVAC (%+d)", percent,
+                plan[0], plan[0] - before[0], plan[1], plan[1] - before[1]);
+    
+    if (low != was_low) {
+        state_write_begin();
+        g_system.power_low = low;
+        state_write_end();
+        display_status_message(low ? "LOW POWER MODE" : "POWER RESTORED");
+    }
+}
+
+// Budget state and how much work the supply changes caused, for STATUS.
+// Loads left on in fire and emergency cabins inside the shed range show
+// as the gap between planned and shed, and may leave the unshed load
+// over the supply.
+void power_print_stats() {
+    int count = g_system.cabins.count;
+    int percent = __atomic_load_n(&supply_applied, __ATOMIC_RELAXED);
+    long full = (long)count * (POWER_LIGHT_LOAD_W + POWER_HVAC_LOAD_W);
+    long drawn = 0;
+    
+    printf("\nPower budget (supply %d%% of %ld W):\n", percent, full);
+    for (int l = 0; l < NUM_LOADS; l++) {
+        int actual = atomic_load_explicit(&shed_actual[l], memory_order_relaxed);
+        
+        drawn += (long)(count - actual) * loads[l].watts;
+        printf("  %-8s %d W each, %d of %d shed (%d planned)\n", loads[l].name, loads[l].watts,
+               actual, count, __atomic_load_n(&shed[l], __ATOMIC_RELAXED));
+    }
+    printf("  Unshed load %ld W of %ld W supplied%s\n", drawn, full * percent / 100,
+           drawn > full * percent / 100 ? " (over budget: critical cabins kept powered)" : "");
+    printf("  Supply changes: %lu, rebalances: %lu, cabins in range: %lu, loads switched: %lu\n",
+           (uint64_t)atomic_load_explicit(&supply_changes, memory_order_relaxed),
+           __atomic_load_n(&rebalances, __ATOMIC_RELAXED),
+           __atomic_load_n(&loads_in_range, __ATOMIC_RELAXED),
+           (uint64_t)atomic_load_explicit(&loads_switched, memory_order_relaxed));
+}
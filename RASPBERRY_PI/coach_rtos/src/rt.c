@@ -0,0 +1,216 @@
+#define _GNU_SOURCE
+#include "rt.h"
+#include <errno.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+// A thread's stack: the painted range and the top, for the high-water mark
+typedef struct {
+    pthread_t thread;
+    const char* name;
+    uintptr_t painted_low;   // Lowest painted byte
+    uintptr_t top;           // One past the highest stack byte
+    size_t size;             // Stack size (main: the rlimit)
+} RtThread;
+
+static bool rt_mode = false;
+static int lock_error = 0;   // errno from mlockall(), 0 if memory is locked
+
+// Runtime buffer arena: one locked, prefaulted mapping, bump allocated
+static uint8_t* arena = NULL;
+static size_t arena_capacity = 0;
+static size_t arena_used = 0;
+static uint64_t heap_fallbacks = 0;
+
+static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static RtThread threads[RT_MAX_THREADS];
+static int num_threads = 0;
+
+// Fault counts at the previous report
+static long last_minor_faults = 0;
+static long last_major_faults = 0;
+
+// Enter RT mode: lock all current and future memory, keep the heap from
+// ever being trimmed or served by fresh mmaps, and reserve the arena.
+// Failing to lock (no CAP_IPC_LOCK, low RLIMIT_MEMLOCK) is reported but
+// not fatal; everything is still prefaulted. extra_bytes is arena room
+// beyond the per-cabin share, for buffers not sized by the cabin count
+// (the rake view). Returns 0 or -1.
+int rt_init(int num_cabins, size_t extra_bytes) {
+    rt_mode = true;
+    
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        lock_error = errno;
+        log_message("Warning: mlockall failed (%s); memory is prefaulted but not locked",
+                    strerror(lock_error));
+    }
+    
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    mallopt(M_ARENA_MAX, 1);
+    
+    arena_capacity = RT_ARENA_BASE + (size_t)num_cabins * RT_ARENA_PER_CABIN + extra_bytes;
+    void* map = mmap(NULL, arena_capacity, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Cannot reserve a %zu byte arena\n", arena_capacity);
+        return -1;
+    }
+    arena = (uint8_t*)map;
+    arena_used = 0;
+    
+    return 0;
+}
+
+bool rt_enabled() {
+    return rt_mode;
+}
+
+// Zeroed, 64-byte aligned buffer. In RT mode it is carved from the arena
+// and never returned; a full arena falls back to the heap (counted in the
+// report).
+void* rt_alloc(size_t bytes) {
+    size_t rounded = (bytes + 63) & ~(size_t)63;
+    if (rounded == 0) rounded = 64;
+    
+    if (arena) {
+        size_t offset = __atomic_fetch_add(&arena_used, rounded, __ATOMIC_RELAXED);
+        if (offset + rounded <= arena_capacity) return arena + offset;
+        __atomic_fetch_sub(&arena_used, rounded, __ATOMIC_RELAXED);
+    }
+    if (rt_mode) {
+        __atomic_fetch_add(&heap_fallbacks, 1, __ATOMIC_RELAXED);
+    }
+    
+    void* p = aligned_alloc(64, rounded);
+    if (p) memset(p, 0, rounded);
+    return p;
+}
+
+// Free a buffer from rt_alloc(); arena buffers live until exit
+void rt_free(void* p) {
+    if (arena && (uint8_t*)p >= arena && (uint8_t*)p < arena + arena_capacity) return;
+    free(p);
+}
+
+void rt_thread_attr_init(pthread_attr_t* attr, size_t stack_size) {
+    pthread_attr_init(attr);
+    if (rt_mode) {
+        pthread_attr_setstacksize(attr, stack_size);
+    }
+}
+
+// Touch `bytes` of stack below the caller with the paint pattern and
+// return the lowest address touched
+static uintptr_t __attribute__((noinline)) paint_stack(size_t bytes) {
+    unsigned char* area = alloca(bytes);
+    memset(area, RT_STACK_PATTERN, bytes);
+    __asm__ volatile("" : : "r"(area) : "memory");
+    return (uintptr_t)area;
+}
+
+// Prefault the calling thread's stack (up to RT_STACK_PREFAULT_MAX below
+// this frame) and list it in the report. No-op outside RT mode.
+void rt_thread_start(const char* name) {
+    if (!rt_mode) return;
+    
+    pthread_attr_t attr;
+    void* stack_addr;
+    size_t stack_size;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) return;
+    pthread_attr_getstack(&attr, &stack_addr, &stack_size);
+    pthread_attr_destroy(&attr);
+    
+    uintptr_t low = (uintptr_t)stack_addr;
+    uintptr_t here = (uintptr_t)__builtin_frame_address(0);
+    size_t room = here - low;
+    
+    // Leave a margin for paint_stack()'s own frame and the guard page
+    size_t paint = room > 2 * RT_STACK_MARGIN ? room - 2 * RT_STACK_MARGIN : 0;
+    if (paint > RT_STACK_PREFAULT_MAX) paint = RT_STACK_PREFAULT_MAX;
+    uintptr_t painted_low = paint ? paint_stack(paint) : here;
+    
+    pthread_mutex_lock(&threads_mutex);
+    if (num_threads < RT_MAX_THREADS) {
+        threads[num_threads].thread = pthread_self();
+        threads[num_threads].name = name;
+        threads[num_threads].painted_low = painted_low;
+        threads[num_threads].top = low + stack_size;
+        threads[num_threads].size = stack_size;
+        num_threads++;
+    }
+    pthread_mutex_unlock(&threads_mutex);
+}
+
+// Drop the calling thread from the report before its stack goes away
+void rt_thread_stop() {
+    if (!rt_mode) return;
+    
+    pthread_mutex_lock(&threads_mutex);
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_equal(threads[i].thread, pthread_self())) {
+            threads[i] = threads[--num_threads];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&threads_mutex);
+}
+
+// Deepest stack use: the first byte above the painted range's untouched
+// part that no longer holds the pattern
+static size_t stack_used(const RtThread* thread) {
+    const unsigned char* p = (const unsigned char*)thread->painted_low;
+    const unsigned char* top = (const unsigned char*)thread->top;
+    
+    while (p < top && *p == RT_STACK_PATTERN) p++;
+    return (size_t)(top - p);
+}
+
+static void read_memory_kb(long* rss, long* peak, long* locked) {
+    char line[128];
+    FILE* f = fopen("/proc/self/status", "r");
+    
+    *rss = *peak = *locked = -1;
+    if (!f) return;
+    while (fgets(line, sizeof(line), f)) {
+        sscanf(line, "VmRSS: %ld", rss);
+        sscanf(line, "VmHWM: %ld", peak);
+        sscanf(line, "VmLck: %ld", locked);
+    }
+    fclose(f);
+}
+
+// Print memory, faults (total and since the last report) and per-thread
+// stack use. Threads must still be running: their stacks are read.
+void rt_report(const char* when) {
+    struct rusage usage;
+    long rss, peak, locked;
+    
+    getrusage(RUSAGE_SELF, &usage);
+    read_memory_kb(&rss, &peak, &locked);
+    
+    printf("\n=== RT REPORT (%s) ===\n", when);
+    printf("Memory lock: %s\n", lock_error ? strerror(lock_error) : "all current and future pages");
+    printf("RSS: %ld kB (peak %ld kB), locked: %ld kB\n", rss, peak, locked);
+    printf("Arena: %zu of %zu kB used, %lu heap fallbacks\n",
+           __atomic_load_n(&arena_used, __ATOMIC_RELAXED) / 1024, arena_capacity / 1024,
+           __atomic_load_n(&heap_fallbacks, __ATOMIC_RELAXED));
+    printf("Page faults: %ld minor, %ld major (since last report: %ld minor, %ld major)\n",
+           usage.ru_minflt, usage.ru_majflt,
+           usage.ru_minflt - last_minor_faults, usage.ru_majflt - last_major_faults);
+    last_minor_faults = usage.ru_minflt;
+    last_major_faults = usage.ru_majflt;
+    
+    printf("%-26s %-10s %-10s\n", "Thread", "Stack(kB)", "Used(kB)");
+    pthread_mutex_lock(&threads_mutex);
+    for (int i = 0; i < num_threads; i++) {
+        printf("%-26s %-10zu %-10.1f\n", threads[i].name, threads[i].size / 1024,
+               stack_used(&threads[i]) / 1024.0);
+    }
+    pthread_mutex_unlock(&threads_mutex);
+    
+    printf("========================\n\n");
+    fflush(stdout);
+}
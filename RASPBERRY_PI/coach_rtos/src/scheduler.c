@@ -1,22 +1,222 @@
 #include "scheduler.h"
 #include "tasks.h"
+#include "display.h"
+#include "state.h"
+#include "metrics.h"
+#include "thermal.h"
+#include "locks.h"
+#include "executor.h"
+#include "events.h"
+#include "rt.h"
+#include "shm_export.h"
+#include "shutdown.h"
+#include "shards.h"
+#include "sensors.h"
+#include "power.h"
+#include "peer.h"
+
+// Dispatcher state: a single CPU token is handed to the highest-priority
+// ready task. Bit p of ready_bitmap is set while ready_head[p] is non-empty,
+// so picking the next task is one count-leading-zeros regardless of how
+// many tasks are registered.
+static Lock dispatch_mutex;
+static uint32_t ready_bitmap = 0;
+static Task* ready_head[NUM_PRIORITY_LEVELS];
+static Task* ready_tail[NUM_PRIORITY_LEVELS];
+static Task* cpu_owner = NULL;
+
+// EDF mode: one ready list ordered by absolute deadline instead;
+// edf_earliest_ns mirrors its head for the lock-free preemption check
+static bool use_edf = false;
+static Task* edf_head = NULL;
+static uint64_t edf_earliest_ns = UINT64_MAX;
+
+// Utilization of the admitted (budgeted) task set
+static double admitted_utilization = 0.0;
+
+// Execution model chosen at startup
+static bool use_executor = false;
+
+// Run task steps on the executor's worker pool instead of one thread per
+// task (call before scheduler_start())
+void scheduler_use_executor(bool enabled) {
+    use_executor = enabled;
+}
+
+// Dispatch by earliest absolute deadline instead of static priority
+// (call before adding tasks: admission control depends on it)
+void scheduler_use_edf(bool enabled) {
+    use_edf = enabled;
+}
+
+// Analysed timing of one task, in microseconds
+typedef struct {
+    const char* name;
+    int priority;
+    uint64_t budget;
+    uint64_t interval;   // Period or least event interval
+    uint64_t deadline;
+} TaskLoad;
+
+// Collect the budgeted tasks plus the candidate (system_mutex held)
+static int collect_loads(const Task* candidate, TaskLoad* loads) {
+    int n = 0;
+    
+    for (int i = 0; i <= g_system.num_tasks; i++) {
+        const Task* task = (i < g_system.num_tasks) ? &g_system.tasks[i] : candidate;
+        if (task->budget_us == 0) continue;
+        
+        loads[n].name = task->name;
+        loads[n].priority = task->priority;
+        loads[n].budget = task->budget_us;
+        loads[n].interval = task->period_us ? task->period_us : task->interval_us;
+        loads[n].deadline = task->deadline_us;
+        n++;
+    }
+    return n;
+}
+
+// Longest step that can hold the CPU token when a job of `load` is
+// released: steps run to completion between preemption points, so one
+// lower-priority (FP) or later-deadline (EDF) step may block it
+static uint64_t blocking_us(const TaskLoad* loads, int n, const TaskLoad* load, uint64_t horizon) {
+    uint64_t longest = 0;
+    
+    for (int j = 0; j < n; j++) {
+        bool lower = use_edf ? loads[j].deadline > horizon : loads[j].priority < load->priority;
+        if (lower && loads[j].budget > longest) longest = loads[j].budget;
+    }
+    return longest;
+}
+
+// Fixed priority: response-time analysis, every task's worst response
+// (blocking, own budget and higher- or equal-priority releases) against
+// its deadline
+static bool admit_fixed_priority(const TaskLoad* loads, int n, char* why, size_t why_size) {
+    for (int i = 0; i < n; i++) {
+        uint64_t base = blocking_us(loads, n, &loads[i], 0) + loads[i].budget;
+        uint64_t response = base;
+        
+        for (;;) {
+            uint64_t next = base;
+            for (int j = 0; j < n; j++) {
+                if (j == i || loads[j].priority < loads[i].priority) continue;
+                next += (response + loads[j].interval - 1) / loads[j].interval * loads[j].budget;
+            }
+            if (next > loads[i].deadline) {
+                snprintf(why, why_size, "%s can respond in %lu us, after its %lu us deadline",
+                         loads[i].name, next, loads[i].deadline);
+                return false;
+            }
+            if (next == response) break;
+            response = next;
+        }
+    }
+    return true;
+}
+
+// Processor demand of jobs released at 0 with deadlines up to t
+static uint64_t demand_us(const TaskLoad* loads, int n, uint64_t t) {
+    uint64_t demand = 0;
+    
+    for (int j = 0; j < n; j++) {
+        if (t >= loads[j].deadline) {
+            demand += ((t - loads[j].deadline) / loads[j].interval + 1) * loads[j].budget;
+        }
+    }
+    return demand;
+}
+
+// EDF: utilization at most 1, then demand plus blocking at every absolute
+// deadline up to the end of the longest busy period
+static bool admit_edf(const TaskLoad* loads, int n, double utilization, char* why, size_t why_size) {
+    if (utilization >= 1.0) {
+        snprintf(why, why_size, "utilization %.1f%% is not below 100%%", utilization * 100.0);
+        return false;
+    }
+    
+    double slack_sum = 0.0;
+    uint64_t horizon = 0;
+    for (int j = 0; j < n; j++) {
+        if (loads[j].deadline > horizon) horizon = loads[j].deadline;
+        if (loads[j].interval > loads[j].deadline) {
+            slack_sum += (double)(loads[j].interval - loads[j].deadline) * loads[j].budget / loads[j].interval;
+        }
+    }
+    if (slack_sum / (1.0 - utilization) > horizon) {
+        horizon = (uint64_t)(slack_sum / (1.0 - utilization));
+    }
+    
+    long points = 0;
+    for (int i = 0; i < n; i++) {
+        for (uint64_t t = loads[i].deadline; t <= horizon; t += loads[i].interval) {
+            if (++points > SCHED_EDF_MAX_POINTS) {
+                snprintf(why, why_size, "more than %d deadlines to check", SCHED_EDF_MAX_POINTS);
+                return false;
+            }
+            
+            uint64_t demand = demand_us(loads, n, t) + blocking_us(loads, n, &loads[i], t);
+            if (demand > t) {
+                snprintf(why, why_size, "demand %lu us exceeds the %lu us up to %s's deadline",
+                         demand, t, loads[i].name);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Admission control for the task set with `candidate` added (system_mutex
+// held). Returns false, with the reason in `why`, if any deadline could
+// be missed under the dispatch mode in use.
+static bool admission_check(const Task* candidate, char* why, size_t why_size) {
+    TaskLoad loads[MAX_TASKS];
+    
+    if (candidate->budget_us == 0) return true;
+    if (candidate->period_us == 0 && candidate->interval_us == 0) {
+        snprintf(why, why_size, "a budget needs a period or an event interval");
+        return false;
+    }
+    
+    int n = collect_loads(candidate, loads);
+    double utilization = 0.0;
+    for (int j = 0; j < n; j++) {
+        utilization += (double)loads[j].budget / loads[j].interval;
+    }
+    
+    bool admitted = use_edf ? admit_edf(loads, n, utilization, why, why_size)
+                            : admit_fixed_priority(loads, n, why, why_size);
+    if (admitted) {
+        admitted_utilization = utilization;
+    }
+    return admitted;
+}
 
 // Initialize scheduler
 void scheduler_init() {
-    pthread_mutex_lock(&g_system.system_mutex);
+    lock_init(&dispatch_mutex, "dispatch");
+    
+    lock_acquire(&g_system.system_mutex);
     g_system.num_tasks = 0;
-    pthread_mutex_unlock(&g_system.system_mutex);
+    lock_release(&g_system.system_mutex);
     
     log_message("Scheduler initialized");
 }
 
-// Add a task to the scheduler
-int scheduler_add_task(const char* name, int priority, void* (*task_func)(void*)) {
-    pthread_mutex_lock(&g_system.system_mutex);
+// Add a task with its timing contract. Returns the task id, or -1 if the
+// table is full, the priority invalid or admission control rejects it.
+int scheduler_add_task(const char* name, int priority, TaskStep step, const TaskTiming* timing) {
+    lock_acquire(&g_system.system_mutex);
     
     if (g_system.num_tasks >= MAX_TASKS) {
         log_message("Error: Maximum tasks reached");
-        pthread_mutex_unlock(&g_system.system_mutex);
+        lock_release(&g_system.system_mutex);
+        return -1;
+    }
+    
+    if (priority < 0 || priority >= NUM_PRIORITY_LEVELS) {
+        log_message("Error: Invalid priority %d for task %s", priority, name);
+        lock_release(&g_system.system_mutex);
         return -1;
     }
     
@@ -27,53 +227,467 @@ int scheduler_add_task(const char* name, int priority, void* (*task_func)(void*)
     strncpy(task->name, name, sizeof(task->name) - 1);
     task->priority = priority;
     task->state = TASK_READY;
-    task->task_function = task_func;
+    task->step = step;
     task->is_active = true;
     task->execution_count = 0;
     clock_gettime(CLOCK_MONOTONIC, &task->last_execution);
     
+    task->event_mask = 0;
+    char lock_name[LOCK_NAME_LEN];
+    snprintf(lock_name, sizeof(lock_name), "wake:%s", task->name);
+    lock_init(&task->wake_mutex, lock_name);
+    pthread_cond_init(&task->wake_cond, NULL);
+    task->wake_pending = false;
+    task->wakeup_count = 0;
+    task->wakeup_latency_total_ns = 0;
+    task->wakeup_latency_max_ns = 0;
+    
+    task->ready_next = NULL;
+    pthread_cond_init(&task->dispatch_cond, NULL);
+    task->preempt_count = 0;
+    task->run_started_ns = 0;
+    task->run_accum_ns = 0;
+    
+    task->period_us = timing->period_us;
+    task->offset_us = timing->offset_us;
+    task->release_count = 0;
+    task->missed_releases = 0;
+    task->jitter_total_ns = 0;
+    task->jitter_max_ns = 0;
+    
+    task->interval_us = timing->interval_us;
+    task->deadline_us = timing->deadline_us ? timing->deadline_us :
+                        (timing->period_us ? timing->period_us : timing->interval_us);
+    task->budget_us = timing->budget_us;
+    task->job_release_ns = 0;
+    task->job_deadline_ns = UINT64_MAX;
+    task->job_cpu_start_ns = 0;
+    task->job_count = 0;
+    task->job_cpu_total_ns = 0;
+    task->job_cpu_max_ns = 0;
+    task->budget_overruns = 0;
+    task->deadline_misses = 0;
+    
+    task->exec_state = 0;
+    task->exec_release_ns = 0;
+    task->exec_rerun_ns = 0;
+    
+    char why[128];
+    if (!admission_check(task, why, sizeof(why))) {
+        log_message("Error: Task %s rejected by admission control: %s", task->name, why);
+        pthread_cond_destroy(&task->wake_cond);
+        lock_destroy(&task->wake_mutex);
+        pthread_cond_destroy(&task->dispatch_cond);
+        lock_release(&g_system.system_mutex);
+        return -1;
+    }
+    
     g_system.num_tasks++;
     
-    log_message("Task added: %s (Priority: %d)", name, priority);
+    log_message("Task added: %s (Priority: %d, deadline %lu us, budget %lu us)",
+                name, priority, task->deadline_us, task->budget_us);
     
-    pthread_mutex_unlock(&g_system.system_mutex);
+    lock_release(&g_system.system_mutex);
     
     return task_id;
 }
 
-// Get highest priority runnable task
-Task* scheduler_get_highest_priority_task() {
-    Task* highest = NULL;
-    int max_priority = -1;
+// Subscribe a task to wakeup events
+void scheduler_subscribe(int task_id, uint32_t events) {
+    lock_acquire(&g_system.system_mutex);
+    
+    if (task_id >= 0 && task_id < g_system.num_tasks) {
+        g_system.tasks[task_id].event_mask |= events;
+    }
+    
+    lock_release(&g_system.system_mutex);
+}
+
+// Wake a single task (keeps the earliest pending signal time)
+static void scheduler_wake_task(Task* task) {
+    lock_acquire(&task->wake_mutex);
+    
+    if (!task->wake_pending) {
+        task->wake_pending = true;
+        clock_gettime(CLOCK_MONOTONIC, &task->wake_signalled);
+    }
     
-    pthread_mutex_lock(&g_system.system_mutex);
+    pthread_cond_signal(&task->wake_cond);
+    lock_release(&task->wake_mutex);
+}
+
+// Signal only the tasks subscribed to the given events
+void scheduler_notify(uint32_t events) {
+    uint64_t now_ns = use_executor ? monotonic_now_ns() : 0;
     
+    // The task table is fixed once the scheduler is started, so no
+    // system_mutex is needed to walk it here
     for (int i = 0; i < g_system.num_tasks; i++) {
         Task* task = &g_system.tasks[i];
         
-        if (task->is_active && task->state == TASK_READY) {
-            if (task->priority > max_priority) {
-                max_priority = task->priority;
-                highest = task;
+        if (task->event_mask & events) {
+            if (use_executor) {
+                executor_submit(task, now_ns);
+            } else {
+                scheduler_wake_task(task);
             }
         }
     }
+}
+
+// Account one event wakeup: notify -> the task starting to run
+void scheduler_record_wakeup(Task* task, uint64_t latency_ns) {
+    task->wakeup_count++;
+    task->wakeup_latency_total_ns += latency_ns;
+    metrics_record(METRIC_TASK_WAKEUP + task->id, latency_ns);
+    if (latency_ns > task->wakeup_latency_max_ns) {
+        task->wakeup_latency_max_ns = latency_ns;
+    }
+}
+
+// Block the calling task until one of its events is signalled
+void scheduler_wait_event(Task* self) {
+    lock_acquire(&self->wake_mutex);
+    
+    self->state = TASK_BLOCKED;
+    while (!self->wake_pending && g_system.system_running && self->is_active) {
+        lock_cond_wait(&self->wake_mutex, &self->wake_cond);
+    }
+    
+    if (self->wake_pending) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        
+        uint64_t signalled_ns = timespec_to_ns(&self->wake_signalled);
+        scheduler_record_wakeup(self, timespec_to_ns(&now) - signalled_ns);
+        scheduler_job_release(self, signalled_ns);
+        self->wake_pending = false;
+    }
+    
+    self->state = TASK_READY;
+    lock_release(&self->wake_mutex);
+}
+
+static void timespec_from_ns(struct timespec* ts, uint64_t ns) {
+    ts->tv_sec = ns / 1000000000ULL;
+    ts->tv_nsec = ns % 1000000000ULL;
+}
+
+// Account one periodic release: release time -> the task starting to run
+void scheduler_record_release(Task* task, uint64_t jitter_ns) {
+    task->release_count++;
+    task->jitter_total_ns += jitter_ns;
+    if (jitter_ns > task->jitter_max_ns) {
+        task->jitter_max_ns = jitter_ns;
+    }
+}
+
+// Move a periodic task's next release one period along its original grid
+// from release_ns. Releases already in the past at now_ns are skipped and
+// counted as missed, so an overrunning body never makes the schedule drift.
+void scheduler_advance_release(Task* task, uint64_t release_ns, uint64_t now_ns) {
+    uint64_t period_ns = task->period_us * 1000ULL;
+    uint64_t next_ns = release_ns + period_ns;
+    
+    if (now_ns >= next_ns) {
+        uint64_t missed = (now_ns - release_ns) / period_ns;
+        task->missed_releases += missed;
+        next_ns = release_ns + (missed + 1) * period_ns;
+    }
+    timespec_from_ns(&task->next_release, next_ns);
+}
+
+// Sleep until the task's next absolute release time. Returns false once
+// the task should stop (a shutdown request cuts the sleep short).
+bool scheduler_wait_next_period(Task* self) {
+    if (self->period_us == 0) return g_system.system_running && self->is_active;
+    
+    self->state = TASK_BLOCKED;
+    if (!shutdown_sleep_until(&self->next_release)) return false;
+    
+    uint64_t release_ns = timespec_to_ns(&self->next_release);
+    uint64_t now_ns = monotonic_now_ns();
+    
+    scheduler_record_release(self, now_ns > release_ns ? now_ns - release_ns : 0);
+    scheduler_job_release(self, release_ns);
+    scheduler_advance_release(self, release_ns, now_ns);
+    
+    self->state = TASK_READY;
+    return g_system.system_running && self->is_active;
+}
+
+static uint64_t thread_cpu_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return timespec_to_ns(&ts);
+}
+
+// A job (one step) of the task is released: its absolute deadline, which
+// is also its EDF dispatch key, counts from release_ns
+void scheduler_job_release(Task* task, uint64_t release_ns) {
+    task->job_release_ns = release_ns;
+    task->job_deadline_ns = task->deadline_us ? release_ns + task->deadline_us * 1000ULL : UINT64_MAX;
+}
+
+// The job starts running on the calling thread
+void scheduler_job_start(Task* task) {
+    task->job_cpu_start_ns = thread_cpu_now_ns();
+}
+
+// The job finished on the same thread: its CPU time (time preempted or
+// blocked does not count) against the budget, completion against the
+// deadline. The first overrun and miss per task are logged; STATUS
+// shows the counts.
+void scheduler_job_finish(Task* task) {
+    uint64_t cpu_ns = thread_cpu_now_ns() - task->job_cpu_start_ns;
+    uint64_t now_ns = monotonic_now_ns();
+    
+    task->job_count++;
+    task->job_cpu_total_ns += cpu_ns;
+    if (cpu_ns > task->job_cpu_max_ns) {
+        task->job_cpu_max_ns = cpu_ns;
+    }
+    
+    if (task->budget_us && cpu_ns > task->budget_us * 1000ULL) {
+        if (task->budget_overruns++ == 0) {
+            log_message("Warning: %s overran its budget: %.1f us of CPU, budget %lu us",
+                        task->name, cpu_ns / 1000.0, task->budget_us);
+        }
+    }
+    if (now_ns > task->job_deadline_ns) {
+        if (task->deadline_misses++ == 0) {
+            log_message("Warning: %s missed its deadline by %.1f us",
+                        task->name, (now_ns - task->job_deadline_ns) / 1000.0);
+        }
+    }
+}
+
+// Highest ready priority, or -1 if nothing is ready (dispatch_mutex held)
+static int ready_highest_priority() {
+    if (ready_bitmap == 0) return -1;
+    return 31 - __builtin_clz(ready_bitmap);
+}
+
+// EDF order: earlier absolute deadline, then higher priority
+static inline bool runs_before(const Task* a, const Task* b) {
+    return a->job_deadline_ns < b->job_deadline_ns ||
+           (a->job_deadline_ns == b->job_deadline_ns && a->priority > b->priority);
+}
+
+// Insert a task into the EDF list behind everything that runs before or
+// with it (dispatch_mutex held)
+static void edf_enqueue(Task* task) {
+    Task** link = &edf_head;
+    
+    while (*link && !runs_before(task, *link)) {
+        link = &(*link)->ready_next;
+    }
+    task->ready_next = *link;
+    *link = task;
+    __atomic_store_n(&edf_earliest_ns, edf_head->job_deadline_ns, __ATOMIC_RELAXED);
+}
+
+// Append a task to its priority's ready list (dispatch_mutex held)
+static void ready_enqueue(Task* task) {
+    int p = task->priority;
+    
+    if (use_edf) {
+        edf_enqueue(task);
+        task->state = TASK_READY;
+        return;
+    }
+    
+    task->ready_next = NULL;
+    if (ready_tail[p]) {
+        ready_tail[p]->ready_next = task;
+    } else {
+        ready_head[p] = task;
+    }
+    ready_tail[p] = task;
+    ready_bitmap |= 1u << p;
+    task->state = TASK_READY;
+}
+
+// Take the next task to run off the ready lists, or NULL (dispatch_mutex held)
+static Task* ready_dequeue() {
+    Task* next;
+    
+    if (use_edf) {
+        next = edf_head;
+        if (!next) return NULL;
+        edf_head = next->ready_next;
+        __atomic_store_n(&edf_earliest_ns, edf_head ? edf_head->job_deadline_ns : UINT64_MAX,
+                         __ATOMIC_RELAXED);
+    } else {
+        int p = ready_highest_priority();
+        if (p < 0) return NULL;
+        
+        next = ready_head[p];
+        ready_head[p] = next->ready_next;
+        if (!ready_head[p]) {
+            ready_tail[p] = NULL;
+            ready_bitmap &= ~(1u << p);
+        }
+    }
+    
+    next->ready_next = NULL;
+    return next;
+}
+
+// Whether a ready task should take the CPU from `self` (dispatch_mutex held)
+static bool ready_preempts(const Task* self) {
+    if (use_edf) return edf_head && runs_before(edf_head, self);
+    return ready_highest_priority() > self->priority;
+}
+
+// Hand the CPU token to the highest-priority (EDF: earliest-deadline)
+// ready task (dispatch_mutex held)
+static void dispatch_next() {
+    if (cpu_owner) return;
+    
+    Task* next = ready_dequeue();
+    if (!next) return;
+    
+    cpu_owner = next;
+    next->state = TASK_RUNNING;
+    pthread_cond_signal(&next->dispatch_cond);
+}
+
+// Block until the dispatcher hands the CPU token to this task.
+// Returns false if the task was stopped while waiting.
+bool scheduler_dispatch_acquire(Task* self) {
+    lock_acquire(&dispatch_mutex);
+    
+    ready_enqueue(self);
+    dispatch_next();
+    
+    while (cpu_owner != self && g_system.system_running && self->is_active) {
+        lock_cond_wait(&dispatch_mutex, &self->dispatch_cond);
+    }
+    
+    bool granted = (cpu_owner == self);
+    lock_release(&dispatch_mutex);
+    
+    self->run_started_ns = monotonic_now_ns();
+    self->run_accum_ns = 0;
+    return granted;
+}
+
+// Give the CPU token back and dispatch the next ready task; the time
+// spent holding the token is recorded as the task's execution time
+void scheduler_dispatch_release(Task* self) {
+    metrics_record(METRIC_TASK_EXEC + self->id,
+                   self->run_accum_ns + (monotonic_now_ns() - self->run_started_ns));
+    
+    lock_acquire(&dispatch_mutex);
+    
+    if (cpu_owner == self) {
+        cpu_owner = NULL;
+        self->state = TASK_READY;
+        dispatch_next();
+    }
+    
+    lock_release(&dispatch_mutex);
+}
+
+// Preemption point: yield the token if a higher-priority (EDF: earlier
+// deadline) task is ready
+void scheduler_preempt_point(Task* self) {
+    if (use_edf) {
+        if (__atomic_load_n(&edf_earliest_ns, __ATOMIC_RELAXED) > self->job_deadline_ns) return;
+    } else {
+        uint32_t bitmap = __atomic_load_n(&ready_bitmap, __ATOMIC_RELAXED);
+        if ((bitmap >> (self->priority + 1)) == 0) return;
+    }
+    
+    lock_acquire(&dispatch_mutex);
+    
+    if (cpu_owner == self && ready_preempts(self)) {
+        self->preempt_count++;
+        self->run_accum_ns += monotonic_now_ns() - self->run_started_ns;
+        cpu_owner = NULL;
+        dispatch_next();
+        
+        // Rejoin the ready list; the token comes back once the
+        // higher-priority work has released it
+        ready_enqueue(self);
+        while (cpu_owner != self && g_system.system_running && self->is_active) {
+            lock_cond_wait(&dispatch_mutex, &self->dispatch_cond);
+        }
+        self->state = TASK_RUNNING;
+        self->run_started_ns = monotonic_now_ns();
+    }
+    
+    lock_release(&dispatch_mutex);
+}
+
+// Get the task the dispatcher would run next (O(1) bitmap lookup, or
+// the EDF list head)
+Task* scheduler_get_highest_priority_task() {
+    lock_acquire(&dispatch_mutex);
+    
+    int p = ready_highest_priority();
+    Task* highest = use_edf ? edf_head : (p >= 0) ? ready_head[p] : NULL;
     
-    pthread_mutex_unlock(&g_system.system_mutex);
+    lock_release(&dispatch_mutex);
     
     return highest;
 }
 
+// Thread-per-task model: a periodic task runs one step per release; an
+// event task one step per wakeup, and again straight away while the step
+// reports more queued events. Steps run holding the CPU token.
+static void* task_thread_main(void* arg) {
+    Task* task = (Task*)arg;
+    bool again = false;
+    
+    lock_thread_set(task->name, task->priority);
+    rt_thread_start(task->name);
+    log_message("%s Task started", task->name);
+    
+    for (;;) {
+        if (task->period_us > 0) {
+            if (!scheduler_wait_next_period(task)) break;
+        } else if (!again) {
+            scheduler_wait_event(task);
+        } else {
+            scheduler_job_release(task, monotonic_now_ns());
+        }
+        if (!g_system.system_running || !task->is_active) break;
+        
+        if (!scheduler_dispatch_acquire(task)) break;
+        scheduler_job_start(task);
+        again = task->step(task);
+        scheduler_job_finish(task);
+        scheduler_dispatch_release(task);
+    }
+    
+    log_message("%s Task stopped", task->name);
+    rt_thread_stop();
+    return NULL;
+}
+
 // Start all tasks
 void scheduler_start() {
     log_message("Starting all tasks...");
     
-    pthread_mutex_lock(&g_system.system_mutex);
+    lock_acquire(&g_system.system_mutex);
+    
+    // All periodic tasks share one release epoch so offsets phase them
+    uint64_t epoch_ns = monotonic_now_ns();
     
     for (int i = 0; i < g_system.num_tasks; i++) {
         Task* task = &g_system.tasks[i];
         
-        if (pthread_create(&task->thread, NULL, task->task_function, task) != 0) {
+        timespec_from_ns(&task->next_release, epoch_ns + task->offset_us * 1000ULL);
+        if (use_executor) continue;
+        
+        pthread_attr_t attr;
+        rt_thread_attr_init(&attr, RT_TASK_STACK_SIZE);
+        int result = pthread_create(&task->thread, &attr, task_thread_main, task);
+        pthread_attr_destroy(&attr);
+        
+        if (result != 0) {
             log_message("Error: Failed to create thread for task %s", task->name);
             task->is_active = false;
         } else {
@@ -81,22 +695,45 @@ void scheduler_start() {
         }
     }
     
-    pthread_mutex_unlock(&g_system.system_mutex);
+    lock_release(&g_system.system_mutex);
+    
+    if (use_executor && executor_start() != 0) {
+        log_message("Error: Failed to start the executor");
+    }
 }
 
 // Stop all tasks
 void scheduler_stop() {
     log_message("Stopping all tasks...");
     
-    pthread_mutex_lock(&g_system.system_mutex);
+    lock_acquire(&g_system.system_mutex);
     
     for (int i = 0; i < g_system.num_tasks; i++) {
         Task* task = &g_system.tasks[i];
         task->is_active = false;
     }
     
-    pthread_mutex_unlock(&g_system.system_mutex);
-    pthread_cond_broadcast(&g_system.task_ready_cond);
+    lock_release(&g_system.system_mutex);
+    
+    // Executor workers finish their current steps and exit
+    if (use_executor) {
+        executor_stop();
+    }
+    
+    // Release every task blocked in scheduler_wait_event() or waiting
+    // for the CPU token
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        Task* task = &g_system.tasks[i];
+        lock_acquire(&task->wake_mutex);
+        pthread_cond_signal(&task->wake_cond);
+        lock_release(&task->wake_mutex);
+    }
+    
+    lock_acquire(&dispatch_mutex);
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        pthread_cond_signal(&g_system.tasks[i].dispatch_cond);
+    }
+    lock_release(&dispatch_mutex);
     
     // Wait for all tasks to complete
     for (int i = 0; i < g_system.num_tasks; i++) {
@@ -105,39 +742,52 @@ void scheduler_stop() {
             pthread_join(task->thread, NULL);
             log_message("Task stopped: %s", task->name);
         }
+        pthread_cond_destroy(&task->wake_cond);
+        lock_destroy(&task->wake_mutex);
+        pthread_cond_destroy(&task->dispatch_cond);
     }
 }
 
-// Simulate preemption
+// Report a preemption request; the running task yields at its next
+// scheduler_preempt_point() once the woken task is on the ready list
 void scheduler_preempt(int new_priority) {
-    log_message("Preemption triggered with priority %d", new_priority);
-    pthread_cond_broadcast(&g_system.task_ready_cond);
+    lock_acquire(&dispatch_mutex);
+    const char* owner = (cpu_owner && cpu_owner->priority < new_priority) ? cpu_owner->name : NULL;
+    lock_release(&dispatch_mutex);
+    
+    if (owner) {
+        log_message("Preemption triggered with priority %d (preempting %s)", new_priority, owner);
+    } else {
+        log_message("Preemption triggered with priority %d", new_priority);
+    }
 }
 
-// Mark task execution complete
+// Mark task execution complete. Only the task's own thread writes its
+// counters, so no lock is taken; status readers may see them mid-update.
 void scheduler_task_complete(int task_id) {
-    pthread_mutex_lock(&g_system.system_mutex);
-    
     if (task_id >= 0 && task_id < g_system.num_tasks) {
         Task* task = &g_system.tasks[task_id];
-        task->execution_count++;
+        __atomic_store_n(&task->execution_count, task->execution_count + 1, __ATOMIC_RELAXED);
         clock_gettime(CLOCK_MONOTONIC, &task->last_execution);
     }
-    
-    pthread_mutex_unlock(&g_system.system_mutex);
 }
 
 // Print scheduler status
 void scheduler_print_status() {
-    printf("\n=== SCHEDULER STATUS ===\n");
-    
-    pthread_mutex_lock(&g_system.system_mutex);
+    StateSnapshot snap;
+    if (state_snapshot_alloc(&snap) != 0) return;
+    state_snapshot(&snap);
     
+    printf("\n=== SCHEDULER STATUS ===\n");
     printf("Total Tasks: %d\n", g_system.num_tasks);
-    printf("System Running: %s\n", g_system.system_running ? "YES" : "NO");
+    printf("System Running: %s\n", snap.system_running ? "YES" : "NO");
+    printf("Execution: %s\n", use_executor ? "executor worker pool" : "thread per task");
+    printf("Dispatch: %s, admitted utilization %.1f%%\n",
+           use_edf ? "earliest deadline first" : "fixed priority", admitted_utilization * 100.0);
     printf("\nTask Details:\n");
-    printf("%-3s %-30s %-8s %-10s %-12s\n", "ID", "Name", "Priority", "State", "Exec Count");
-    printf("-------------------------------------------------------------------\n");
+    printf("%-3s %-30s %-8s %-10s %-12s %-8s %-10s %-10s\n", 
+           "ID", "Name", "Priority", "State", "Exec Count", "Preempt", "Wake(us)", "Max(us)");
+    printf("----------------------------------------------------------------------------------------------\n");
     
     for (int i = 0; i < g_system.num_tasks; i++) {
         Task* task = &g_system.tasks[i];
@@ -151,16 +801,57 @@ void scheduler_print_status() {
             default: state_str = "UNKNOWN"; break;
         }
         
-        printf("%-3d %-30s %-8d %-10s %-12lu\n", 
-               task->id, task->name, task->priority, state_str, task->execution_count);
+        printf("%-3d %-30s %-8d %-10s %-12lu %-8lu ", 
+               task->id, task->name, task->priority, state_str, task->execution_count,
+               task->preempt_count);
+        
+        // Event-to-handler wakeup latency (event tasks only)
+        if (task->wakeup_count > 0) {
+            printf("%-10.1f %-10.1f\n",
+                   task->wakeup_latency_total_ns / (double)task->wakeup_count / 1000.0,
+                   task->wakeup_latency_max_ns / 1000.0);
+        } else {
+            printf("%-10s %-10s\n", "-", "-");
+        }
+    }
+    
+    printf("\nPeriodic Releases:\n");
+    printf("%-30s %-12s %-10s %-10s %-8s %-10s %-10s\n",
+           "Name", "Period(us)", "Offset", "Releases", "Missed", "Jitter(us)", "Max(us)");
+    printf("----------------------------------------------------------------------------------------------\n");
+    
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        Task* task = &g_system.tasks[i];
+        if (task->period_us == 0) continue;
+        
+        double jitter_avg_us = task->release_count ?
+            task->jitter_total_ns / (double)task->release_count / 1000.0 : 0.0;
+        
+        printf("%-30s %-12lu %-10lu %-10lu %-8lu %-10.1f %-10.1f\n",
+               task->name, task->period_us, task->offset_us, task->release_count,
+               task->missed_releases, jitter_avg_us, task->jitter_max_ns / 1000.0);
+    }
+    
+    printf("\nTiming (CPU time per step):\n");
+    printf("%-30s %-12s %-10s %-10s %-10s %-10s %-9s %-8s\n",
+           "Name", "Deadline(us)", "Budget", "Steps", "CPU(us)", "Max(us)", "Overruns", "Misses");
+    printf("----------------------------------------------------------------------------------------------\n");
+    
+    for (int i = 0; i < g_system.num_tasks; i++) {
+        Task* task = &g_system.tasks[i];
+        
+        printf("%-30s %-12lu %-10lu %-10lu %-10.1f %-10.1f %-9lu %-8lu\n",
+               task->name, task->deadline_us, task->budget_us, task->job_count,
+               task->job_count ? task->job_cpu_total_ns / (double)task->job_count / 1000.0 : 0.0,
+               task->job_cpu_max_ns / 1000.0, task->budget_overruns, task->deadline_misses);
     }
     
     printf("\nCabin Status:\n");
-    printf("%-6s %-10s %-12s %-10s\n", "Cabin", "Light", "Temp (°C)", "State");
-    printf("-------------------------------------------------------------------\n");
+    printf("%-6s %-10s %-8s %-12s %-12s %-10s\n", "Cabin", "Light", "HVAC", "Temp (°C)", "Setpoint", "State");
+    printf("----------------------------------------------------------------------------\n");
     
-    for (int i = 0; i < NUM_CABINS; i++) {
-        Cabin* cabin = &g_system.cabins[i];
+    for (int i = 0; i < snap.num_cabins; i++) {
+        const CabinView* cabin = &snap.cabins[i];
         
         const char* state_str;
         switch (cabin->state) {
@@ -172,27 +863,87 @@ void scheduler_print_status() {
             default: state_str = "Unknown"; break;
         }
         
-        printf("%-6d %-10s %-12d %-10s\n", 
-               cabin->id, cabin->light_on ? "ON" : "OFF", cabin->temperature, state_str);
+        printf("%-6d %-10s %-8s %-12d %-12d %-10s\n", i,
+               cabin->light_on ? "ON" : cabin->light_shed ? "OFF (shed)" : "OFF",
+               cabin->hvac_on ? "ON" : "SHED", cabin->temperature, cabin->setpoint, state_str);
     }
     
-    pthread_mutex_unlock(&g_system.system_mutex);
+    state_snapshot_free(&snap);
     
+    events_print_stats();
+    if (use_executor) {
+        executor_print_stats();
+    }
+    shards_print_stats();
+    power_print_stats();
+    sensors_print_stats();
+    peer_print_stats();
+    display_print_stats();
     printf("========================\n\n");
 }
 
-// Register all system tasks
-void register_all_tasks() {
+// Register all system tasks. Returns 0, or -1 if an event task was not
+// admitted.
+int register_all_tasks() {
     log_message("Registering system tasks...");
     
-    scheduler_add_task("Fire Emergency", PRIORITY_FIRE_EMERGENCY, fire_emergency_task);
-    scheduler_add_task("Passenger Emergency", PRIORITY_PASSENGER_EMERGENCY, passenger_emergency_task);
-    scheduler_add_task("Chain Pull", PRIORITY_CHAIN_PULL, chain_pull_task);
-    scheduler_add_task("Power Management", PRIORITY_POWER_MANAGEMENT, power_management_task);
-    scheduler_add_task("Temperature Regulation", PRIORITY_TEMP_REGULATION, temperature_regulation_task);
-    scheduler_add_task("Lighting Control", PRIORITY_LIGHTING, lighting_control_task);
-    scheduler_add_task("Display Update", PRIORITY_DISPLAY, display_task);
-    scheduler_add_task("System Logging", PRIORITY_LOGGING, logging_task);
+    // Timing contracts (see TaskTiming). Event tasks declare the least
+    // interval between wakeups admission control may assume; periodic
+    // offsets stagger the tasks so they are not all released on the same
+    // tick. Budgets are a few times the worst steps measured with 8192
+    // cabins.
+    static const TaskTiming fire_timing = { .interval_us = 10000, .deadline_us = 2000, .budget_us = 200 };
+    static const TaskTiming emergency_timing = { .interval_us = 10000, .deadline_us = 2000, .budget_us = 200 };
+    static const TaskTiming chain_timing = { .interval_us = 50000, .deadline_us = 5000, .budget_us = 200 };
+    static const TaskTiming power_timing = { .interval_us = 100000, .deadline_us = 10000, .budget_us = 1000 };
+    static const TaskTiming temp_timing = { .period_us = THERMAL_PERIOD_US, .offset_us = 100000, .budget_us = 500 };
+    static const TaskTiming light_timing = { .period_us = 3000000, .offset_us = 150000, .budget_us = 100 };
+    static const TaskTiming display_timing = { .period_us = DISPLAY_PERIOD_US, .offset_us = 200000, .budget_us = 1000 };
+    static const TaskTiming log_timing = { .period_us = 50000, .offset_us = 25000, .budget_us = 1000 };
+    static const TaskTiming export_timing = { .period_us = SHM_EXPORT_PERIOD_US, .offset_us = 10000, .budget_us = 200 };
+    static const TaskTiming peer_timing = { .period_us = PEER_PERIOD_US, .offset_us = 15000, .budget_us = 1000 };
+    static const TaskTiming sensor_timing = { .period_us = SENSOR_EVAL_PERIOD_US, .offset_us = 5000, .budget_us = 1500 };
+    
+    int fire_id = scheduler_add_task("Fire Emergency", PRIORITY_FIRE_EMERGENCY, fire_emergency_step, &fire_timing);
+    int emergency_id = scheduler_add_task("Passenger Emergency", PRIORITY_PASSENGER_EMERGENCY,
+                                          passenger_emergency_step, &emergency_timing);
+    int chain_id = scheduler_add_task("Chain Pull", PRIORITY_CHAIN_PULL, chain_pull_step, &chain_timing);
+    int power_id = scheduler_add_task("Power Management", PRIORITY_POWER_MANAGEMENT, power_management_step,
+                                      &power_timing);
+    scheduler_add_task("Temperature Regulation", PRIORITY_TEMP_REGULATION, temperature_regulation_step,
+                       &temp_timing);
+    scheduler_add_task("Lighting Control", PRIORITY_LIGHTING, lighting_control_step, &light_timing);
+    scheduler_add_task("Display Update", PRIORITY_DISPLAY, display_step, &display_timing);
+    scheduler_add_task("System Logging", PRIORITY_LOGGING, logging_step, &log_timing);
+    
+    if (shm_export_enabled()) {
+        scheduler_add_task("State Export", PRIORITY_STATE_EXPORT, state_export_step, &export_timing);
+    }
+    if (sensors_enabled()) {
+        scheduler_add_task("Sensor Alarms", PRIORITY_SENSOR_ALARMS, sensor_alarm_step, &sensor_timing);
+    }
+    if (peer_publish_enabled()) {
+        scheduler_add_task("Peer Publish", PRIORITY_STATE_EXPORT, peer_publish_step, &peer_timing);
+    }
+    
+    // Event subscriptions: one task per event queue. A rejected event
+    // task would leave its alarms unhandled, so that stops startup.
+    const struct { int id; uint32_t event; const char* name; } subscriptions[] = {
+        { fire_id, EVENT_FIRE, "Fire Emergency" },
+        { emergency_id, EVENT_EMERGENCY, "Passenger Emergency" },
+        { chain_id, EVENT_CHAIN_PULL, "Chain Pull" },
+        { power_id, EVENT_POWER_LOW, "Power Management" },
+    };
+    
+    for (size_t i = 0; i < sizeof(subscriptions) / sizeof(subscriptions[0]); i++) {
+        if (subscriptions[i].id < 0) {
+            fprintf(stderr, "Cannot register the %s task; its events would never be handled\n",
+                    subscriptions[i].name);
+            return -1;
+        }
+        scheduler_subscribe(subscriptions[i].id, subscriptions[i].event);
+    }
     
     log_message("All tasks registered successfully");
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include "sensors.h"
+#include "scheduler.h"
+#include "tasks.h"
+#include "locks.h"
+#include "rt.h"
+#include "shutdown.h"
+
+// Ring per cabin and sensor, stored twice over (slot i and i + WINDOW) so
+// the last SENSOR_WINDOW samples are always contiguous, oldest first, at
+// (written % WINDOW)
+#define SENSOR_RING (2 * SENSOR_WINDOW)
+
+// Per cabin and sensor. One producer per cabin (the source feeding it)
+// writes samples and counts; the evaluation task reads them and owns the
+// rest.
+static int16_t* samples[NUM_SENSOR_KINDS];
+static uint32_t* written[NUM_SENSOR_KINDS];
+static uint32_t* evaluated[NUM_SENSOR_KINDS];     // Count at the last evaluation
+static float* slow_temp;                          // Slow average of the window mean
+static uint64_t* slow_temp_ns;                    // When it was updated (0: never)
+static uint64_t* fire_latched;                    // Bit per cabin
+static uint64_t* hot_latched;
+static int sensor_cabins = 0;
+
+// Evaluation counters (written by the evaluation task only)
+static uint64_t passes = 0;
+static uint64_t windows = 0;
+static uint64_t torn_windows = 0;
+static uint64_t fire_alarms = 0;
+static uint64_t hot_alarms = 0;
+static uint64_t pass_total_ns = 0;
+static uint64_t pass_max_ns = 0;
+
+// Synthetic source
+typedef struct {
+    pthread_t thread;
+    bool started;
+    double rate;             // Samples per second, all cabins and sensors
+    int fire_cabin;          // -1: no fire
+    uint64_t start_ns;
+    uint64_t produced;       // Written by the source thread only
+    uint64_t stalls;
+    uint64_t cpu_ns;
+} SensorSource;
+
+static SensorSource source = { .fire_cabin = -1 };
+
+// Allocate the rings for num_cabins cabins. Returns 0 or -1.
+int sensors_init(int num_cabins) {
+    int num_words = (num_cabins + CABINS_PER_WORD - 1) / CABINS_PER_WORD;
+    
+    for (int k = 0; k < NUM_SENSOR_KINDS; k++) {
+        samples[k] = rt_alloc((size_t)num_cabins * SENSOR_RING * sizeof(int16_t));
+        written[k] = rt_alloc(num_cabins * sizeof(uint32_t));
+        evaluated[k] = rt_alloc(num_cabins * sizeof(uint32_t));
+        if (!samples[k] || !written[k] || !evaluated[k]) return -1;
+    }
+    slow_temp = rt_alloc(num_cabins * sizeof(float));
+    slow_temp_ns = rt_alloc(num_cabins * sizeof(uint64_t));
+    fire_latched = rt_alloc(num_words * sizeof(uint64_t));
+    hot_latched = rt_alloc(num_words * sizeof(uint64_t));
+    if (!slow_temp || !slow_temp_ns || !fire_latched || !hot_latched) return -1;
+    
+    sensor_cabins = num_cabins;
+    return 0;
+}
+
+bool sensors_enabled() {
+    return sensor_cabins > 0;
+}
+
+// Append a sample (caller is the cabin's only producer)
+void sensor_ingest(int cabin_id, SensorKind kind, int16_t value) {
+    uint32_t n = written[kind][cabin_id];
+    int16_t* ring = samples[kind] + (size_t)cabin_id * SENSOR_RING;
+    uint32_t slot = n & (SENSOR_WINDOW - 1);
+    ((volatile int16_t*)ring)[slot] = value;
+    ((volatile int16_t*)ring)[slot + SENSOR_WINDOW] = value;
+    __atomic_store_n(&written[kind][cabin_id], n + 1, __ATOMIC_RELEASE);
+}
+
+// Window statistics: plain reductions over a fixed-size array, which the
+// compiler vectorizes
+static void window_stats(const int16_t* restrict x, SensorStats* out) {
+    int lo = x[0];
+    int hi = x[0];
+    int32_t sum = 0;
+    
+    for (int k = 0; k < SENSOR_WINDOW; k++) {
+        lo = x[k] < lo ? x[k] : lo;
+        hi = x[k] > hi ? x[k] : hi;
+        sum += x[k];
+    }
+    
+    out->min = lo;
+    out->max = hi;
+    out->mean = sum / (float)SENSOR_WINDOW;
+}
+
+// Statistics over a cabin's last SENSOR_WINDOW samples of one sensor,
+// computed in place. Returns false until the window has filled. Stats
+// that overlapped a new sample are computed again (a few times at most),
+// as a seqlock reader would.
+bool sensor_window(int cabin_id, SensorKind kind, SensorStats* out) {
+    const int16_t* ring = samples[kind] + (size_t)cabin_id * SENSOR_RING;
+    uint32_t n = __atomic_load_n(&written[kind][cabin_id], __ATOMIC_ACQUIRE);
+    
+    if (n < SENSOR_WINDOW) return false;
+    
+    for (int attempt = 0;; attempt++) {
+        window_stats(ring + (n & (SENSOR_WINDOW - 1)), out);
+        
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t now = __atomic_load_n(&written[kind][cabin_id], __ATOMIC_RELAXED);
+        if (now == n) break;
+        if (attempt == SENSOR_WINDOW_RETRIES) {
+            __atomic_store_n(&torn_windows, torn_windows + 1, __ATOMIC_RELAXED);
+            break;
+        }
+        n = now;
+    }
+    
+    return true;
+}
+
+static bool bit_test(const uint64_t* bits, int cabin_id) {
+    return (bits[cabin_id / CABINS_PER_WORD] >> (cabin_id % CABINS_PER_WORD)) & 1;
+}
+
+static void bit_assign(uint64_t* bits, int cabin_id, bool on) {
+    uint64_t bit = 1ULL << (cabin_id % CABINS_PER_WORD);
+    if (on) {
+        bits[cabin_id / CABINS_PER_WORD] |= bit;
+    } else {
+        bits[cabin_id / CABINS_PER_WORD] &= ~bit;
+    }
+}
+
+// Rate of rise of a cabin's temperature, Celsius per minute: a steady
+// ramp keeps the window mean SENSOR_RISE_TAU_S worth of rise ahead of
+// its slow average, while sample noise is averaged away
+static float temperature_rise(int cabin_id, float mean, uint64_t now_ns) {
+    if (slow_temp_ns[cabin_id] == 0) {
+        slow_temp[cabin_id] = mean;
+        slow_temp_ns[cabin_id] = now_ns;
+        return 0.0f;
+    }
+    
+    float rise_per_s = (mean - slow_temp[cabin_id]) / SENSOR_RISE_TAU_S;
+    float alpha = (now_ns - slow_temp_ns[cabin_id]) / 1e9f / SENSOR_RISE_TAU_S;
+    slow_temp[cabin_id] += (mean - slow_temp[cabin_id]) * (alpha < 1.0f ? alpha : 1.0f);
+    slow_temp_ns[cabin_id] = now_ns;
+    
+    return rise_per_s * 60.0f / 10.0f;
+}
+
+// Alarm rules for one cabin (either window may be missing)
+static void apply_rules(int cabin_id, const SensorStats* smoke, const SensorStats* temp, uint64_t now_ns) {
+    float rise_per_min = temp ? temperature_rise(cabin_id, temp->mean, now_ns) : 0.0f;
+    int setpoint = ((const volatile int16_t*)g_system.cabins.setpoint)[cabin_id] * 10;
+    bool dense_smoke = smoke && smoke->mean >= SENSOR_SMOKE_ALARM;
+    bool heat = temp && temp->max >= SENSOR_HEAT_ALARM;
+    bool rising = rise_per_min >= SENSOR_RISE_ALARM && temp->mean >= setpoint + SENSOR_RISE_MARGIN;
+    
+    if (!bit_test(fire_latched, cabin_id)) {
+        if (dense_smoke || heat || rising) {
+            bit_assign(fire_latched, cabin_id, true);
+            __atomic_store_n(&fire_alarms, fire_alarms + 1, __ATOMIC_RELAXED);
+            log_message("Sensor alarm in Cabin %d: smoke %.1f %%/m, peak %.1f C, rising %.1f C/min",
+                        cabin_id, smoke ? smoke->mean / 10.0f : 0.0f, temp ? temp->max / 10.0f : 0.0f,
+                        rise_per_min);
+            handle_fire_alert(cabin_id);
+            return;
+        }
+    } else if ((!smoke || smoke->mean < SENSOR_SMOKE_CLEAR) && !heat && rise_per_min < SENSOR_RISE_ALARM / 2) {
+        bit_assign(fire_latched, cabin_id, false);
+    }
+    
+    if (!temp || bit_test(fire_latched, cabin_id)) return;
+    
+    if (!bit_test(hot_latched, cabin_id) && temp->mean >= SENSOR_HOT) {
+        bit_assign(hot_latched, cabin_id, true);
+        __atomic_store_n(&hot_alarms, hot_alarms + 1, __ATOMIC_RELAXED);
+        log_message("Cabin %d overheated (%.1f C average)", cabin_id, temp->mean / 10.0f);
+        adjust_temperature(cabin_id, SENSOR_COOL_SETPOINT);
+    } else if (temp->mean < SENSOR_HOT_CLEAR) {
+        bit_assign(hot_latched, cabin_id, false);
+    }
+}
+
+// One evaluation pass: the windows of every cabin that received samples
+// since the last pass, 64 cabins between preemption points. The pass
+// cost excludes time spent preempted.
+void sensors_evaluate(Task* self) {
+    uint64_t pass_ns = 0;
+    uint64_t evaluated_windows = 0;
+    
+    for (int base = 0; base < sensor_cabins; base += CABINS_PER_WORD) {
+        int end = base + CABINS_PER_WORD < sensor_cabins ? base + CABINS_PER_WORD : sensor_cabins;
+        uint64_t start_ns = monotonic_now_ns();
+        
+        for (int c = base; c < end; c++) {
+            SensorStats stats[NUM_SENSOR_KINDS];
+            bool have[NUM_SENSOR_KINDS];
+            bool fresh = false;
+            
+            for (int k = 0; k < NUM_SENSOR_KINDS; k++) {
+                uint32_t n = __atomic_load_n(&written[k][c], __ATOMIC_ACQUIRE);
+                fresh |= (n != evaluated[k][c]);
+                evaluated[k][c] = n;
+            }
+            if (!fresh) continue;
+            
+            for (int k = 0; k < NUM_SENSOR_KINDS; k++) {
+                have[k] = sensor_window(c, (SensorKind)k, &stats[k]);
+                evaluated_windows += have[k];
+            }
+            if (have[SENSOR_SMOKE] || have[SENSOR_TEMP]) {
+                apply_rules(c, have[SENSOR_SMOKE] ? &stats[SENSOR_SMOKE] : NULL,
+                            have[SENSOR_TEMP] ? &stats[SENSOR_TEMP] : NULL, start_ns);
+            }
+        }
+        pass_ns += monotonic_now_ns() - start_ns;
+        
+        // Let emergency work in between words
+        scheduler_preempt_point(self);
+    }
+    
+    __atomic_store_n(&passes, passes + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&windows, windows + evaluated_windows, __ATOMIC_RELAXED);
+    __atomic_store_n(&pass_total_ns, pass_total_ns + pass_ns, __ATOMIC_RELAXED);
+    if (pass_ns > pass_max_ns) {
+        __atomic_store_n(&pass_max_ns, pass_ns, __ATOMIC_RELAXED);
+    }
+}
+
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int16_t clamp_sample(float value) {
+    return (int16_t)(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
+}
+
+// One sample of each sensor for a cabin: the simulated cabin temperature
+// and clean air, plus noise; the burning cabin adds smoke and heat
+// growing with the time since ignition
+static void synthesize(int cabin_id, uint64_t now_ns, uint32_t* seed) {
+    float temp = ((const volatile int16_t*)g_system.cabins.temperature)[cabin_id] * 10.0f +
+                 (int)(next_random(seed) % 5) - 2;
+    float smoke = 3 + (int)(next_random(seed) % 3) - 1;
+    
+    uint64_t ignite_ns = source.start_ns + SENSOR_SYNTH_FIRE_DELAY_S * 1000000000ULL;
+    if (cabin_id == source.fire_cabin && now_ns > ignite_ns) {
+        float burning_s = (now_ns - ignite_ns) / 1e9f;
+        smoke += SENSOR_SYNTH_SMOKE_RISE * burning_s;
+        temp += SENSOR_SYNTH_HEAT_RISE * burning_s / 60.0f * 10.0f;
+    }
+    
+    sensor_ingest(cabin_id, SENSOR_SMOKE, clamp_sample(smoke));
+    sensor_ingest(cabin_id, SENSOR_TEMP, clamp_sample(temp));
+}
+
+// Synthetic source: every tick, the samples owed at the configured rate,
+// one cabin after another. After a stall it makes up at most
+// SENSOR_SYNTH_MAX_CATCHUP ticks, so its CPU use stays bounded.
+static void* source_thread(void* arg) {
+    (void)arg;
+    const uint64_t tick_ns = SENSOR_SYNTH_TICK_US * 1000ULL;
+    uint64_t next_ns = source.start_ns;
+    uint32_t seed = 0x9e3779b9u;
+    double owed = 0.0;
+    int cursor = 0;
+    
+    lock_thread_set("Sensor Source", 0);
+    rt_thread_start("Sensor Source");
+    
+    for (;;) {
+        next_ns += tick_ns;
+        struct timespec due = { .tv_sec = next_ns / 1000000000ULL, .tv_nsec = next_ns % 1000000000ULL };
+        if (!shutdown_sleep_until(&due)) break;
+        
+        uint64_t now_ns = monotonic_now_ns();
+        uint64_t ticks = 1 + (now_ns - next_ns) / tick_ns;
+        if (ticks > SENSOR_SYNTH_MAX_CATCHUP) {
+            ticks = SENSOR_SYNTH_MAX_CATCHUP;
+            next_ns = now_ns;
+            __atomic_store_n(&source.stalls, source.stalls + 1, __ATOMIC_RELAXED);
+        } else {
+            next_ns += (ticks - 1) * tick_ns;
+        }
+        
+        owed += source.rate * ticks * tick_ns / 1e9;
+        int cabins = (int)(owed / NUM_SENSOR_KINDS);
+        owed -= cabins * NUM_SENSOR_KINDS;
+        
+        for (int i = 0; i < cabins; i++) {
+            synthesize(cursor, now_ns, &seed);
+            cursor = (cursor + 1) % sensor_cabins;
+        }
+        
+        struct timespec cpu;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+        __atomic_store_n(&source.produced, source.produced + (uint64_t)cabins * NUM_SENSOR_KINDS,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&source.cpu_ns, timespec_to_ns(&cpu), __ATOMIC_RELAXED);
+    }
+    
+    rt_thread_stop();
+    return NULL;
+}
+
+// Start the synthetic source at `rate` samples/s; fire_cabin >= 0 catches
+// fire SENSOR_SYNTH_FIRE_DELAY_S in. Returns 0 or -1.
+int sensors_source_start(double rate, int fire_cabin) {
+    pthread_attr_t attr;
+    
+    source.rate = rate;
+    source.fire_cabin = fire_cabin;
+    source.start_ns = monotonic_now_ns();
+    
+    rt_thread_attr_init(&attr, RT_THREAD_STACK_SIZE);
+    source.started = pthread_create(&source.thread, &attr, source_thread, NULL) == 0;
+    pthread_attr_destroy(&attr);
+    if (!source.started) {
+        log_message("Error: Failed to create sensor source thread");
+        return -1;
+    }
+    
+    log_message("Sensor source started: %.0f samples/s over %d cabins", rate, sensor_cabins);
+    return 0;
+}
+
+// Join the source (it stops on the shutdown latch)
+void sensors_source_stop() {
+    if (!source.started) return;
+    pthread_join(source.thread, NULL);
+    source.started = false;
+}
+
+// Ingestion and alarm counters for STATUS
+void sensors_print_stats() {
+    if (!sensors_enabled()) return;
+    
+    uint64_t pass_count = __atomic_load_n(&passes, __ATOMIC_RELAXED);
+    uint64_t received = 0;
+    for (int k = 0; k < NUM_SENSOR_KINDS; k++) {
+        for (int c = 0; c < sensor_cabins; c++) {
+            received += __atomic_load_n(&written[k][c], __ATOMIC_RELAXED);
+        }
+    }
+    
+    printf("\nSensors (window %d samples):\n", SENSOR_WINDOW);
+    printf("Samples: %lu received, %lu windows evaluated (%lu torn) in %lu passes\n", received,
+           __atomic_load_n(&windows, __ATOMIC_RELAXED),
+           __atomic_load_n(&torn_windows, __ATOMIC_RELAXED), pass_count);
+    printf("Pass: avg %.1f us, max %.1f us\n",
+           pass_count ? __atomic_load_n(&pass_total_ns, __ATOMIC_RELAXED) / (double)pass_count / 1000.0 : 0.0,
+           __atomic_load_n(&pass_max_ns, __ATOMIC_RELAXED) / 1000.0);
+    printf("Alarms: %lu fire, %lu overheat\n", __atomic_load_n(&fire_alarms, __ATOMIC_RELAXED),
+           __atomic_load_n(&hot_alarms, __ATOMIC_RELAXED));
+    
+    if (source.started) {
+        double elapsed_s = (monotonic_now_ns() - source.start_ns) / 1e9;
+        uint64_t produced = __atomic_load_n(&source.produced, __ATOMIC_RELAXED);
+        printf("Synthetic source: %.0f samples/s (target %.0f), CPU %.1f%%, %lu stalls\n",
+               elapsed_s > 0 ? produced / elapsed_s : 0.0, source.rate,
+               elapsed_s > 0 ? __atomic_load_n(&source.cpu_ns, __ATOMIC_RELAXED) / 1e9 / elapsed_s * 100.0 : 0.0,
+               __atomic_load_n(&source.stalls, __ATOMIC_RELAXED));
+    }
+}
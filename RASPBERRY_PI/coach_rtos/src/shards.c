@@ -0,0 +1,461 @@
+#define _GNU_SOURCE
+#include "shards.h"
+#include "thermal.h"
+#include "metrics.h"
+#include "locks.h"
+#include "rt.h"
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+
+// One update of the cabins [first, end) for a shard, which applies the
+// part it owns; range posts carry the fan-out they report to
+typedef struct ShardFanOut ShardFanOut;
+
+typedef struct {
+    CabinOp op;
+    int first;
+    int end;
+    int value;
+    ShardFanOut* fanout;
+} ShardMessage;
+
+typedef struct {
+    atomic_size_t sequence;
+    ShardMessage message;
+} ShardSlot;
+
+// A range post in flight: the shards still to handle it and their summed
+// results. The slot is reused once the last shard has reported.
+struct ShardFanOut {
+    atomic_bool busy;
+    atomic_int remaining;
+    atomic_int total;
+    void (*done)(CabinOp op, int value, int total);
+};
+
+// A shard: its words, its inbox (per-slot sequence numbers, as in the
+// event queues) and its thread. The thread sleeps on wake_fd only after
+// setting `sleeping` and finding nothing to do; producers that see the
+// flag after queueing clear it and write the eventfd.
+typedef struct {
+    ShardSlot slots[SHARD_INBOX_CAPACITY];
+    atomic_size_t enqueue_pos;
+    size_t dequeue_pos;
+    
+    int first_word;
+    int end_word;
+    int wake_fd;
+    atomic_bool sleeping;
+    atomic_bool tick_pending;
+    pthread_t thread;
+    int cpu;                 // -1 if unpinned
+    char name[16];
+    
+    // Producers count posts, waits on a full inbox and tick requests; the
+    // shard thread owns the rest
+    atomic_uint_fast64_t posted;
+    atomic_uint_fast64_t full_waits;
+    atomic_uint_fast64_t tick_requests;
+    atomic_uint_fast64_t ticks_coalesced;
+    uint64_t handled;
+    uint64_t ticks;
+    uint64_t wakeups;
+} Shard;
+
+static Shard shards[SHARD_MAX];
+static int num_shards = 0;
+static uint8_t word_owner[(MAX_CABINS + CABINS_PER_WORD - 1) / CABINS_PER_WORD];
+static bool shards_running = false;
+static ShardFanOut fanouts[SHARD_FANOUT_SLOTS];
+
+// Split the cabin words into `requested` contiguous ranges (at most one
+// per word and SHARD_MAX) and set up the inboxes. Returns 0 or -1.
+int shards_init(int requested) {
+    int num_words = g_system.cabins.num_words;
+    
+    num_shards = 0;
+    if (requested <= 0) return 0;
+    
+    int count = requested < num_words ? requested : num_words;
+    if (count > SHARD_MAX) count = SHARD_MAX;
+    
+    for (int s = 0; s < count; s++) {
+        Shard* shard = &shards[s];
+        
+        for (size_t i = 0; i < SHARD_INBOX_CAPACITY; i++) {
+            atomic_store_explicit(&shard->slots[i].sequence, i, memory_order_relaxed);
+        }
+        atomic_store(&shard->enqueue_pos, 0);
+        shard->dequeue_pos = 0;
+        
+        shard->first_word = s * num_words / count;
+        shard->end_word = (s + 1) * num_words / count;
+        for (int w = shard->first_word; w < shard->end_word; w++) {
+            word_owner[w] = (uint8_t)s;
+        }
+        
+        atomic_store(&shard->sleeping, false);
+        atomic_store(&shard->tick_pending, false);
+        atomic_store(&shard->posted, 0);
+        atomic_store(&shard->full_waits, 0);
+        atomic_store(&shard->tick_requests, 0);
+        atomic_store(&shard->ticks_coalesced, 0);
+        shard->handled = 0;
+        shard->ticks = 0;
+        shard->wakeups = 0;
+        shard->cpu = -1;
+        snprintf(shard->name, sizeof(shard->name), "shard[%d]", s);
+        
+        shard->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (shard->wake_fd < 0) {
+            fprintf(stderr, "Cannot create shard eventfd: %s\n", strerror(errno));
+            for (int k = 0; k < s; k++) close(shards[k].wake_fd);
+            return -1;
+        }
+    }
+    
+    num_shards = count;
+    return 0;
+}
+
+int shards_count() {
+    return num_shards;
+}
+
+bool shards_enabled() {
+    return num_shards > 0;
+}
+
+int shard_of(int cabin_id) {
+    return word_owner[cabin_id / CABINS_PER_WORD];
+}
+
+void shard_range(int shard, int* first, int* end) {
+    int count = g_system.cabins.count;
+    
+    *first = shards[shard].first_word * CABINS_PER_WORD;
+    *end = shards[shard].end_word * CABINS_PER_WORD;
+    if (*end > count) *end = count;
+}
+
+static bool inbox_push(Shard* shard, const ShardMessage* message) {
+    size_t pos = atomic_load_explicit(&shard->enqueue_pos, memory_order_relaxed);
+    ShardSlot* slot;
+    
+    for (;;) {
+        slot = &shard->slots[pos & (SHARD_INBOX_CAPACITY - 1)];
+        size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&shard->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&shard->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    
+    slot->message = *message;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+// Oldest message, shard thread only. Returns false when the inbox is empty.
+static bool inbox_take(Shard* shard, ShardMessage* out) {
+    ShardSlot* slot = &shard->slots[shard->dequeue_pos & (SHARD_INBOX_CAPACITY - 1)];
+    
+    size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (seq != shard->dequeue_pos + 1) return false;
+    
+    *out = slot->message;
+    atomic_store_explicit(&slot->sequence, shard->dequeue_pos + SHARD_INBOX_CAPACITY,
+                          memory_order_release);
+    shard->dequeue_pos++;
+    return true;
+}
+
+static bool inbox_empty(Shard* shard) {
+    ShardSlot* slot = &shard->slots[shard->dequeue_pos & (SHARD_INBOX_CAPACITY - 1)];
+    return atomic_load_explicit(&slot->sequence, memory_order_acquire) != shard->dequeue_pos + 1;
+}
+
+// Wake the shard if it is (about to be) asleep. The fence orders the
+// caller's queueing before the check, against the shard's flag store
+// before its last look at the inbox.
+static void shard_wake(Shard* shard) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&shard->sleeping, memory_order_relaxed) &&
+        atomic_exchange(&shard->sleeping, false)) {
+        uint64_t one = 1;
+        ssize_t n = write(shard->wake_fd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+// Queue a message and wake the shard. A full inbox is waited out
+// (counted); only after shards_stop() is the message dropped.
+static void shard_send(Shard* shard, const ShardMessage* message) {
+    while (!inbox_push(shard, message)) {
+        if (!__atomic_load_n(&shards_running, __ATOMIC_ACQUIRE)) return;
+        atomic_fetch_add_explicit(&shard->full_waits, 1, memory_order_relaxed);
+        shard_wake(shard);
+        sched_yield();
+    }
+    atomic_fetch_add_explicit(&shard->posted, 1, memory_order_relaxed);
+    shard_wake(shard);
+}
+
+// Queue an operation for one cabin's owner
+void shards_post(int cabin_id, CabinOp op, int value) {
+    ShardMessage message = { .op = op, .first = cabin_id, .end = cabin_id + 1, .value = value,
+                             .fanout = NULL };
+    shard_send(&shards[shard_of(cabin_id)], &message);
+}
+
+// Queue an operation for the cabins [first, end): only the shards owning
+// some of them get it, each applying it to its own part
+void shards_post_range(int first, int end, CabinOp op, int value,
+                       void (*done)(CabinOp op, int value, int total)) {
+    if (first >= end) return;
+    
+    int first_shard = shard_of(first);
+    int last_shard = shard_of(end - 1);
+    ShardFanOut* fanout = NULL;
+    
+    // Slots free up as soon as the shards have handled a range post
+    while (!fanout) {
+        for (int i = 0; i < SHARD_FANOUT_SLOTS && !fanout; i++) {
+            bool idle = false;
+            if (atomic_compare_exchange_strong(&fanouts[i].busy, &idle, true)) {
+                fanout = &fanouts[i];
+            }
+        }
+        if (!fanout) sched_yield();
+    }
+    
+    atomic_store(&fanout->remaining, last_shard - first_shard + 1);
+    atomic_store(&fanout->total, 0);
+    fanout->done = done;
+    
+    ShardMessage message = { .op = op, .first = first, .end = end, .value = value, .fanout = fanout };
+    for (int s = first_shard; s <= last_shard; s++) {
+        shard_send(&shards[s], &message);
+    }
+}
+
+// Ask every shard for one thermal control step of its words
+void shards_thermal_tick() {
+    for (int s = 0; s < num_shards; s++) {
+        Shard* shard = &shards[s];
+        
+        atomic_fetch_add_explicit(&shard->tick_requests, 1, memory_order_relaxed);
+        if (atomic_exchange(&shard->tick_pending, true)) {
+            atomic_fetch_add_explicit(&shard->ticks_coalesced, 1, memory_order_relaxed);
+        } else {
+            shard_wake(shard);
+        }
+    }
+}
+
+// Report a shard's part of a range post; the last one runs the callback
+static void fanout_report(const ShardMessage* message, int result) {
+    ShardFanOut* fanout = message->fanout;
+    
+    atomic_fetch_add(&fanout->total, result);
+    if (atomic_fetch_sub(&fanout->remaining, 1) == 1) {
+        if (fanout->done) fanout->done(message->op, message->value, atomic_load(&fanout->total));
+        atomic_store(&fanout->busy, false);
+    }
+}
+
+// Apply one message to the shard's part of its cabins: no locks, this
+// thread is their only writer
+static void shard_handle(Shard* shard, const ShardMessage* message) {
+    int first = shard->first_word * CABINS_PER_WORD;
+    int end = shard->end_word * CABINS_PER_WORD;
+    
+    if (first < message->first) first = message->first;
+    if (end > message->end) end = message->end;
+    
+    int changed = cabins_apply_range(&g_system.cabins, first, end, message->op, message->value);
+    if (message->fanout) fanout_report(message, changed);
+    
+    __atomic_store_n(&shard->handled, shard->handled + 1, __ATOMIC_RELEASE);
+}
+
+static void shard_drain(Shard* shard) {
+    ShardMessage message;
+    
+    while (inbox_take(shard, &message)) {
+        shard_handle(shard, &message);
+    }
+}
+
+// One thermal control step of the shard's words, handling updates that
+// arrive in between (the step cost excludes them)
+static void shard_thermal_step(Shard* shard) {
+    CabinStore* cabins = &g_system.cabins;
+    uint64_t step_ns = 0;
+    int settled = 0;
+    
+    for (int w = shard->first_word; w < shard->end_word; w++) {
+        uint64_t start_ns = monotonic_now_ns();
+        settled += thermal_step_word(cabins, w, THERMAL_DT);
+        step_ns += monotonic_now_ns() - start_ns;
+        
+        shard_drain(shard);
+    }
+    metrics_record(METRIC_THERMAL_STEP, step_ns);
+    __atomic_store_n(&shard->ticks, shard->ticks + 1, __ATOMIC_RELEASE);
+    
+    if (settled > 0) {
+        log_message("Temperature settled in %d cabins", settled);
+    }
+}
+
+static bool shard_idle(Shard* shard) {
+    return inbox_empty(shard) && !atomic_load(&shard->tick_pending) &&
+           __atomic_load_n(&shards_running, __ATOMIC_ACQUIRE);
+}
+
+static void* shard_main(void* arg) {
+    Shard* shard = (Shard*)arg;
+    struct pollfd pfd = { .fd = shard->wake_fd, .events = POLLIN };
+    
+    lock_thread_set(shard->name, 0);
+    rt_thread_start(shard->name);
+    
+    for (;;) {
+        shard_drain(shard);
+        if (atomic_exchange(&shard->tick_pending, false)) {
+            shard_thermal_step(shard);
+            continue;
+        }
+        
+        // Stopped: everything posted before shards_stop() is handled
+        if (!__atomic_load_n(&shards_running, __ATOMIC_ACQUIRE) && inbox_empty(shard)) break;
+        
+        atomic_store(&shard->sleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!shard_idle(shard)) {
+            atomic_store(&shard->sleeping, false);
+            continue;
+        }
+        
+        poll(&pfd, 1, -1);
+        uint64_t count;
+        ssize_t n = read(shard->wake_fd, &count, sizeof(count));
+        (void)n;
+        atomic_store(&shard->sleeping, false);
+        __atomic_store_n(&shard->wakeups, shard->wakeups + 1, __ATOMIC_RELAXED);
+    }
+    
+    rt_thread_stop();
+    return NULL;
+}
+
+// Start one thread per shard, shard s pinned to CPU s modulo the online
+// CPUs. Returns 0, or -1 (with no shard running) if a thread cannot start.
+int shards_start() {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    
+    __atomic_store_n(&shards_running, true, __ATOMIC_RELEASE);
+    
+    for (int s = 0; s < num_shards; s++) {
+        Shard* shard = &shards[s];
+        pthread_attr_t attr;
+        cpu_set_t cpu_set;
+        
+        shard->cpu = s % (int)cpus;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(shard->cpu, &cpu_set);
+        rt_thread_attr_init(&attr, RT_THREAD_STACK_SIZE);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set);
+        
+        int result = pthread_create(&shard->thread, &attr, shard_main, shard);
+        if (result != 0) {
+            // Pinning may be refused (e.g. a restricted cpuset); run unpinned
+            pthread_attr_destroy(&attr);
+            rt_thread_attr_init(&attr, RT_THREAD_STACK_SIZE);
+            shard->cpu = -1;
+            result = pthread_create(&shard->thread, &attr, shard_main, shard);
+        }
+        pthread_attr_destroy(&attr);
+        
+        if (result != 0) {
+            fprintf(stderr, "Cannot start shard thread %d\n", s);
+            num_shards = s;
+            shards_stop();
+            num_shards = 0;
+            return -1;
+        }
+    }
+    
+    log_message("Shards started: %d owning %d cabins", num_shards, g_system.cabins.count);
+    return 0;
+}
+
+// Handle everything already posted, then join the shard threads. Call once
+// nothing posts any more (input and tasks stopped).
+void shards_stop() {
+    if (!__atomic_exchange_n(&shards_running, false, __ATOMIC_ACQ_REL)) return;
+    
+    for (int s = 0; s < num_shards; s++) {
+        uint64_t one = 1;
+        ssize_t n = write(shards[s].wake_fd, &one, sizeof(one));
+        (void)n;
+    }
+    for (int s = 0; s < num_shards; s++) {
+        pthread_join(shards[s].thread, NULL);
+        close(shards[s].wake_fd);
+    }
+}
+
+void shards_sync() {
+    for (int s = 0; s < num_shards; s++) {
+        Shard* shard = &shards[s];
+        
+        while (__atomic_load_n(&shard->handled, __ATOMIC_ACQUIRE) <
+                   atomic_load(&shard->posted) ||
+               __atomic_load_n(&shard->ticks, __ATOMIC_ACQUIRE) +
+                   atomic_load(&shard->ticks_coalesced) < atomic_load(&shard->tick_requests)) {
+            sched_yield();
+        }
+    }
+}
+
+// Per-shard counters for STATUS
+void shards_print_stats() {
+    if (num_shards == 0) return;
+    
+    printf("\nShards (inbox %d, no cabin locks):\n", SHARD_INBOX_CAPACITY);
+    printf("%-10s %-12s %-5s %-10s %-10s %-10s %-8s %-10s %-10s\n",
+           "Shard", "Cabins", "CPU", "Posted", "Handled", "FullWaits", "Ticks", "Coalesced", "Wakeups");
+    printf("----------------------------------------------------------------------------------------------\n");
+    
+    for (int s = 0; s < num_shards; s++) {
+        Shard* shard = &shards[s];
+        char range[24];
+        int first, end;
+        
+        shard_range(s, &first, &end);
+        snprintf(range, sizeof(range), "%d-%d", first, end - 1);
+        printf("%-10s %-12s %-5d %-10lu %-10lu %-10lu %-8lu %-10lu %-10lu\n", shard->name, range,
+               shard->cpu,
+               (uint64_t)atomic_load_explicit(&shard->posted, memory_order_relaxed),
+               __atomic_load_n(&shard->handled, __ATOMIC_RELAXED),
+               (uint64_t)atomic_load_explicit(&shard->full_waits, memory_order_relaxed),
+               __atomic_load_n(&shard->ticks, __ATOMIC_RELAXED),
+               (uint64_t)atomic_load_explicit(&shard->ticks_coalesced, memory_order_relaxed),
+               __atomic_load_n(&shard->wakeups, __ATOMIC_RELAXED));
+    }
+}
@@ -0,0 +1,129 @@
+#include "shm_export.h"
+#include "state.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The mapped segment; only the export task writes it after open
+static CoachShmHeader* header = NULL;
+static CoachShmCabin* cabins = NULL;
+static size_t segment_size = 0;
+static char segment_name[64];
+
+// Create (or take over) the segment `name` and size it for the cabin
+// store. Returns 0 or -1.
+int shm_export_open(const char* name) {
+    size_t header_size = (sizeof(CoachShmHeader) + 63) & ~(size_t)63;
+    segment_size = header_size + (size_t)g_system.cabins.count * sizeof(CoachShmCabin);
+    
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        log_message("Error: shm_open %s failed", name);
+        return -1;
+    }
+    if (ftruncate(fd, segment_size) != 0) {
+        log_message("Error: cannot size shared memory %s", name);
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    
+    void* map = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_message("Error: cannot map shared memory %s", name);
+        shm_unlink(name);
+        return -1;
+    }
+    
+    header = (CoachShmHeader*)map;
+    cabins = (CoachShmCabin*)((uint8_t*)map + header_size);
+    strncpy(segment_name, name, sizeof(segment_name) - 1);
+    
+    // Readers check the magic and version before trusting anything else
+    memset(map, 0, segment_size);
+    header->version = COACH_SHM_VERSION;
+    header->header_size = (uint16_t)header_size;
+    header->pid = (uint32_t)getpid();
+    header->num_cabins = (uint32_t)g_system.cabins.count;
+    __atomic_store_n(&header->magic, COACH_SHM_MAGIC, __ATOMIC_RELEASE);
+    
+    log_message("State exported to shared memory %s (%zu bytes)", name, segment_size);
+    return 0;
+}
+
+bool shm_export_enabled() {
+    return header != NULL;
+}
+
+static void copy_task(const Task* task, CoachShmTask* out) {
+    strncpy(out->name, task->name, sizeof(out->name) - 1);
+    out->priority = task->priority;
+    out->state = task->state;
+    out->execution_count = task->execution_count;
+    out->preempt_count = task->preempt_count;
+    out->wakeup_count = task->wakeup_count;
+    out->wakeup_latency_max_ns = task->wakeup_latency_max_ns;
+    out->period_us = task->period_us;
+    out->release_count = task->release_count;
+    out->missed_releases = task->missed_releases;
+    out->jitter_max_ns = task->jitter_max_ns;
+}
+
+// Publish the current state: a consistent snapshot of cabins and flags,
+// written inside the segment's own sequence so readers never see a mix
+void shm_export_publish() {
+    if (!header) return;
+    
+    StateSnapshot snap;
+    if (state_snapshot_alloc(&snap) != 0) return;
+    state_snapshot(&snap);
+    
+    uint32_t seq = header->sequence;
+    __atomic_store_n(&header->sequence, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    header->publish_count++;
+    header->publish_ns = monotonic_now_ns();
+    header->state_version = snap.sequence;
+    header->system_running = snap.system_running;
+    header->power_low = snap.power_low;
+    header->chain_pulled = snap.chain_pulled;
+    header->fire_cabins = snap.fire_cabins;
+    header->emergency_cabins = snap.emergency_cabins;
+    
+    int num_tasks = g_system.num_tasks < COACH_SHM_MAX_TASKS ? g_system.num_tasks : COACH_SHM_MAX_TASKS;
+    header->num_tasks = (uint32_t)num_tasks;
+    for (int i = 0; i < num_tasks; i++) {
+        copy_task(&g_system.tasks[i], &header->tasks[i]);
+    }
+    
+    for (int i = 0; i < snap.num_cabins; i++) {
+        cabins[i].light_on = snap.cabins[i].light_on;
+        cabins[i].state = (uint8_t)snap.cabins[i].state;
+        cabins[i].temperature = (int16_t)snap.cabins[i].temperature;
+        cabins[i].setpoint = (int16_t)snap.cabins[i].setpoint;
+    }
+    
+    __atomic_store_n(&header->sequence, seq + 2, __ATOMIC_RELEASE);
+    
+    state_snapshot_free(&snap);
+}
+
+// Publish a last copy marked not running, then remove the segment name;
+// readers that still have it mapped keep the final state
+void shm_export_close() {
+    if (!header) return;
+    
+    shm_export_publish();
+    uint32_t seq = header->sequence;
+    __atomic_store_n(&header->sequence, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    header->system_running = 0;
+    __atomic_store_n(&header->sequence, seq + 2, __ATOMIC_RELEASE);
+    
+    munmap(header, segment_size);
+    shm_unlink(segment_name);
+    header = NULL;
+    cabins = NULL;
+}
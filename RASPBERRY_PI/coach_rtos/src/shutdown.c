@@ -0,0 +1,119 @@
+#define _GNU_SOURCE
+#include "shutdown.h"
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+// The latch: never read, so once written it stays readable and wakes
+// every current and future poll on it
+static int latch_fd = -1;
+static int request_signal = 0;      // Signal number, 0 for internal requests
+static uint64_t requested_ns = 0;   // Monotonic time of the first request (0: none)
+
+// Teardown phases, as offsets from the request
+typedef struct {
+    const char* name;
+    uint64_t at_ns;
+} ShutdownPhase;
+
+static ShutdownPhase phases[SHUTDOWN_MAX_PHASES];
+static int num_phases = 0;
+
+// Create the latch; before the signal handlers are installed. Returns 0
+// or -1.
+int shutdown_init() {
+    latch_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (latch_fd < 0) {
+        fprintf(stderr, "Cannot create shutdown eventfd: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Ask every thread to stop. Async-signal-safe (clock_gettime(), atomics
+// and write() only), so signal handlers call it directly; later requests
+// keep the first one's time and signal.
+void shutdown_request(int sig) {
+    int saved_errno = errno;
+    struct timespec now;
+    uint64_t none = 0;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (__atomic_compare_exchange_n(&requested_ns, &none, timespec_to_ns(&now), false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        request_signal = sig;
+    }
+    g_system.system_running = false;
+    
+    uint64_t one = 1;
+    if (latch_fd >= 0 && write(latch_fd, &one, sizeof(one)) < 0) {
+        // Only fails once the counter is saturated: already readable
+    }
+    errno = saved_errno;
+}
+
+bool shutdown_requested() {
+    return __atomic_load_n(&requested_ns, __ATOMIC_ACQUIRE) != 0;
+}
+
+// Descriptor for poll() sets: readable once shutdown is requested
+int shutdown_fd() {
+    return latch_fd;
+}
+
+// Block until shutdown is requested
+void shutdown_wait() {
+    struct pollfd pfd = { .fd = latch_fd, .events = POLLIN };
+    
+    while (!shutdown_requested()) {
+        poll(&pfd, 1, -1);
+    }
+}
+
+// Sleep until an absolute CLOCK_MONOTONIC time. Returns true at the
+// deadline, false as soon as shutdown is requested.
+bool shutdown_sleep_until(const struct timespec* deadline) {
+    struct pollfd pfd = { .fd = latch_fd, .events = POLLIN };
+    uint64_t due_ns = timespec_to_ns(deadline);
+    
+    for (;;) {
+        if (shutdown_requested()) return false;
+        
+        uint64_t now_ns = monotonic_now_ns();
+        if (now_ns >= due_ns) return true;
+        
+        uint64_t wait_ns = due_ns - now_ns;
+        struct timespec timeout = { .tv_sec = wait_ns / 1000000000ULL, .tv_nsec = wait_ns % 1000000000ULL };
+        if (ppoll(&pfd, 1, &timeout, NULL) > 0) return false;
+    }
+}
+
+// Note that a teardown phase has finished (main thread only)
+void shutdown_mark(const char* phase) {
+    if (num_phases == SHUTDOWN_MAX_PHASES || !shutdown_requested()) return;
+    
+    phases[num_phases].name = phase;
+    phases[num_phases].at_ns = monotonic_now_ns() - __atomic_load_n(&requested_ns, __ATOMIC_ACQUIRE);
+    num_phases++;
+}
+
+// Print the time from the request to each phase
+void shutdown_report() {
+    if (num_phases == 0) return;
+    
+    printf("\n=== SHUTDOWN LATENCY (%s) ===\n",
+           request_signal ? strsignal(request_signal) : "internal request");
+    printf("%-24s %-10s %-10s\n", "Phase", "At(ms)", "Took(ms)");
+    
+    uint64_t previous_ns = 0;
+    for (int i = 0; i < num_phases; i++) {
+        printf("%-24s %-10.3f %-10.3f\n", phases[i].name, phases[i].at_ns / 1e6,
+               (phases[i].at_ns - previous_ns) / 1e6);
+        previous_ns = phases[i].at_ns;
+    }
+    
+    double total_ms = previous_ns / 1e6;
+    printf("Total: %.3f ms (%s the %d ms budget)\n", total_ms,
+           total_ms <= SHUTDOWN_BUDGET_MS ? "within" : "over", SHUTDOWN_BUDGET_MS);
+    printf("================================\n");
+}
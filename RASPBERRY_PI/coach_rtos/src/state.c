@@ -0,0 +1,218 @@
+#include "state.h"
+#include "locks.h"
+#include "rt.h"
+#include "shards.h"
+#include <sched.h>
+
+// Sequence locks over the cabin store and the system flags. A counter is
+// odd while a write is in progress; readers retry until they copy the
+// state between two identical even values. The flags have their own
+// sequence, whose writers are serialized by writer_mutex, which is only
+// ever held for a few stores.
+static uint32_t state_sequence = 0;
+static Lock writer_mutex;
+
+// Cabins are covered by one sequence per section: a lock stripe (the
+// 64-cabin words it guards), or with --shards a shard. Writers already
+// hold the stripe or are the shard thread, so they need no mutex.
+#define STATE_SECTIONS (CABIN_LOCK_STRIPES > SHARD_MAX ? CABIN_LOCK_STRIPES : SHARD_MAX)
+
+typedef struct {
+    uint32_t sequence;
+} __attribute__((aligned(64))) SectionSequence;
+
+static SectionSequence section_sequences[STATE_SECTIONS];
+
+// Snapshot buffers sized for every cabin, reserved at startup so readers
+// (display, STATUS, journal) never allocate; bit i of snapshot_free is
+// set while buffer i is free
+static CabinView* snapshot_buffers[STATE_SNAPSHOT_BUFFERS];
+static uint32_t snapshot_free = 0;
+
+// Reset the sequence (before any threads start)
+void state_init() {
+    state_sequence = 0;
+    for (int s = 0; s < STATE_SECTIONS; s++) {
+        section_sequences[s].sequence = 0;
+    }
+    lock_init(&writer_mutex, "state writer");
+}
+
+// Begin a versioned update of the system flags
+void state_write_begin() {
+    lock_acquire(&writer_mutex);
+    __atomic_store_n(&state_sequence, state_sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Publish the update
+void state_write_end() {
+    __atomic_store_n(&state_sequence, state_sequence + 1, __ATOMIC_RELEASE);
+    lock_release(&writer_mutex);
+}
+
+// Section covering a cabin: its shard, or its lock stripe
+static int cabin_section(int cabin_id) {
+    if (shards_enabled()) return shard_of(cabin_id);
+    return (cabin_id / CABINS_PER_WORD) & (CABIN_LOCK_STRIPES - 1);
+}
+
+static uint32_t* cabin_sequence(int cabin_id) {
+    return &section_sequences[cabin_section(cabin_id)].sequence;
+}
+
+// Begin a versioned update of one cabin (or a word of cabins starting at
+// cabin_id); the caller holds its stripe or owns its shard
+void state_cabin_write_begin(int cabin_id) {
+    uint32_t* sequence = cabin_sequence(cabin_id);
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void state_cabin_write_end(int cabin_id) {
+    uint32_t* sequence = cabin_sequence(cabin_id);
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+// Wait for an even sequence and return it
+static uint32_t read_begin(const uint32_t* sequence) {
+    uint32_t seq;
+    
+    while ((seq = __atomic_load_n(sequence, __ATOMIC_ACQUIRE)) & 1) {
+        sched_yield();
+    }
+    
+    return seq;
+}
+
+// True if a writer ran since read_begin() returned seq
+static bool read_retry(const uint32_t* sequence, uint32_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(sequence, __ATOMIC_RELAXED) != seq;
+}
+
+static void copy_cabin(int cabin_id, CabinView* out) {
+    const CabinStore* store = &g_system.cabins;
+    uint64_t bits = ((const volatile uint64_t*)store->light_bits)[cabin_id / CABINS_PER_WORD];
+    uint64_t shed = ((const volatile uint64_t*)store->light_shed)[cabin_id / CABINS_PER_WORD];
+    
+    out->light_on = (bits >> (cabin_id % CABINS_PER_WORD)) & 1;
+    out->light_shed = (shed >> (cabin_id % CABINS_PER_WORD)) & 1;
+    out->hvac_on = ((const volatile uint8_t*)store->hvac_on)[cabin_id];
+    out->temperature = ((const volatile int16_t*)store->temperature)[cabin_id];
+    out->setpoint = ((const volatile int16_t*)store->setpoint)[cabin_id];
+    out->state = (CabinState)((const volatile uint8_t*)store->state)[cabin_id];
+}
+
+// Reserve the snapshot buffers (after the cabin store is sized).
+// Returns 0 or -1.
+int state_snapshot_pool_init() {
+    size_t bytes = (size_t)g_system.cabins.count * sizeof(CabinView);
+    
+    for (int i = 0; i < STATE_SNAPSHOT_BUFFERS; i++) {
+        snapshot_buffers[i] = rt_alloc(bytes);
+        if (!snapshot_buffers[i]) return -1;
+    }
+    __atomic_store_n(&snapshot_free, (1u << STATE_SNAPSHOT_BUFFERS) - 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Room for every cabin in the store: a reserved buffer, or the heap if
+// they are all in use (or were never reserved). Returns 0 or -1.
+int state_snapshot_alloc(StateSnapshot* snap) {
+    snap->num_cabins = g_system.cabins.count;
+    
+    uint32_t free_mask = __atomic_load_n(&snapshot_free, __ATOMIC_ACQUIRE);
+    while (free_mask) {
+        int i = __builtin_ctz(free_mask);
+        if (__atomic_compare_exchange_n(&snapshot_free, &free_mask, free_mask & ~(1u << i), false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            snap->cabins = snapshot_buffers[i];
+            return 0;
+        }
+    }
+    
+    snap->cabins = calloc(snap->num_cabins, sizeof(CabinView));
+    return snap->cabins ? 0 : -1;
+}
+
+void state_snapshot_free(StateSnapshot* snap) {
+    for (int i = 0; i < STATE_SNAPSHOT_BUFFERS; i++) {
+        if (snap->cabins && snap->cabins == snapshot_buffers[i]) {
+            __atomic_fetch_or(&snapshot_free, 1u << i, __ATOMIC_RELEASE);
+            snap->cabins = NULL;
+        }
+    }
+    free(snap->cabins);
+    snap->cabins = NULL;
+    snap->num_cabins = 0;
+}
+
+// Copy the cabins of one section: a shard's range, or every word of a
+// lock stripe
+static void copy_section(int section, StateSnapshot* out) {
+    if (shards_enabled()) {
+        int first, end;
+        
+        shard_range(section, &first, &end);
+        for (int i = first; i < end; i++) {
+            copy_cabin(i, &out->cabins[i]);
+        }
+        return;
+    }
+    
+    for (int first = section * CABINS_PER_WORD; first < out->num_cabins;
+         first += CABIN_LOCK_STRIPES * CABINS_PER_WORD) {
+        int end = first + CABINS_PER_WORD < out->num_cabins ? first + CABINS_PER_WORD : out->num_cabins;
+        for (int i = first; i < end; i++) {
+            copy_cabin(i, &out->cabins[i]);
+        }
+    }
+}
+
+// Copy a view of all cabins and flags without locking; `out` comes from
+// state_snapshot_alloc(). The flags and each section's cabins (a lock
+// stripe, or with --shards a shard) are copied under their own sequences,
+// so they are consistent per section, not across sections, and the
+// version is the sum of them all.
+void state_snapshot(StateSnapshot* out) {
+    int sections = shards_enabled() ? shards_count() : CABIN_LOCK_STRIPES;
+    uint32_t seq;
+    
+    do {
+        seq = read_begin(&state_sequence);
+        out->power_low = g_system.power_low;
+        out->chain_pulled = g_system.chain_pulled;
+    } while (read_retry(&state_sequence, seq));
+    out->sequence = seq;
+    
+    for (int s = 0; s < sections; s++) {
+        const uint32_t* sequence = &section_sequences[s].sequence;
+        
+        do {
+            seq = read_begin(sequence);
+            copy_section(s, out);
+        } while (read_retry(sequence, seq));
+        out->sequence += seq;
+    }
+    
+    out->fire_cabins = 0;
+    out->emergency_cabins = 0;
+    for (int i = 0; i < out->num_cabins; i++) {
+        out->fire_cabins += (out->cabins[i].state == STATE_FIRE);
+        out->emergency_cabins += (out->cabins[i].state == STATE_EMERGENCY);
+    }
+    
+    out->system_running = g_system.system_running;
+}
+
+// Copy one cabin consistently without locking
+void state_read_cabin(int cabin_id, CabinView* out) {
+    const uint32_t* sequence = cabin_sequence(cabin_id);
+    uint32_t seq;
+    
+    do {
+        seq = read_begin(sequence);
+        copy_cabin(cabin_id, out);
+    } while (read_retry(sequence, seq));
+}
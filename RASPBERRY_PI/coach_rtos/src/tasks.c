@@ -1,207 +1,186 @@
 #include "tasks.h"
 #include "scheduler.h"
 #include "display.h"
+#include "log_ring.h"
+#include "state.h"
+#include "cabins.h"
+#include "thermal.h"
+#include "metrics.h"
+#include "events.h"
+#include "shm_export.h"
+#include "shards.h"
+#include "sensors.h"
+#include "power.h"
+#include "peer.h"
 
-// Fire Emergency Task (Priority 10)
-void* fire_emergency_task(void* arg) {
-    Task* self = (Task*)arg;
-    log_message("Fire Emergency Task started");
-    
-    while (g_system.system_running && self->is_active) {
-        pthread_mutex_lock(&g_system.system_mutex);
-        
-        if (g_system.fire_active) {
-            self->state = TASK_RUNNING;
-            pthread_mutex_unlock(&g_system.system_mutex);
-            
-            log_message("[FIRE TASK] Processing fire emergency");
-            scheduler_task_complete(self->id);
-            
-            sleep(1);
-        } else {
-            self->state = TASK_READY;
-            pthread_cond_wait(&g_system.task_ready_cond, &g_system.system_mutex);
-            pthread_mutex_unlock(&g_system.system_mutex);
-        }
+// Cabins and system flags are written inside versioned writes (see
+// state.h) so status readers can copy them without locking. With
+// --shards, cabin updates are posted to the shard owning the cabin and
+// applied there (see shards.h); the event tasks may then run before the
+// owner has applied the update that raised their event.
+//
+// Each task is a run-to-completion step. The scheduler calls it once per
+// release (periodic tasks) or wakeup (event tasks), either on the task's
+// own thread while it holds the CPU token, or on an executor worker
+// (see executor.h). Steps never sleep.
+//
+// Event tasks handle each event of their kind's queue (see events.h)
+// exactly once, EVENT_BATCH at a time, and block again once it is empty.
+
+// Handle up to EVENT_BATCH queued events of a kind. Returns true if the
+// batch filled up, so the task runs again before blocking.
+static bool drain_events(Task* self, EventKind kind, void (*handle)(const Event* event)) {
+    Event event;
+    int handled = 0;
+    
+    while (handled < EVENT_BATCH && event_take(kind, &event)) {
+        handle(&event);
+        handled++;
     }
     
-    log_message("Fire Emergency Task stopped");
-    return NULL;
+    scheduler_task_complete(self->id);
+    return handled == EVENT_BATCH;
+}
+
+static void handle_fire_event(const Event* event) {
+    log_message("[FIRE TASK] Fire response for cabin %d (event %lu)", event->cabin, event->sequence);
+}
+
+static void handle_emergency_event(const Event* event) {
+    log_message("[EMERGENCY TASK] Attending passenger emergency in cabin %d (event %lu)",
+                event->cabin, event->sequence);
+}
+
+static void handle_chain_pull_event(const Event* event) {
+    log_message("[CHAIN TASK] Emergency brake applied (event %lu)", event->sequence);
+}
+
+// Supply changes posted while one is queued coalesce into it, so a
+// burst of them is a single rebalance to the latest level
+static void handle_power_event(const Event* event) {
+    (void)event;
+    power_rebalance();
+}
+
+// Fire Emergency Task (Priority 10)
+bool fire_emergency_step(Task* self) {
+    return drain_events(self, EVENT_KIND_FIRE, handle_fire_event);
 }
 
 // Passenger Emergency Task (Priority 9)
-void* passenger_emergency_task(void* arg) {
-    Task* self = (Task*)arg;
-    log_message("Passenger Emergency Task started");
-    
-    while (g_system.system_running && self->is_active) {
-        pthread_mutex_lock(&g_system.system_mutex);
-        
-        if (g_system.emergency_active) {
-            self->state = TASK_RUNNING;
-            pthread_mutex_unlock(&g_system.system_mutex);
-            
-            log_message("[EMERGENCY TASK] Handling passenger emergency");
-            scheduler_task_complete(self->id);
-            
-            sleep(1);
-        } else {
-            self->state = TASK_READY;
-            pthread_cond_wait(&g_system.task_ready_cond, &g_system.system_mutex);
-            pthread_mutex_unlock(&g_system.system_mutex);
-        }
-    }
-    
-    log_message("Passenger Emergency Task stopped");
-    return NULL;
+bool passenger_emergency_step(Task* self) {
+    return drain_events(self, EVENT_KIND_EMERGENCY, handle_emergency_event);
 }
 
 // Chain Pull Task (Priority 8)
-void* chain_pull_task(void* arg) {
-    Task* self = (Task*)arg;
-    log_message("Chain Pull Task started");
-    
-    while (g_system.system_running && self->is_active) {
-        self->state = TASK_READY;
-        sleep(2);
-        scheduler_task_complete(self->id);
-    }
-    
-    log_message("Chain Pull Task stopped");
-    return NULL;
+bool chain_pull_step(Task* self) {
+    return drain_events(self, EVENT_KIND_CHAIN_PULL, handle_chain_pull_event);
 }
 
 // Power Management Task (Priority 7)
-void* power_management_task(void* arg) {
-    Task* self = (Task*)arg;
-    log_message("Power Management Task started");
-    
-    while (g_system.system_running && self->is_active) {
-        pthread_mutex_lock(&g_system.system_mutex);
-        
-        if (g_system.power_low) {
-            self->state = TASK_RUNNING;
-            pthread_mutex_unlock(&g_system.system_mutex);
-            
-            log_message("[POWER TASK] Managing low power state");
-            scheduler_task_complete(self->id);
-            
-            sleep(2);
-        } else {
-            self->state = TASK_READY;
-            pthread_mutex_unlock(&g_system.system_mutex);
-            sleep(3);
-            scheduler_task_complete(self->id);
-        }
-    }
-    
-    log_message("Power Management Task stopped");
-    return NULL;
+bool power_management_step(Task* self) {
+    return drain_events(self, EVENT_KIND_POWER_LOW, handle_power_event);
 }
 
 // Temperature Regulation Task (Priority 4)
-void* temperature_regulation_task(void* arg) {
-    Task* self = (Task*)arg;
-    log_message("Temperature Regulation Task started");
+bool temperature_regulation_step(Task* self) {
+    // With --shards every shard steps its own cabins
+    if (shards_enabled()) {
+        shards_thermal_tick();
+        scheduler_task_complete(self->id);
+        return false;
+    }
     
-    while (g_system.system_running && self->is_active) {
-        self->state = TASK_RUNNING;
+    // One fixed-rate control step for every cabin, 64 cabins per lock
+    // hold; nothing sleeps under a lock. The step cost excludes time
+    // spent preempted.
+    CabinStore* cabins = &g_system.cabins;
+    uint64_t step_ns = 0;
+    for (int w = 0; w < cabins->num_words; w++) {
+        uint64_t start_ns = monotonic_now_ns();
+        cabin_lock(cabins, w * CABINS_PER_WORD);
+        int settled = thermal_step_word(cabins, w, THERMAL_DT);
+        cabin_unlock(cabins, w * CABINS_PER_WORD);
+        step_ns += monotonic_now_ns() - start_ns;
         
-        // Check and regulate temperature
-        for (int i = 0; i < NUM_CABINS; i++) {
-            pthread_mutex_lock(&g_system.cabins[i].mutex);
-            
-            if (g_system.cabins[i].state == STATE_TEMP_ADJUST) {
-                // Simulate temperature adjustment
-                sleep(1);
-            }
-            
-            pthread_mutex_unlock(&g_system.cabins[i].mutex);
+        if (settled > 0) {
+            log_message("Temperature settled in %d cabins", settled);
         }
         
-        self->state = TASK_READY;
-        sleep(5);
-        scheduler_task_complete(self->id);
+        // Let emergency work in between words
+        scheduler_preempt_point(self);
     }
+    metrics_record(METRIC_THERMAL_STEP, step_ns);
     
-    log_message("Temperature Regulation Task stopped");
-    return NULL;
+    scheduler_task_complete(self->id);
+    return false;
 }
 
 // Lighting Control Task (Priority 3)
-void* lighting_control_task(void* arg) {
-    Task* self = (Task*)arg;
-    log_message("Lighting Control Task started");
-    
-    while (g_system.system_running && self->is_active) {
-        self->state = TASK_RUNNING;
-        
-        // Monitor lighting states
-        scheduler_task_complete(self->id);
-        
-        self->state = TASK_READY;
-        sleep(3);
-    }
-    
-    log_message("Lighting Control Task stopped");
-    return NULL;
+bool lighting_control_step(Task* self) {
+    // Monitor lighting states
+    scheduler_task_complete(self->id);
+    return false;
 }
 
 // Display Task (Priority 2)
-void* display_task(void* arg) {
-    Task* self = (Task*)arg;
-    log_message("Display Task started");
-    
-    while (g_system.system_running && self->is_active) {
-        self->state = TASK_RUNNING;
-        
-        // Update display
-        display_terminal_update();
-        scheduler_task_complete(self->id);
-        
-        self->state = TASK_READY;
-        sleep(2);
-    }
-    
-    log_message("Display Task stopped");
-    return NULL;
+bool display_step(Task* self) {
+    display_update();
+    scheduler_task_complete(self->id);
+    return false;
 }
 
 // Logging Task (Priority 1)
-void* logging_task(void* arg) {
-    Task* self = (Task*)arg;
-    log_message("Logging Task started");
-    
-    while (g_system.system_running && self->is_active) {
-        self->state = TASK_RUNNING;
-        
-        // Periodic logging
-        scheduler_task_complete(self->id);
-        
-        self->state = TASK_READY;
-        sleep(10);
+bool logging_step(Task* self) {
+    // Format and print everything queued by log_message()
+    log_ring_drain(stdout);
+    scheduler_task_complete(self->id);
+    return false;
+}
+
+// State Export Task (Priority 5): only registered with --shm
+bool state_export_step(Task* self) {
+    shm_export_publish();
+    scheduler_task_complete(self->id);
+    return false;
+}
+
+// Apply a cabin update under the cabin's stripe, or post it to its shard
+static void update_cabin(int cabin_id, CabinOp op, int value) {
+    if (shards_enabled()) {
+        shards_post(cabin_id, op, value);
+        return;
     }
     
-    log_message("Logging Task stopped");
-    return NULL;
+    cabin_lock(&g_system.cabins, cabin_id);
+    cabin_apply(&g_system.cabins, cabin_id, op, value);
+    cabin_unlock(&g_system.cabins, cabin_id);
+}
+
+// Sensor Alarm Task (Priority 6): only registered with --sensors
+bool sensor_alarm_step(Task* self) {
+    sensors_evaluate(self);
+    scheduler_task_complete(self->id);
+    return false;
+}
+
+// Peer Publish Task (Priority 5): only registered with --peer
+bool peer_publish_step(Task* self) {
+    peer_publish_tick();
+    scheduler_task_complete(self->id);
+    return false;
 }
 
 // Helper: Handle fire alert
 void handle_fire_alert(int cabin_id) {
     log_message("FIRE ALERT in Cabin %d!", cabin_id);
     
-    pthread_mutex_lock(&g_system.system_mutex);
-    g_system.fire_active = true;
-    pthread_mutex_unlock(&g_system.system_mutex);
-    
-    pthread_mutex_lock(&g_system.cabins[cabin_id].mutex);
-    g_system.cabins[cabin_id].state = STATE_FIRE;
-    g_system.cabins[cabin_id].light_on = false; // Cut power
-    pthread_mutex_unlock(&g_system.cabins[cabin_id].mutex);
+    update_cabin(cabin_id, CABIN_OP_FIRE, 0);
     
     // Trigger high-priority task
+    event_post(EVENT_KIND_FIRE, cabin_id);
     scheduler_preempt(PRIORITY_FIRE_EMERGENCY);
-    pthread_cond_broadcast(&g_system.task_ready_cond);
+    scheduler_notify(EVENT_FIRE);
     
     display_status_message("FIRE EMERGENCY!");
 }
@@ -210,16 +189,11 @@ void handle_fire_alert(int cabin_id) {
 void handle_emergency(int cabin_id) {
     log_message("EMERGENCY in Cabin %d!", cabin_id);
     
-    pthread_mutex_lock(&g_system.system_mutex);
-    g_system.emergency_active = true;
-    pthread_mutex_unlock(&g_system.system_mutex);
-    
-    pthread_mutex_lock(&g_system.cabins[cabin_id].mutex);
-    g_system.cabins[cabin_id].state = STATE_EMERGENCY;
-    pthread_mutex_unlock(&g_system.cabins[cabin_id].mutex);
+    update_cabin(cabin_id, CABIN_OP_EMERGENCY, 0);
     
+    event_post(EVENT_KIND_EMERGENCY, cabin_id);
     scheduler_preempt(PRIORITY_PASSENGER_EMERGENCY);
-    pthread_cond_broadcast(&g_system.task_ready_cond);
+    scheduler_notify(EVENT_EMERGENCY);
     
     display_status_message("PASSENGER EMERGENCY!");
 }
@@ -228,66 +202,35 @@ void handle_emergency(int cabin_id) {
 void handle_chain_pull() {
     log_message("CHAIN PULLED - Emergency stop!");
     
-    pthread_mutex_lock(&g_system.system_mutex);
-    g_system.emergency_active = true;
-    pthread_mutex_unlock(&g_system.system_mutex);
+    state_write_begin();
+    g_system.chain_pulled = true;
+    state_write_end();
     
+    event_post(EVENT_KIND_CHAIN_PULL, EVENT_NO_CABIN);
     scheduler_preempt(PRIORITY_CHAIN_PULL);
-    pthread_cond_broadcast(&g_system.task_ready_cond);
+    scheduler_notify(EVENT_CHAIN_PULL);
     
     display_status_message("CHAIN PULLED!");
 }
 
-// Helper: Handle low power
-void handle_power_low() {
-    log_message("LOW POWER condition detected");
-    
-    pthread_mutex_lock(&g_system.system_mutex);
-    g_system.power_low = true;
-    pthread_mutex_unlock(&g_system.system_mutex);
-    
-    // Turn off lights in non-critical cabins
-    for (int i = 0; i < NUM_CABINS; i++) {
-        pthread_mutex_lock(&g_system.cabins[i].mutex);
-        
-        if (g_system.cabins[i].state == STATE_NORMAL || 
-            g_system.cabins[i].state == STATE_LIGHT_ON) {
-            g_system.cabins[i].light_on = false;
-            log_message("Power saving: Light OFF in Cabin %d", i);
-        }
-        
-        pthread_mutex_unlock(&g_system.cabins[i].mutex);
-    }
-    
-    display_status_message("LOW POWER MODE");
+// Helper: Handle a supply level change (percent of the full load, see
+// power.h). Loads are shed or restored by the power management task,
+// which logs the outcome; repeating the current level does nothing.
+void handle_power_level(int percent) {
+    if (!power_set_supply(percent)) return;
+    
+    event_post(EVENT_KIND_POWER_LOW, EVENT_NO_CABIN);
+    scheduler_notify(EVENT_POWER_LOW);
 }
 
 // Helper: Adjust temperature
 void adjust_temperature(int cabin_id, int target_temp) {
     log_message("Adjusting temperature in Cabin %d to %d°C", cabin_id, target_temp);
-    
-    pthread_mutex_lock(&g_system.cabins[cabin_id].mutex);
-    
-    g_system.cabins[cabin_id].temperature = target_temp;
-    if (g_system.cabins[cabin_id].state == STATE_NORMAL) {
-        g_system.cabins[cabin_id].state = STATE_TEMP_ADJUST;
-    }
-    
-    pthread_mutex_unlock(&g_system.cabins[cabin_id].mutex);
+    update_cabin(cabin_id, CABIN_OP_TEMP, target_temp);
 }
 
 // Helper: Control light
 void control_light(int cabin_id, bool on) {
     log_message("Light %s in Cabin %d", on ? "ON" : "OFF", cabin_id);
-    
-    pthread_mutex_lock(&g_system.cabins[cabin_id].mutex);
-    
-    g_system.cabins[cabin_id].light_on = on;
-    if (on && g_system.cabins[cabin_id].state == STATE_NORMAL) {
-        g_system.cabins[cabin_id].state = STATE_LIGHT_ON;
-    } else if (!on && g_system.cabins[cabin_id].state == STATE_LIGHT_ON) {
-        g_system.cabins[cabin_id].state = STATE_NORMAL;
-    }
-    
-    pthread_mutex_unlock(&g_system.cabins[cabin_id].mutex);
+    update_cabin(cabin_id, CABIN_OP_LIGHT, on);
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "thermal.h"
+#include "cabins.h"
+#include "state.h"
+
+// Advance the controller and plant of one word of cabins by dt seconds,
+// writing each cabin's rounded temperature and whether it has settled.
+// Branch-free over a whole word (the arrays are padded) so the compiler
+// can vectorize it. Derivative acts on the measurement (no kick on
+// setpoint changes); the integral only accumulates while the output is
+// not saturated. A cabin whose HVAC is shed has no output and drifts
+// towards the outside temperature, its integral held.
+static void step_cabins(const int16_t* restrict setpoint, const uint8_t* restrict hvac_on,
+                        float* restrict current, float* restrict rate, float* restrict integral,
+                        float dt, int16_t* restrict shown, uint8_t* restrict settled) {
+    for (int k = 0; k < CABINS_PER_WORD; k++) {
+        float t = current[k];
+        float error = setpoint[k] - t;
+        float i = integral[k] + error * dt;
+        float u = THERMAL_KP * error + THERMAL_KI * i - THERMAL_KD * rate[k];
+        float out = u > THERMAL_MAX_RATE ? THERMAL_MAX_RATE : u < -THERMAL_MAX_RATE ? -THERMAL_MAX_RATE : u;
+        out = hvac_on[k] ? out : 0.0f;
+        float dtdt = out - THERMAL_LOSS * (t - THERMAL_AMBIENT);
+        
+        integral[k] = u == out ? i : integral[k];
+        rate[k] = dtdt;
+        t += dtdt * dt;
+        current[k] = t;
+        shown[k] = (int16_t)(t >= 0.0f ? t + 0.5f : t - 0.5f);
+        settled[k] = (fabsf(error) < THERMAL_TOLERANCE) & (fabsf(dtdt) < THERMAL_SETTLED_RATE);
+    }
+}
+
+// One control step for a 64-cabin word. Cabins adjusting temperature
+// that have settled on their setpoint go back to normal (or lights-on).
+// Published temperatures and states only change, inside one seqlock
+// section, when something visible moved. The caller holds the word's
+// stripe. Returns the number of cabins settled.
+int thermal_step_word(CabinStore* store, int word, float dt) {
+    int base = word * CABINS_PER_WORD;
+    int n = store->count - base < CABINS_PER_WORD ? store->count - base : CABINS_PER_WORD;
+    int16_t shown[CABINS_PER_WORD];
+    uint8_t settled[CABINS_PER_WORD];
+    
+    step_cabins(store->setpoint + base, store->hvac_on + base, store->temp_current + base,
+                store->temp_rate + base, store->temp_integral + base, dt, shown, settled);
+    
+    uint64_t done = 0;
+    for (int k = 0; k < n; k++) {
+        done |= (uint64_t)settled[k] << k;
+    }
+    done &= cabins_state_mask(store, word, STATE_TEMP_ADJUST);
+    
+    if (!done && memcmp(shown, store->temperature + base, n * sizeof(int16_t)) == 0) return 0;
+    
+    state_cabin_write_begin(base);
+    memcpy(store->temperature + base, shown, n * sizeof(int16_t));
+    for (uint64_t m = done; m; m &= m - 1) {
+        int i = base + __builtin_ctzll(m);
+        store->state[i] = cabin_light_on(store, i) ? STATE_LIGHT_ON : STATE_NORMAL;
+    }
+    state_cabin_write_end(base);
+    
+    return __builtin_popcountll(done);
+}
+
+// One control step for every cabin, a word at a time (used by the
+// benchmark; the regulation task adds preemption points in between)
+int thermal_step_all(CabinStore* store, float dt) {
+    int settled = 0;
+    
+    for (int w = 0; w < store->num_words; w++) {
+        cabin_lock(store, w * CABINS_PER_WORD);
+        settled += thermal_step_word(store, w, dt);
+        cabin_unlock(store, w * CABINS_PER_WORD);
+    }
+    
+    return settled;
+}
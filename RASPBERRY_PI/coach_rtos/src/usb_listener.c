@@ -0,0 +1,345 @@
+#include "usb_listener.h"
+#include "commands.h"
+#include "metrics.h"
+#include "journal.h"
+#include "locks.h"
+#include "rt.h"
+#include "shutdown.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+
+// Saved terminal/file state, restored by usb_listener_close()
+static struct termios saved_termios;
+static bool termios_saved = false;
+static int saved_stdin_flags = -1;
+
+// CRC-8 (polynomial 0x07) lookup table
+static const uint8_t crc8_table[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31,
+    0x24, 0x23, 0x2A, 0x2D, 0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65,
+    0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D, 0xE0, 0xE7, 0xEE, 0xE9,
+    0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1,
+    0xB4, 0xB3, 0xBA, 0xBD, 0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2,
+    0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA, 0xB7, 0xB0, 0xB9, 0xBE,
+    0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16,
+    0x03, 0x04, 0x0D, 0x0A, 0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42,
+    0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A, 0x89, 0x8E, 0x87, 0x80,
+    0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8,
+    0xDD, 0xDA, 0xD3, 0xD4, 0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C,
+    0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44, 0x19, 0x1E, 0x17, 0x10,
+    0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F,
+    0x6A, 0x6D, 0x64, 0x63, 0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B,
+    0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13, 0xAE, 0xA9, 0xA0, 0xA7,
+    0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF,
+    0xFA, 0xFD, 0xF4, 0xF3,
+};
+
+// Listener ingestion state (one input stream per process)
+static IngestState listener_ingest;
+
+// Reset ingestion state and install its handlers
+void ingest_init(IngestState* st, IngestLineHandler on_line, IngestFrameHandler on_frame, void* ctx) {
+    st->used = 0;
+    st->discarding = false;
+    st->on_line = on_line;
+    st->on_frame = on_frame;
+    st->ctx = ctx;
+    st->read_ns = 0;
+    st->bytes = 0;
+    st->lines = 0;
+    st->frames = 0;
+    st->frame_errors = 0;
+    st->overflows = 0;
+}
+
+// CRC-8, polynomial 0x07
+uint8_t frame_crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    
+    for (size_t i = 0; i < len; i++) {
+        crc = crc8_table[crc ^ data[i]];
+    }
+    
+    return crc;
+}
+
+// Wrap a payload in a frame; returns the frame size
+size_t frame_encode(const uint8_t* payload, size_t len, uint8_t* out) {
+    out[0] = FRAME_SYNC;
+    out[1] = (uint8_t)len;
+    memcpy(out + 2, payload, len);
+    out[2 + len] = frame_crc8(out + 1, len + 1);
+    return len + FRAME_OVERHEAD;
+}
+
+// Try to consume one binary frame at start. Returns bytes consumed, or 0
+// if the frame is still incomplete.
+static size_t ingest_frame(IngestState* st, const uint8_t* start, size_t avail) {
+    if (avail < 2) return 0;
+    
+    size_t len = start[1];
+    if (len == 0 || len > FRAME_MAX_PAYLOAD) {
+        // Not a plausible frame: skip the sync byte and resynchronize
+        st->frame_errors++;
+        return 1;
+    }
+    if (avail < len + FRAME_OVERHEAD) return 0;
+    
+    if (frame_crc8(start + 1, len + 1) != start[2 + len]) {
+        st->frame_errors++;
+        return 1;
+    }
+    
+    st->frames++;
+    st->on_frame(start + 2, len, st->ctx);
+    return len + FRAME_OVERHEAD;
+}
+
+// Hand every complete line or frame in the buffer to its handler. Lines
+// are NUL-terminated in place; only the trailing partial record is moved,
+// once per read.
+static void ingest_parse(IngestState* st, size_t fresh_from) {
+    char* start = st->buffer;
+    char* end = st->buffer + st->used;
+    char* scan = st->buffer + fresh_from;
+    
+    while (start < end) {
+        if (!st->discarding && st->on_frame && (uint8_t)*start == FRAME_SYNC) {
+            size_t consumed = ingest_frame(st, (const uint8_t*)start, end - start);
+            if (consumed == 0) break;
+            start += consumed;
+            scan = start;
+            continue;
+        }
+        
+        if (scan < start) scan = start;
+        char* newline = memchr(scan, '\n', end - scan);
+        if (!newline) break;
+        
+        if (st->discarding) {
+            // Tail of an over-long line
+            st->discarding = false;
+        } else {
+            char* line_end = newline;
+            if (line_end > start && line_end[-1] == '\r') line_end--;
+            *line_end = '\0';
+            
+            size_t len = line_end - start;
+            if (len > 0) {
+                st->lines++;
+                st->on_line(start, len, st->ctx);
+            }
+        }
+        
+        start = newline + 1;
+        scan = start;
+    }
+    
+    size_t rest = end - start;
+    if (rest > 0 && start != st->buffer) {
+        memmove(st->buffer, start, rest);
+    }
+    st->used = rest;
+    
+    // A line that fills the whole buffer can never complete; drop it
+    if (st->used == INGEST_BUFFER_SIZE) {
+        st->overflows++;
+        st->discarding = true;
+        st->used = 0;
+    }
+}
+
+// Read everything currently available on a non-blocking fd and dispatch
+// complete records. Returns bytes read, 0 on end of input, or -1 with
+// errno set (EAGAIN if nothing was available).
+ssize_t ingest_read(IngestState* st, int fd) {
+    ssize_t total = 0;
+    
+    for (;;) {
+        ssize_t n = read(fd, st->buffer + st->used, INGEST_BUFFER_SIZE - st->used);
+        
+        if (n > 0) {
+            size_t fresh_from = st->used;
+            st->read_ns = monotonic_now_ns();
+            st->used += n;
+            st->bytes += n;
+            total += n;
+            ingest_parse(st, fresh_from);
+        } else if (n == 0) {
+            return total;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            return total > 0 ? total : -1;
+        }
+    }
+}
+
+// Put a serial tty into raw 8N1 mode at SERIAL_BAUDRATE
+static int configure_serial(int fd) {
+    struct termios tio;
+    
+    if (tcgetattr(fd, &tio) != 0) return -1;
+    saved_termios = tio;
+    termios_saved = true;
+    
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, SERIAL_BAUDRATE);
+    cfsetospeed(&tio, SERIAL_BAUDRATE);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) return -1;
+    tcflush(fd, TCIFLUSH);
+    
+    return 0;
+}
+
+// Open the command input: a serial device in raw mode, or stdin when
+// device is NULL. The returned fd is non-blocking.
+int usb_listener_open(const char* device) {
+    if (!device) {
+        saved_stdin_flags = fcntl(STDIN_FILENO, F_GETFL);
+        if (saved_stdin_flags < 0 ||
+            fcntl(STDIN_FILENO, F_SETFL, saved_stdin_flags | O_NONBLOCK) < 0) {
+            log_message("Error: Cannot make stdin non-blocking");
+            return -1;
+        }
+        return STDIN_FILENO;
+    }
+    
+    int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        log_message("Error: Cannot open %s: %s", device, strerror(errno));
+        return -1;
+    }
+    
+    if (isatty(fd) && configure_serial(fd) != 0) {
+        log_message("Error: Cannot configure %s as raw serial", device);
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+// Restore and close the command input
+void usb_listener_close(int fd) {
+    if (fd < 0) return;
+    
+    if (fd == STDIN_FILENO) {
+        if (saved_stdin_flags >= 0) {
+            fcntl(STDIN_FILENO, F_SETFL, saved_stdin_flags);
+            saved_stdin_flags = -1;
+        }
+        return;
+    }
+    
+    if (termios_saved) {
+        tcsetattr(fd, TCSANOW, &saved_termios);
+        termios_saved = false;
+    }
+    close(fd);
+}
+
+// Execute a validated command: latency since its bytes were read, the
+// record journal, then the handler
+static void dispatch_command(IngestState* st, const Command* cmd) {
+    metrics_record(METRIC_COMMAND_DISPATCH, monotonic_now_ns() - st->read_ns);
+    journal_record(cmd);
+    command_execute(cmd);
+}
+
+// Parse and execute one text command line
+static void on_command_line(char* line, size_t len, void* ctx) {
+    IngestState* st = (IngestState*)ctx;
+    Command cmd;
+    const char* error;
+    
+    log_message("Received command: %s", line);
+    
+    if (command_parse_text(line, len, &cmd, &error) != 0) {
+        log_message("Rejected command: %s (%s)", line, error);
+        return;
+    }
+    
+    dispatch_command(st, &cmd);
+}
+
+// Decode and execute one binary command frame
+static void on_command_frame(const uint8_t* payload, size_t len, void* ctx) {
+    IngestState* st = (IngestState*)ctx;
+    Command cmd;
+    const char* error;
+    
+    if (command_decode_binary(payload, len, &cmd, &error) != 0) {
+        log_message("Rejected binary command (%s)", error);
+        return;
+    }
+    
+    log_message("Received binary command: %s cabin %d value %d",
+                command_name(cmd.opcode), cmd.cabin, cmd.value);
+    
+    dispatch_command(st, &cmd);
+}
+
+// USB listener thread (serial device or stdin)
+void* usb_listener_thread(void* arg) {
+    const char* device = (const char*)arg;
+    
+    lock_thread_set("USB Listener", 0);
+    rt_thread_start("USB Listener");
+    ingest_init(&listener_ingest, on_command_line, on_command_frame, &listener_ingest);
+    int fd = usb_listener_open(device);
+    if (fd < 0) {
+        log_message("USB listener failed to start");
+        rt_thread_stop();
+        return NULL;
+    }
+    
+    log_message("USB listener started on %s", device ? device : "stdin");
+    uint64_t start_ns = monotonic_now_ns();
+    
+    // Input and the shutdown latch; a closed input leaves only the latch
+    struct pollfd pfds[2] = {
+        { .fd = shutdown_fd(), .events = POLLIN },
+        { .fd = fd, .events = POLLIN },
+    };
+    
+    while (g_system.system_running) {
+        int ready = poll(pfds, fd >= 0 ? 2 : 1, -1);
+        
+        if (ready < 0 && errno != EINTR) {
+            log_message("Error: USB listener poll failed: %s", strerror(errno));
+            break;
+        }
+        if (ready <= 0) continue;
+        if (pfds[0].revents) break;
+        
+        ssize_t n = ingest_read(&listener_ingest, fd);
+        journal_flush();
+        if (n == 0 || (n < 0 && errno != EAGAIN)) {
+            log_message("USB listener input closed");
+            usb_listener_close(fd);
+            fd = -1;
+        }
+    }
+    
+    usb_listener_close(fd);
+    
+    double elapsed_s = (monotonic_now_ns() - start_ns) / 1e9;
+    log_message("USB listener stopped: %lu lines, %lu frames, %lu bytes, %lu frame errors, "
+                "%lu over-long lines in %.1f s",
+                listener_ingest.lines, listener_ingest.frames, listener_ingest.bytes,
+                listener_ingest.frame_errors, listener_ingest.overflows, elapsed_s);
+    rt_thread_stop();
+    return NULL;
+}
@@ -0,0 +1,123 @@
+// Example shared-memory consumer: follows a running coach_rtos started
+// with --shm and prints a one-line summary per interval, or measures how
+// fast the export can be read (--bench)
+#include "coach_shm.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char* cabin_state_names[] = { "normal", "light", "temp", "EMERGENCY", "FIRE" };
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void print_summary(const CoachShmHeader* header, const CoachShmCabin* cabins, int count) {
+    int lights = 0;
+    int adjusting = 0;
+    
+    for (int i = 0; i < count; i++) {
+        lights += cabins[i].light_on;
+        adjusting += (cabins[i].state == 2);
+    }
+    
+    printf("#%lu age %.1f ms | fire %d emergency %d chain %s power %s | lights %d/%d adjusting %d",
+           header->publish_count, (now_ns() - header->publish_ns) / 1e6,
+           header->fire_cabins, header->emergency_cabins,
+           header->chain_pulled ? "PULLED" : "ok", header->power_low ? "LOW" : "ok",
+           lights, count, adjusting);
+    
+    // Name the first few cabins in an alarm state
+    int shown = 0;
+    for (int i = 0; i < count && shown < 4; i++) {
+        if (cabins[i].state >= 3) {
+            printf("%s cabin %d %s", shown ? "," : " |", i, cabin_state_names[cabins[i].state]);
+            shown++;
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+// Read back to back for `seconds` and report the rate
+static int run_bench(const CoachShmReader* reader, CoachShmHeader* header,
+                     CoachShmCabin* cabins, double seconds) {
+    uint64_t reads = 0;
+    uint64_t failures = 0;
+    uint64_t first_publish = 0;
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)(seconds * 1e9);
+    
+    while (now_ns() < end) {
+        if (coach_shm_read(reader, header, cabins, reader->num_cabins) < 0) {
+            failures++;
+            continue;
+        }
+        if (reads++ == 0) first_publish = header->publish_count;
+    }
+    
+    double elapsed = (now_ns() - start) / 1e9;
+    printf("%lu consistent reads of %u cabins in %.2f s: %.0f reads/s, %.2f us/read, "
+           "%lu gave up, %lu publishes seen\n",
+           reads, reader->num_cabins, elapsed, reads / elapsed, elapsed * 1e6 / (reads ? reads : 1),
+           failures, reads ? header->publish_count - first_publish : 0);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    const char* name = COACH_SHM_DEFAULT_NAME;
+    int interval_ms = 1000;
+    double bench_seconds = 0.0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_seconds = atof(argv[++i]);
+        } else {
+            printf("Usage: %s [--name NAME] [--interval MS] [--bench SECONDS]\n", argv[0]);
+            printf("  --name NAME      Segment passed to coach_rtos --shm (default %s)\n",
+                   COACH_SHM_DEFAULT_NAME);
+            printf("  --interval MS    Time between summaries (default 1000)\n");
+            printf("  --bench SECONDS  Read as fast as possible and report the rate\n");
+            return 1;
+        }
+    }
+    
+    CoachShmReader reader;
+    if (coach_shm_open(&reader, name) != 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+    
+    CoachShmHeader header;
+    CoachShmCabin* cabins = calloc(reader.num_cabins ? reader.num_cabins : 1, sizeof(CoachShmCabin));
+    if (!cabins) return 1;
+    
+    int status = 0;
+    if (bench_seconds > 0.0) {
+        status = run_bench(&reader, &header, cabins, bench_seconds);
+    } else {
+        for (;;) {
+            int count = coach_shm_read(&reader, &header, cabins, reader.num_cabins);
+            if (count < 0) {
+                fprintf(stderr, "Read kept overlapping a publish\n");
+            } else if (header.publish_count > 0) {
+                print_summary(&header, cabins, count);
+                if (!header.system_running) break;
+            }
+            usleep(interval_ms * 1000);
+        }
+    }
+    
+    free(cabins);
+    coach_shm_close(&reader);
+    return status;
+}
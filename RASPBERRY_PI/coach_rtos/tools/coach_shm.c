@@ -0,0 +1,72 @@
+#include "coach_shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int coach_shm_open(CoachShmReader* reader, const char* name) {
+    struct stat st;
+    
+    memset(reader, 0, sizeof(*reader));
+    
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CoachShmHeader)) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    
+    const CoachShmHeader* header = (const CoachShmHeader*)map;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != COACH_SHM_MAGIC ||
+        header->version != COACH_SHM_VERSION ||
+        header->header_size + (size_t)header->num_cabins * sizeof(CoachShmCabin) > (size_t)st.st_size) {
+        munmap(map, st.st_size);
+        errno = EPROTO;
+        return -1;
+    }
+    
+    reader->header = header;
+    reader->cabins = (const CoachShmCabin*)((const uint8_t*)map + header->header_size);
+    reader->size = st.st_size;
+    reader->num_cabins = header->num_cabins;
+    return 0;
+}
+
+int coach_shm_read(const CoachShmReader* reader, CoachShmHeader* header,
+                   CoachShmCabin* cabins, uint32_t max_cabins) {
+    uint32_t count = max_cabins < reader->num_cabins ? max_cabins : reader->num_cabins;
+    
+    for (int attempt = 0; attempt < COACH_SHM_READ_RETRIES; attempt++) {
+        uint32_t seq = __atomic_load_n(&reader->header->sequence, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        
+        memcpy(header, reader->header, sizeof(*header));
+        memcpy(cabins, reader->cabins, count * sizeof(CoachShmCabin));
+        
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&reader->header->sequence, __ATOMIC_RELAXED) == seq) {
+            return (int)count;
+        }
+    }
+    
+    errno = EAGAIN;
+    return -1;
+}
+
+void coach_shm_close(CoachShmReader* reader) {
+    if (reader->header) {
+        munmap((void*)reader->header, reader->size);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
@@ -0,0 +1,40 @@
+#ifndef COACH_SHM_H
+#define COACH_SHM_H
+
+// Reader library for the coach_rtos shared-memory state export. Readers
+// never block the publisher or each other: a read copies the segment and
+// retries if the publisher was writing meanwhile.
+//
+//     CoachShmReader reader;
+//     if (coach_shm_open(&reader, COACH_SHM_DEFAULT_NAME) == 0) {
+//         CoachShmCabin* cabins = calloc(reader.num_cabins, sizeof(CoachShmCabin));
+//         CoachShmHeader header;
+//         if (coach_shm_read(&reader, &header, cabins, reader.num_cabins) >= 0) ...
+//         coach_shm_close(&reader);
+//     }
+
+#include "shm_layout.h"
+#include <stddef.h>
+
+#define COACH_SHM_READ_RETRIES 1000  // Attempts before a read gives up
+
+typedef struct {
+    const CoachShmHeader* header;
+    const CoachShmCabin* cabins;
+    size_t size;
+    uint32_t num_cabins;
+} CoachShmReader;
+
+// Map the segment read-only and check its magic and version. Returns 0,
+// or -1 with errno set (ENOENT: not published, EPROTO: wrong layout).
+int coach_shm_open(CoachShmReader* reader, const char* name);
+
+// Copy a consistent header and up to max_cabins cabins. Returns the
+// number of cabins copied, or -1 (errno EAGAIN) if every retry overlapped
+// a publish.
+int coach_shm_read(const CoachShmReader* reader, CoachShmHeader* header,
+                   CoachShmCabin* cabins, uint32_t max_cabins);
+
+void coach_shm_close(CoachShmReader* reader);
+
+#endif // COACH_SHM_H
@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""
+RTOS Coach System - Load Generator
+Drives coach_rtos through a pipe at fixed command rates and reports
+throughput, latency percentiles, CPU usage and memory as JSON, once per
+execution mode (thread per task, executor worker pool)
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import threading
+import time
+from typing import Dict, List, Optional
+
+DEFAULT_MIX = 'LIGHT=50,TEMP=20,FIRE=5,EMERGENCY=5,POWER=20'
+DEFAULT_RATES = '10,100,1000,10000,max'
+MODE_ARGS = {'threads': [], 'executor': ['--executor']}
+CLOCK_TICKS = os.sysconf('SC_CLK_TCK')
+
+def parse_mix(text: str) -> Dict[str, int]:
+    """Parse 'LIGHT=50,FIRE=5' into command weights"""
+    mix = {}
+    for item in text.split(','):
+        name, _, weight = item.partition('=')
+        name = name.strip().upper()
+        if name not in ('LIGHT', 'TEMP', 'FIRE', 'EMERGENCY', 'POWER'):
+            raise ValueError(f"unknown command in mix: {name}")
+        mix[name] = int(weight or 1)
+    return mix
+
+def parse_rates(text: str) -> List[Optional[int]]:
+    """Parse '10,100,max' into rates; None means as fast as possible"""
+    return [None if r.strip() == 'max' else int(r) for r in text.split(',')]
+
+class CommandMix:
+    def __init__(self, mix: Dict[str, int], num_cabins: int, seed: int):
+        """Weighted random command source"""
+        self.names = list(mix.keys())
+        self.weights = list(mix.values())
+        self.num_cabins = num_cabins
+        self.random = random.Random(seed)
+    
+    def next_command(self) -> str:
+        """One command line of the configured mix"""
+        name = self.random.choices(self.names, self.weights)[0]
+        cabin = self.random.randrange(self.num_cabins)
+        if name == 'LIGHT':
+            return f"LIGHT {cabin} {self.random.choice(['ON', 'OFF'])}"
+        if name == 'TEMP':
+            return f"TEMP {cabin} {self.random.randint(18, 28)}"
+        if name == 'POWER':
+            # Brown-out flapping: LOW, back to OK, or a partial supply
+            level = self.random.choice(['LOW', 'OK', str(self.random.randint(50, 99))])
+            return f"POWER {level}"
+        return f"{name} {cabin}"
+
+class CoachProcess:
+    def __init__(self, binary: str, num_cabins: int, extra_args: List[str]):
+        """Start coach_rtos with commands on a pipe and watch its output"""
+        self.proc = subprocess.Popen(
+            [binary, '--cabins', str(num_cabins)] + extra_args,
+            stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        self.metrics = []
+        self.metrics_ready = threading.Condition()
+        self.reader = threading.Thread(target=self._read_output, daemon=True)
+        self.reader.start()
+    
+    def _read_output(self):
+        """Keep draining stdout so the system never blocks on it"""
+        for raw in self.proc.stdout:
+            if raw.startswith(b'METRICS {'):
+                with self.metrics_ready:
+                    self.metrics.append(json.loads(raw[8:]))
+                    self.metrics_ready.notify_all()
+    
+    def send(self, lines: List[str]):
+        """Write a batch of command lines"""
+        self.proc.stdin.write(''.join(line + '\n' for line in lines).encode())
+        self.proc.stdin.flush()
+    
+    def query_metrics(self, timeout: float = 10.0) -> Optional[dict]:
+        """Ask for METRICS JSON and wait for the reply"""
+        with self.metrics_ready:
+            expected = len(self.metrics) + 1
+        self.send(['METRICS JSON'])
+        with self.metrics_ready:
+            self.metrics_ready.wait_for(lambda: len(self.metrics) >= expected, timeout)
+            return self.metrics[-1] if len(self.metrics) >= expected else None
+    
+    def cpu_seconds(self) -> float:
+        """User + system CPU time so far"""
+        with open(f'/proc/{self.proc.pid}/stat') as f:
+            fields = f.read().rsplit(')', 1)[1].split()
+        return (int(fields[11]) + int(fields[12])) / CLOCK_TICKS
+    
+    def memory_kb(self) -> Dict[str, int]:
+        """Current and peak resident set size, virtual size and thread count"""
+        fields = {'VmRSS': 'rss_kb', 'VmHWM': 'peak_rss_kb', 'VmSize': 'vm_kb', 'Threads': 'threads'}
+        memory = {}
+        with open(f'/proc/{self.proc.pid}/status') as f:
+            for line in f:
+                key, _, value = line.partition(':')
+                if key in fields:
+                    memory[fields[key]] = int(value.split()[0])
+        return memory
+    
+    def stop(self) -> int:
+        """Close the command pipe and shut the system down"""
+        self.proc.stdin.close()
+        self.proc.send_signal(2)
+        try:
+            return self.proc.wait(timeout=15)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            return self.proc.wait()
+
+def run_stage(coach: CoachProcess, mix: CommandMix, rate: Optional[int], duration: float) -> dict:
+    """Send the mix at one rate for `duration` seconds and measure it"""
+    coach.send(['METRICS RESET'])
+    cpu_start = coach.cpu_seconds()
+    start = time.monotonic()
+    sent = 0
+    
+    # Paced stages send in 10 ms batches; 'max' sends as fast as the pipe takes it
+    batch_interval = 0.01
+    while True:
+        now = time.monotonic()
+        elapsed = now - start
+        if elapsed >= duration:
+            break
+        if rate is None:
+            batch = 256
+        else:
+            batch = int(rate * min(elapsed + batch_interval, duration)) - sent
+        if batch > 0:
+            coach.send([mix.next_command() for _ in range(batch)])
+            sent += batch
+        if rate is not None:
+            time.sleep(max(0.0, start + elapsed + batch_interval - time.monotonic()))
+    
+    metrics = coach.query_metrics()
+    wall = time.monotonic() - start
+    cpu = coach.cpu_seconds() - cpu_start
+    
+    # The METRICS JSON query itself is counted as one dispatched command
+    dispatch = (metrics or {}).get('dispatch', {})
+    processed = max(0, dispatch.get('count', 0) - 1)
+    result = {
+        'rate': rate if rate is not None else 'max',
+        'duration_s': round(wall, 3),
+        'sent': sent,
+        'processed': processed,
+        'throughput_per_s': round(processed / wall, 1),
+        'cpu_percent': round(100.0 * cpu / wall, 1),
+        'dispatch_latency_us': {k: v for k, v in dispatch.items() if k != 'count'},
+        'wakeup_latency_us': (metrics or {}).get('wakeup', {}),
+    }
+    result.update(coach.memory_kb())
+    return result
+
+def main():
+    """Main function"""
+    parser = argparse.ArgumentParser(description='Drive coach_rtos with a command mix through a pipe')
+    parser.add_argument('--binary', default='./bin/coach_rtos', help='coach_rtos executable')
+    parser.add_argument('--mix', default=DEFAULT_MIX, help=f'command weights (default {DEFAULT_MIX})')
+    parser.add_argument('--rates', default=DEFAULT_RATES, help=f'commands/s per stage (default {DEFAULT_RATES})')
+    parser.add_argument('--duration', type=float, default=3.0, help='seconds per stage')
+    parser.add_argument('--cabins', type=int, default=10, help='cabins in the simulated system')
+    parser.add_argument('--seed', type=int, default=1, help='random seed for the command mix')
+    parser.add_argument('--modes', default=','.join(MODE_ARGS),
+                        help=f"execution modes to compare (default {','.join(MODE_ARGS)})")
+    parser.add_argument('--output', help='also write the JSON summary to this file')
+    args = parser.parse_args()
+    
+    try:
+        rates = parse_rates(args.rates)
+        parse_mix(args.mix)
+    except ValueError as e:
+        parser.error(str(e))
+    modes = [m.strip() for m in args.modes.split(',')]
+    for mode in modes:
+        if mode not in MODE_ARGS:
+            parser.error(f"unknown mode: {mode}")
+    
+    results = {}
+    ok = True
+    for mode in modes:
+        # Every mode sees the same command sequence
+        mix = CommandMix(parse_mix(args.mix), args.cabins, args.seed)
+        coach = CoachProcess(args.binary, args.cabins, MODE_ARGS[mode])
+        time.sleep(0.5)  # Let the tasks start
+        
+        stages = []
+        try:
+            for rate in rates:
+                stage = run_stage(coach, mix, rate, args.duration)
+                stages.append(stage)
+                print(f"{mode:>8} rate {stage['rate']:>6}: {stage['throughput_per_s']:>10.1f} cmd/s, "
+                      f"p99 {stage['dispatch_latency_us'].get('p99_us', 0):>9.1f} us, "
+                      f"cpu {stage['cpu_percent']:>5.1f}%, rss {stage.get('rss_kb', 0)} kB, "
+                      f"threads {stage.get('threads', 0)}",
+                      file=sys.stderr)
+        finally:
+            exit_code = coach.stop()
+        
+        results[mode] = {'stages': stages, 'exit_code': exit_code}
+        ok = ok and exit_code == 0 and len(stages) == len(rates)
+    
+    summary = {
+        'binary': args.binary,
+        'mix': parse_mix(args.mix),
+        'cabins': args.cabins,
+        'stage_duration_s': args.duration,
+        'modes': results,
+    }
+    
+    text = json.dumps(summary, indent=2)
+    print(text)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text + '\n')
+    
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()
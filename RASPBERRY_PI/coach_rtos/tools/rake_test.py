@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+RTOS Coach System - Rake Test
+Starts several coach_rtos processes on this host, one of them also
+aggregating (--aggregate) the state every coach publishes (--peer), drives
+each coach with a random command mix, then checks the aggregated rake view
+against what was sent and reports bandwidth, propagation latency and
+staleness
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import threading
+import time
+from typing import Dict, List
+
+from load_generator import CommandMix, parse_mix
+
+DEFAULT_MIX = 'LIGHT=50,TEMP=30,FIRE=2,EMERGENCY=2,POWER=5'
+
+class RakeCoach:
+    def __init__(self, binary: str, coach_id: int, num_cabins: int, args: List[str]):
+        """Start one coach with commands on a pipe, keeping all its output"""
+        self.coach_id = coach_id
+        self.proc = subprocess.Popen(
+            [binary, '--cabins', str(num_cabins), '--coach-id', str(coach_id)] + args,
+            stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        self.lines = []
+        self.lock = threading.Lock()
+        self.reader = threading.Thread(target=self._read_output, daemon=True)
+        self.reader.start()
+    
+    def _read_output(self):
+        """Keep draining stdout so the system never blocks on it"""
+        for raw in self.proc.stdout:
+            with self.lock:
+                self.lines.append(raw.decode(errors='replace').rstrip('\n'))
+    
+    def send(self, lines: List[str]):
+        """Write a batch of command lines"""
+        self.proc.stdin.write(''.join(line + '\n' for line in lines).encode())
+        self.proc.stdin.flush()
+    
+    def status(self, timeout: float = 5.0) -> List[str]:
+        """Ask for STATUS and return its report once complete"""
+        with self.lock:
+            start = len(self.lines)
+        self.send(['STATUS'])
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            with self.lock:
+                report = self.lines[start:]
+            if any(line.startswith('========================') for line in report):
+                return report
+            time.sleep(0.05)
+        return []
+    
+    def kill(self):
+        """Die without a final batch, as a crashed coach would"""
+        self.proc.kill()
+        self.proc.wait()
+    
+    def stop(self) -> int:
+        """Close the command pipe and shut the coach down"""
+        if self.proc.poll() is not None:
+            return self.proc.returncode
+        self.proc.stdin.close()
+        self.proc.send_signal(2)
+        try:
+            return self.proc.wait(timeout=15)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            return self.proc.wait()
+
+def parse_rake_view(report: List[str]) -> Dict[int, dict]:
+    """Rows of the aggregator's rake view table, by coach"""
+    rows = {}
+    in_table = False
+    for line in report:
+        if line.startswith('Rake view'):
+            in_table = True
+            continue
+        if not in_table or line.startswith(('Coach', '---')):
+            continue
+        fields = line.split()
+        if len(fields) != 14 or not fields[0].isdigit():
+            break
+        rows[int(fields[0])] = {
+            'cabins': int(fields[1]), 'status': fields[2], 'age_ms': float(fields[3]),
+            'fire': int(fields[4]), 'emergency': int(fields[5]), 'lights': int(fields[6]),
+            'power': fields[7], 'chain': fields[8], 'updates': int(fields[9]), 'kb': float(fields[10]),
+            'lost': int(fields[11]), 'p50_us': float(fields[12]), 'p99_us': float(fields[13]),
+        }
+    return rows
+
+def publisher_lines(report: List[str]) -> List[str]:
+    """The publisher section of a coach's STATUS"""
+    for i, line in enumerate(report):
+        if line.startswith('Peer publishing'):
+            return report[i:i + 4]
+    return []
+
+def expected_critical(sent: List[str]) -> Dict[str, int]:
+    """Fire and emergency cabins after the commands sent: the last of
+    FIRE / EMERGENCY for a cabin wins, nothing else clears them"""
+    last = {}
+    for line in sent:
+        word, _, rest = line.partition(' ')
+        if word in ('FIRE', 'EMERGENCY'):
+            last[int(rest)] = word
+    values = list(last.values())
+    return {'fire': values.count('FIRE'), 'emergency': values.count('EMERGENCY')}
+
+def main():
+    """Main function"""
+    parser = argparse.ArgumentParser(description='Run a rake of coach_rtos processes with one aggregator')
+    parser.add_argument('--binary', default='./bin/coach_rtos', help='coach_rtos executable')
+    parser.add_argument('--coaches', type=int, default=4, help='coach processes, the first aggregating')
+    parser.add_argument('--cabins', type=int, default=64, help='cabins per coach')
+    parser.add_argument('--transport', choices=['unix', 'udp'], default='unix',
+                        help='unix datagram socket or UDP multicast')
+    parser.add_argument('--address', help='override the peer address (unix:PATH or udp:HOST:PORT)')
+    parser.add_argument('--rate', type=int, default=200, help='commands/s sent to each coach')
+    parser.add_argument('--duration', type=float, default=3.0, help='seconds of commands')
+    parser.add_argument('--mix', default=DEFAULT_MIX, help=f'command weights (default {DEFAULT_MIX})')
+    parser.add_argument('--kill', action='store_true',
+                        help='kill the last coach halfway through; it must show as STALE')
+    parser.add_argument('--seed', type=int, default=1, help='random seed for the command mixes')
+    args = parser.parse_args()
+    
+    if args.coaches < 1 or args.coaches > 32:
+        parser.error('--coaches must be 1..32')
+    if args.address:
+        address = args.address
+    elif args.transport == 'unix':
+        address = f'unix:/tmp/coach_rake_{os.getpid()}.sock'
+    else:
+        address = f'udp:239.255.42.{os.getpid() % 250 + 1}:{5800 + os.getpid() % 1000}'
+    
+    # The aggregator first, so the other coaches' first keyframes reach it
+    coaches = [RakeCoach(args.binary, 0, args.cabins, ['--aggregate', address, '--peer', address])]
+    time.sleep(0.3)
+    coaches += [RakeCoach(args.binary, c, args.cabins, ['--peer', address]) for c in range(1, args.coaches)]
+    time.sleep(0.5)
+    
+    mixes = [CommandMix(parse_mix(args.mix), args.cabins, args.seed + c) for c in range(args.coaches)]
+    sent = [[] for _ in coaches]
+    killed = None
+    ok = True
+    try:
+        start = time.monotonic()
+        batch_interval = 0.05
+        while time.monotonic() - start < args.duration:
+            for c, coach in enumerate(coaches):
+                if c == killed:
+                    continue
+                lines = [mixes[c].next_command() for _ in range(max(1, int(args.rate * batch_interval)))]
+                coach.send(lines)
+                sent[c] += lines
+            if args.kill and killed is None and args.coaches > 1 and time.monotonic() - start > args.duration / 2:
+                killed = args.coaches - 1
+                coaches[killed].kill()
+            time.sleep(batch_interval)
+        
+        # Past the last delta batch and, for a killed coach, the stale limit
+        time.sleep(1.5)
+        report = coaches[0].status()
+        rake = parse_rake_view(report)
+        
+        print(f"{args.coaches} coaches x {args.cabins} cabins over {address}, "
+              f"{args.rate} commands/s each for {args.duration:.1f} s")
+        print(f"{'Coach':<6} {'Status':<8} {'Fire':>9} {'Emerg':>9} {'Updates':>8} {'kB':>8} "
+              f"{'Lost':>5} {'p50(us)':>9} {'p99(us)':>9}  Check")
+        for c in range(args.coaches):
+            row = rake.get(c)
+            if row is None:
+                print(f"{c:<6} missing from the rake view")
+                ok = False
+                continue
+            expected = expected_critical(sent[c])
+            if c == killed:
+                good = row['status'] == 'STALE'
+            else:
+                good = (row['status'] == 'synced' and row['fire'] == expected['fire'] and
+                        row['emergency'] == expected['emergency'] and row['cabins'] == args.cabins)
+            ok = ok and good
+            print(f"{c:<6} {row['status']:<8} {row['fire']:>4}/{expected['fire']:<4} "
+                  f"{row['emergency']:>4}/{expected['emergency']:<4} {row['updates']:>8} {row['kb']:>8.1f} "
+                  f"{row['lost']:>5} {row['p50_us']:>9.1f} {row['p99_us']:>9.1f}  {'ok' if good else 'FAIL'}")
+        
+        print()
+        for c, coach in enumerate(coaches):
+            if c == killed:
+                continue
+            lines = publisher_lines(coach.status() if c else report)
+            for line in lines[1:]:
+                print(f"coach {c}: {line}")
+    finally:
+        codes = [coach.stop() for coach in coaches]
+    
+    ok = ok and all(code == 0 for c, code in enumerate(codes) if c != killed)
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()